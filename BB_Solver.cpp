@@ -0,0 +1,586 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "BB_Solver.h"
+#include "Trace.h"
+
+namespace {
+   constexpr double INTEGRALITY_TOLERANCE = 1e-6;
+   constexpr double FEASIBILITY_TOLERANCE = 1e-6;
+   // slots of a deterministic round for each thread: more balance the load, fewer keep the best bound order
+   constexpr size_t NODES_PER_ROUND = 2;
+   // separation rounds at a node with a fractional LP solution; an integral one is separated until nothing is left
+   constexpr unsigned int FRACTIONAL_SEPARATION_ROUNDS = 5;
+   // in seconds, a year
+   constexpr double MAX_TIME_LIMIT = 365.0 * 24 * 3600;
+}
+
+BB_Solver::BB_Solver(const MIP_Model &model_, Options options_)
+      : _model{model_}, _options{std::move(options_)},
+        _sense{_model.direction == LP_Provider::Min ? 1.0 : _model.direction == LP_Provider::Max ? -1.0 : 0.0},
+        _incumbent_objective{std::numeric_limits<double>::infinity()}, _has_incumbent{false}, _next_node_id{0},
+        _num_open{0}, _num_nodes{0}, _stop{false}, _incomplete{false}, _unbounded{false} {
+   if (not _options.branching_priority.empty() and _options.branching_priority.size() != _model.num_columns()) {
+      throw std::logic_error("The branching priorities do not match the columns of the model");
+   }
+}
+
+bool BB_Solver::set_incumbent(const std::vector<double> &values) {
+   if (not _model.is_feasible(values, FEASIBILITY_TOLERANCE)) {
+      return false;
+   }
+   return try_incumbent(values);
+}
+
+const char *BB_Solver::status_name(Status status) {
+   switch (status) {
+      case Optimal: {
+         return "optimal";
+      }
+      case Feasible: {
+         return "feasible";
+      }
+      case Infeasible: {
+         return "infeasible";
+      }
+      case Unbounded: {
+         return "unbounded";
+      }
+      default: {
+         return "no solution";
+      }
+   }
+}
+
+void BB_Solver::apply_bounds(Worker &worker, const Node &node) {
+   for (VarID col: worker.applied) {
+      worker.lp.set_bounds(col, _model.lower[col], _model.upper[col]);
+   }
+   worker.applied.clear();
+   for (const BoundChange &change: node.changes) {
+      worker.lp.set_bounds(change.col, change.lower, change.upper);
+      worker.applied.push_back(change.col);
+   }
+}
+
+BB_Solver::NodeOutcome BB_Solver::process_node(Worker &worker, Node &node, double threshold, Node &first,
+                                               Node &second) {
+   ++worker.num_nodes;
+   apply_bounds(worker, node);
+   double bound;
+   VarID branch_col;
+   for (unsigned int separation_round = 0;; ++separation_round) {
+      DualSimplex::Status lp_status = worker.lp.solve(_options.lp_iteration_limit, _deadline);
+      if (lp_status == DualSimplex::Infeasible) {
+         return Pruned;
+      }
+      if (lp_status == DualSimplex::Unbounded) {
+         return UnboundedLP;
+      }
+      if (lp_status == DualSimplex::IterationLimit or lp_status == DualSimplex::TimeLimit) {
+         // the node cannot be branched safely, but the basis is dual feasible and still gives a bound
+         node.bound = std::max(node.bound, worker.lp.dual_bound());
+         return node.bound >= threshold ? Pruned : Unsolved;
+      }
+      bound = std::max(node.bound, worker.lp.dual_bound());
+      if (bound >= threshold) {
+         return Pruned;
+      }
+      worker.lp.get_values(worker.values);
+      branch_col = select_branching_column(worker.values);
+      if (_options.separator == nullptr or
+          (branch_col != _model.num_columns() and separation_round == FRACTIONAL_SEPARATION_ROUNDS)) {
+         break;
+      }
+      worker.separated.clear();
+      if (_options.separator->separate(worker.values, FEASIBILITY_TOLERANCE, worker.separated) == 0) {
+         break;
+      }
+      worker.lp.add_rows(worker.separated);
+      worker.num_separated += worker.separated.num_rows();
+   }
+   if (branch_col == _model.num_columns()) {
+      return Integral;
+   }
+
+   Node down{node.changes, bound, node.depth + 1, 0};
+   down.changes.push_back(BoundChange{branch_col, _model.lower[branch_col], 0.0});
+   Node up{std::move(node.changes), bound, node.depth + 1, 0};
+   up.changes.push_back(BoundChange{branch_col, 1.0, _model.upper[branch_col]});
+   bool up_first = worker.values[branch_col] >= 0.5;
+   first = std::move(up_first ? up : down);
+   second = std::move(up_first ? down : up);
+   return Branched;
+}
+
+BB_Solver::VarID BB_Solver::select_branching_column(const std::vector<double> &values) const {
+   VarID best_col = _model.num_columns();
+   int best_priority = std::numeric_limits<int>::min();
+   double best_fractionality = 0.0;
+   for (VarID col = 0; col != _model.num_columns(); ++col) {
+      if (not _model.is_binary(col)) {
+         continue;
+      }
+      double fractionality = std::abs(values[col] - std::round(values[col]));
+      if (fractionality <= INTEGRALITY_TOLERANCE) {
+         continue;
+      }
+      int priority = _options.branching_priority.empty() ? 0 : _options.branching_priority[col];
+      if (priority > best_priority or (priority == best_priority and fractionality > best_fractionality)) {
+         best_col = col;
+         best_priority = priority;
+         best_fractionality = fractionality;
+      }
+   }
+   return best_col;
+}
+
+bool BB_Solver::try_incumbent(std::vector<double> values) {
+   for (VarID col = 0; col != _model.num_columns(); ++col) {
+      if (_model.is_binary(col)) {
+         values[col] = std::round(values[col]);
+      }
+   }
+   if (not _model.is_feasible(values, FEASIBILITY_TOLERANCE)) {
+      return false;
+   }
+   if (_options.separator != nullptr) {
+      ConstraintMatrix violated;
+      if (_options.separator->separate(values, FEASIBILITY_TOLERANCE, violated) != 0) {
+         return false;
+      }
+   }
+   double objective = _sense * (_model.evaluate(values) - _model.objective_offset);
+   std::lock_guard<std::mutex> lock(_incumbent_mutex);
+   if (objective >= _incumbent_objective.load()) {
+      return false;
+   }
+   _incumbent = std::move(values);
+   _incumbent_objective.store(objective);
+   _has_incumbent = true;
+   if (_options.verbose) {
+      std::cout << "B&B: incumbent " << _sense * objective << " after " << elapsed() << " s" << std::endl;
+   }
+   return true;
+}
+
+double BB_Solver::prune_threshold() const {
+   double incumbent_objective = _incumbent_objective.load();
+   return incumbent_objective -
+          std::max(_options.absolute_gap, _options.relative_gap * std::abs(incumbent_objective));
+}
+
+double BB_Solver::elapsed() const {
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start_time).count();
+}
+
+BB_Solver::Result BB_Solver::solve() {
+   TRACE_SCOPE("BB_Solver::solve");
+   _start_time = std::chrono::steady_clock::now();
+   _deadline = std::chrono::steady_clock::time_point::max();
+   if (_options.time_limit < MAX_TIME_LIMIT) {
+      // far limits, infinity included, would overflow the clock
+      _deadline = _start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(std::max(0.0, _options.time_limit)));
+   }
+   Result result;
+   unsigned int num_threads = std::max(1u, _options.num_threads);
+   _workers.clear();
+   for (unsigned int worker_idx = 0; worker_idx != num_threads; ++worker_idx) {
+      _workers.push_back(std::make_unique<Worker>(_model));
+   }
+   _unbounded = false;
+
+   // the nodes left open when the search stops early, for the bound
+   std::vector<Node> open_nodes;
+   bool complete;
+   if (num_threads == 1) {
+      complete = solve_serial(open_nodes);
+   } else if (_options.deterministic) {
+      complete = solve_deterministic(open_nodes);
+   } else {
+      complete = solve_work_stealing();
+      for (auto &worker: _workers) {
+         for (Node &node: worker->open_nodes) {
+            open_nodes.push_back(std::move(node));
+         }
+      }
+   }
+   for (auto &worker: _workers) {
+      for (Node &node: worker->unsolved_nodes) {
+         open_nodes.push_back(std::move(node));
+      }
+   }
+
+   double global_bound = _incumbent_objective;
+   for (const Node &node: open_nodes) {
+      global_bound = std::min(global_bound, node.bound);
+   }
+   if (_unbounded) {
+      result.status = Unbounded;
+   } else if (not _has_incumbent) {
+      result.status = complete ? Infeasible : NoSolution;
+   } else {
+      result.status = complete ? Optimal : Feasible;
+      result.objective = _sense * _incumbent_objective + _model.objective_offset;
+      result.values = _incumbent;
+   }
+   result.bound = _sense * (complete ? _incumbent_objective.load() : global_bound) + _model.objective_offset;
+   // an open node without a bound is the root, stopped before its LP started or while the bound was still infinite
+   result.has_bound = complete or std::isfinite(global_bound);
+   if (_sense == 0.0) {
+      result.objective = _model.objective_offset;
+      result.bound = _model.objective_offset;
+   }
+   for (const auto &worker: _workers) {
+      result.num_nodes += worker->num_nodes;
+      result.lp_iterations += worker->lp.total_iterations() - worker->copied_iterations;
+      result.separated_rows += worker->num_separated;
+   }
+   result.seconds = elapsed();
+   _workers.clear();
+   return result;
+}
+
+void BB_Solver::share_first_lp() {
+   const Worker &first_worker = *_workers.front();
+   for (size_t worker_idx = 1; worker_idx != _workers.size(); ++worker_idx) {
+      _workers[worker_idx]->lp = first_worker.lp;
+      _workers[worker_idx]->applied = first_worker.applied;
+      _workers[worker_idx]->copied_iterations = first_worker.lp.total_iterations();
+   }
+}
+
+bool BB_Solver::solve_serial(std::vector<Node> &open_nodes) {
+   Worker &worker = *_workers.front();
+   auto heap_order = [](const Node &first, const Node &second) {
+      // std::push_heap keeps the largest on top: the smallest bound, then the deepest node, then the oldest
+      if (first.bound != second.bound) {
+         return first.bound > second.bound;
+      }
+      if (first.depth != second.depth) {
+         return first.depth < second.depth;
+      }
+      return first.id > second.id;
+   };
+   open_nodes.push_back(Node{{}, -std::numeric_limits<double>::infinity(), 0, _next_node_id++});
+   bool has_dive_node = false;
+   Node dive_node;
+   bool complete = true;
+
+   while (has_dive_node or not open_nodes.empty()) {
+      if (worker.num_nodes >= _options.node_limit or elapsed() >= _options.time_limit) {
+         complete = false;
+         break;
+      }
+      Node node;
+      if (has_dive_node) {
+         node = std::move(dive_node);
+         has_dive_node = false;
+      } else if (_options.node_selection == DepthFirst) {
+         node = std::move(open_nodes.back());
+         open_nodes.pop_back();
+      } else {
+         std::pop_heap(open_nodes.begin(), open_nodes.end(), heap_order);
+         node = std::move(open_nodes.back());
+         open_nodes.pop_back();
+      }
+      double threshold = prune_threshold();
+      if (node.bound >= threshold) {
+         continue;
+      }
+
+      Node first, second;
+      NodeOutcome outcome = process_node(worker, node, threshold, first, second);
+      if (outcome == UnboundedLP) {
+         _unbounded = true;
+         break;
+      }
+      if (outcome == Unsolved) {
+         complete = false;
+         worker.unsolved_nodes.push_back(std::move(node));
+         continue;
+      }
+      if (outcome == Integral) {
+         try_incumbent(worker.values);
+         continue;
+      }
+      if (outcome != Branched) {
+         continue;
+      }
+      first.id = _next_node_id++;
+      second.id = _next_node_id++;
+      if (_options.node_selection == DepthFirst) {
+         open_nodes.push_back(std::move(second));
+         open_nodes.push_back(std::move(first));
+      } else {
+         if (_options.node_selection == BestBoundWithDiving) {
+            dive_node = std::move(first);
+            has_dive_node = true;
+         } else {
+            open_nodes.push_back(std::move(first));
+            std::push_heap(open_nodes.begin(), open_nodes.end(), heap_order);
+         }
+         open_nodes.push_back(std::move(second));
+         std::push_heap(open_nodes.begin(), open_nodes.end(), heap_order);
+      }
+   }
+   if (has_dive_node) {
+      open_nodes.push_back(std::move(dive_node));
+   }
+   return complete;
+}
+
+bool BB_Solver::solve_work_stealing() {
+   _num_nodes = 0;
+   _stop = false;
+   _incomplete = false;
+   // the root is solved before the other workers start, so that they start from its basis
+   Worker &first_worker = *_workers.front();
+   Node root{{}, -std::numeric_limits<double>::infinity(), 0, _next_node_id++};
+   Node first, second;
+   ++_num_nodes;
+   NodeOutcome outcome = process_node(first_worker, root, prune_threshold(), first, second);
+   if (outcome == UnboundedLP) {
+      _unbounded = true;
+      return true;
+   }
+   if (outcome == Unsolved) {
+      first_worker.unsolved_nodes.push_back(std::move(root));
+      return false;
+   }
+   if (outcome == Integral) {
+      try_incumbent(first_worker.values);
+   }
+   if (outcome != Branched) {
+      return true;
+   }
+   first.id = _next_node_id++;
+   second.id = _next_node_id++;
+   first_worker.open_nodes.push_back(std::move(first));
+   first_worker.open_nodes.push_back(std::move(second));
+   _num_open = 2;
+   share_first_lp();
+   std::vector<std::thread> threads;
+   for (unsigned int worker_idx = 1; worker_idx != _workers.size(); ++worker_idx) {
+      threads.emplace_back(&BB_Solver::run_worker, this, worker_idx);
+   }
+   run_worker(0);
+   for (std::thread &thread: threads) {
+      thread.join();
+   }
+   return not _incomplete;
+}
+
+bool BB_Solver::take_best_node(Node &node) {
+   // the fronts are only peeked at, so the chosen deque may have been emptied by another worker in the meantime
+   while (true) {
+      Worker *best_worker = nullptr;
+      double best_bound = std::numeric_limits<double>::infinity();
+      uint64_t best_id = std::numeric_limits<uint64_t>::max();
+      for (auto &worker: _workers) {
+         std::lock_guard<std::mutex> lock(worker->mutex);
+         if (worker->open_nodes.empty()) {
+            continue;
+         }
+         const Node &front = worker->open_nodes.front();
+         if (best_worker == nullptr or front.bound < best_bound or (front.bound == best_bound and front.id < best_id)) {
+            best_worker = worker.get();
+            best_bound = front.bound;
+            best_id = front.id;
+         }
+      }
+      if (best_worker == nullptr) {
+         return false;
+      }
+      std::lock_guard<std::mutex> lock(best_worker->mutex);
+      if (not best_worker->open_nodes.empty()) {
+         node = std::move(best_worker->open_nodes.front());
+         best_worker->open_nodes.pop_front();
+         return true;
+      }
+   }
+}
+
+void BB_Solver::run_worker(unsigned int worker_idx) {
+   Worker &worker = *_workers[worker_idx];
+   auto push = [&worker](Node &&node) {
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      worker.open_nodes.push_back(std::move(node));
+   };
+   bool has_dive_node = false;
+   Node node;
+   while (not _stop) {
+      if (not has_dive_node) {
+         bool found = false;
+         if (_options.node_selection == DepthFirst) {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (not worker.open_nodes.empty()) {
+               node = std::move(worker.open_nodes.back());
+               worker.open_nodes.pop_back();
+               found = true;
+            }
+         }
+         if (not found and not take_best_node(node)) {
+            if (_num_open == 0) {
+               break;
+            }
+            std::this_thread::yield();
+            continue;
+         }
+      }
+      has_dive_node = false;
+      if (_num_nodes >= _options.node_limit or elapsed() >= _options.time_limit) {
+         _incomplete = true;
+         _stop = true;
+         push(std::move(node));
+         break;
+      }
+      double threshold = prune_threshold();
+      if (node.bound >= threshold) {
+         --_num_open;
+         continue;
+      }
+      ++_num_nodes;
+
+      Node first, second;
+      NodeOutcome outcome = process_node(worker, node, threshold, first, second);
+      if (outcome == UnboundedLP) {
+         _unbounded = true;
+         _stop = true;
+      } else if (outcome == Unsolved) {
+         _incomplete = true;
+         worker.unsolved_nodes.push_back(std::move(node));
+      } else if (outcome == Integral) {
+         try_incumbent(worker.values);
+      } else if (outcome == Branched) {
+         first.id = _next_node_id++;
+         second.id = _next_node_id++;
+         _num_open += 2;
+         push(std::move(second));
+         if (_options.node_selection == BestBoundWithDiving) {
+            node = std::move(first);
+            has_dive_node = true;
+         } else {
+            push(std::move(first));
+         }
+      }
+      // only now, so that the children are counted before their parent goes
+      --_num_open;
+   }
+   if (has_dive_node) {
+      push(std::move(node));
+   }
+}
+
+bool BB_Solver::solve_deterministic(std::vector<Node> &open_nodes) {
+   auto by_bound = [](const Node &first, const Node &second) {
+      return first.bound < second.bound or (first.bound == second.bound and first.id < second.id);
+   };
+   size_t num_threads = _workers.size();
+   size_t num_nodes = 0;
+   open_nodes.push_back(Node{{}, -std::numeric_limits<double>::infinity(), 0, _next_node_id++});
+   bool complete = true;
+   bool first_round = true;
+   while (not open_nodes.empty()) {
+      if (num_nodes >= _options.node_limit or elapsed() >= _options.time_limit) {
+         complete = false;
+         break;
+      }
+      double threshold = prune_threshold();
+      open_nodes.erase(std::remove_if(open_nodes.begin(), open_nodes.end(), [threshold](const Node &node) {
+         return node.bound >= threshold;
+      }), open_nodes.end());
+      std::sort(open_nodes.begin(), open_nodes.end(), by_bound);
+      size_t round_size = std::min(open_nodes.size(), num_threads * NODES_PER_ROUND);
+      std::vector<Node> round_nodes(std::make_move_iterator(open_nodes.begin()),
+                                    std::make_move_iterator(open_nodes.begin() + round_size));
+      open_nodes.erase(open_nodes.begin(), open_nodes.begin() + round_size);
+
+      // slot i goes to worker i % num_threads, which runs its slots in order
+      std::vector<RoundResult> results(round_size);
+      auto run_slots = [&](size_t worker_idx) {
+         for (size_t slot = worker_idx; slot < round_size; slot += num_threads) {
+            process_round_slot(*_workers[worker_idx], std::move(round_nodes[slot]), threshold, results[slot]);
+         }
+      };
+      std::vector<std::thread> threads;
+      for (size_t worker_idx = 1; worker_idx < std::min(num_threads, round_size); ++worker_idx) {
+         threads.emplace_back(run_slots, worker_idx);
+      }
+      run_slots(0);
+      for (std::thread &thread: threads) {
+         thread.join();
+      }
+      if (first_round) {
+         // the first worker alone has solved the root: the others start from its basis
+         share_first_lp();
+         first_round = false;
+      }
+
+      for (RoundResult &result: results) {
+         num_nodes += result.num_nodes;
+         for (std::vector<double> &solution: result.solutions) {
+            try_incumbent(std::move(solution));
+         }
+         for (Node &child: result.children) {
+            child.id = _next_node_id++;
+            open_nodes.push_back(std::move(child));
+         }
+         if (not result.unsolved.empty()) {
+            complete = false;
+            for (Node &node: result.unsolved) {
+               _workers.front()->unsolved_nodes.push_back(std::move(node));
+            }
+         }
+         if (result.unbounded) {
+            _unbounded = true;
+         }
+      }
+      if (_unbounded) {
+         break;
+      }
+   }
+   return complete;
+}
+
+void BB_Solver::process_round_slot(Worker &worker, Node node, double threshold, RoundResult &result) {
+   for (bool diving = false;; diving = true) {
+      if (diving and elapsed() >= _options.time_limit) {
+         // the round is the last one: the node stays open, for the bound
+         result.children.push_back(std::move(node));
+         return;
+      }
+      ++result.num_nodes;
+      Node first, second;
+      NodeOutcome outcome = process_node(worker, node, threshold, first, second);
+      if (outcome == UnboundedLP) {
+         result.unbounded = true;
+         return;
+      }
+      if (outcome == Unsolved) {
+         result.unsolved.push_back(std::move(node));
+         return;
+      }
+      if (outcome == Integral) {
+         // the incumbent is only updated when the round is merged
+         result.solutions.push_back(worker.values);
+         return;
+      }
+      if (outcome != Branched) {
+         return;
+      }
+      if (_options.node_selection == BestBound) {
+         result.children.push_back(std::move(first));
+         result.children.push_back(std::move(second));
+         return;
+      }
+      result.children.push_back(std::move(second));
+      node = std::move(first);
+   }
+}
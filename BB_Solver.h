@@ -0,0 +1,200 @@
+#ifndef SCHEDULE_HIGHSCHOOL_BB_SOLVER_H
+#define SCHEDULE_HIGHSCHOOL_BB_SOLVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "MIP_Model.h"
+#include "Dual_Simplex.h"
+
+// Finds the rows of a model that were left out of the MIP_Model given to BB_Solver, because there are too many of them
+// and few matter, and that a solution violates. It is called by all the workers at once
+class RowSeparator {
+public:
+   virtual ~RowSeparator() = default;
+
+   // appends to @p rows those that @p values, one for each column of the model, violate by more than @p tolerance.
+   // Returns their number
+   virtual size_t separate(const std::vector<double> &values, double tolerance, ConstraintMatrix &rows) const = 0;
+};
+
+// Branch-and-bound over the binary columns of a MIP_Model, with the LP relaxations solved by DualSimplex.
+// Continuous columns are never branched on: they are left to the LP.
+// With more than one thread every worker owns a DualSimplex and a deque of open nodes: it dives into its own subtree
+// and, when the dive ends, takes the oldest node with the smallest bound from any deque (its own or stolen).
+// The root is solved by the first worker alone, and the others start from a copy of its LP and basis.
+// The incumbent objective is shared by all the workers. The deterministic mode instead runs in rounds: the open
+// nodes with the smallest bounds are dealt to the workers in a fixed order, and the results are merged in that
+// same order, so that the same input and number of threads always give the same schedule.
+// With a RowSeparator the rows that an LP solution violates are added to the LP of the worker and the LP is solved
+// again, a few rounds for a fractional solution and until none is left for an integral one, which is only then a
+// solution. The rows are valid at every node and stay in the LP of the worker, so every worker grows its own model
+class BB_Solver {
+public:
+   typedef Variables::VarID VarID;
+
+   enum NodeSelection {
+      BestBound,  // always the open node with the smallest bound
+      DepthFirst,  // always the last created node
+      BestBoundWithDiving  // follows one child down to a leaf, then jumps to the best bound
+   };
+
+   enum Status {
+      Optimal, Feasible, Infeasible, NoSolution, Unbounded
+   };
+
+   struct Options {
+      NodeSelection node_selection;
+      double time_limit;  // in seconds
+      size_t node_limit;
+      size_t lp_iteration_limit;  // for each node
+      double absolute_gap;
+      double relative_gap;
+      // a fractional column with higher priority is always branched on first. Empty means all equal
+      std::vector<int> branching_priority;
+      bool verbose;
+      unsigned int num_threads;
+      bool deterministic;  // only matters with more than one thread
+      const RowSeparator *separator;  // the rows left out of the model, or nullptr
+
+      Options() : node_selection{BestBoundWithDiving}, time_limit{std::numeric_limits<double>::infinity()},
+                  node_limit{std::numeric_limits<size_t>::max()}, lp_iteration_limit{1000000},
+                  absolute_gap{1e-6}, relative_gap{1e-9}, verbose{false}, num_threads{1}, deterministic{false},
+                  separator{nullptr} {}
+   };
+
+   struct Result {
+      Status status;
+      double objective;  // in the direction of the model, offset included
+      double bound;  // best proven bound, in the direction of the model
+      bool has_bound;  // false when the search stopped before the LP of the root gave a bound
+      std::vector<double> values;
+      size_t num_nodes;
+      size_t lp_iterations;
+      size_t separated_rows;  // added by the separator, over all the workers
+      double seconds;
+
+      Result() : status{NoSolution}, objective{0.0}, bound{0.0}, has_bound{false}, num_nodes{0}, lp_iterations{0},
+                 separated_rows{0}, seconds{0.0} {}
+
+      // values holds a solution, empty if the model has no column
+      [[nodiscard]] bool has_solution() const { return status == Optimal or status == Feasible; }
+   };
+
+   BB_Solver(const MIP_Model &model_, Options options_ = Options());
+
+   // starting incumbent, for example from a heuristic. Returns false (and ignores it) if it is not feasible
+   bool set_incumbent(const std::vector<double> &values);
+
+   Result solve();
+
+   [[nodiscard]] static const char *status_name(Status status);
+
+private:
+   struct BoundChange {
+      VarID col;
+      double lower;
+      double upper;
+   };
+
+   struct Node {
+      std::vector<BoundChange> changes;  // with respect to the bounds of the model
+      double bound;  // minimization sense
+      size_t depth;
+      uint64_t id;
+   };
+
+   enum NodeOutcome {
+      Pruned, Branched, Integral, Unsolved, UnboundedLP
+   };
+
+   struct Worker {
+      DualSimplex lp;
+      std::vector<VarID> applied;  // columns whose bounds differ from the model in the LP
+      std::vector<double> values;
+      ConstraintMatrix separated;  // the rows of the last separation round
+      std::deque<Node> open_nodes;  // the owner pushes at the back, the best node is taken from the front
+      std::vector<Node> unsolved_nodes;  // whose LP stopped at a limit, kept for the bound
+      std::mutex mutex;
+      size_t num_nodes;
+      size_t num_separated;
+      size_t copied_iterations;  // of the LP copied from the first worker, which counts them
+
+      explicit Worker(const MIP_Model &model) : lp(model), num_nodes{0}, num_separated{0}, copied_iterations{0} {}
+   };
+
+   // what a slot of a deterministic round gives back, to be merged in order
+   struct RoundResult {
+      std::vector<Node> children;
+      std::vector<std::vector<double>> solutions;
+      std::vector<Node> unsolved;
+      size_t num_nodes;
+      bool unbounded;
+
+      RoundResult() : num_nodes{0}, unbounded{false} {}
+   };
+
+   // sets on the LP of @p worker the bounds of the model plus the changes of @p node
+   void apply_bounds(Worker &worker, const Node &node);
+
+   // solves the LP of @p node, with separation rounds if there is a separator. When the LP solution is integral it is
+   // left in worker.values; when it is fractional the node is split into @p first, the child to dive into, and
+   // @p second. The ids of the children are not set
+   NodeOutcome process_node(Worker &worker, Node &node, double threshold, Node &first, Node &second);
+
+   // the binary column to branch on, or num_columns() if the values are integral
+   [[nodiscard]] VarID select_branching_column(const std::vector<double> &values) const;
+
+   // records @p values as incumbent if they are better. @p values are rounded on the binary columns, and must not
+   // violate the rows of the separator
+   bool try_incumbent(std::vector<double> values);
+
+   [[nodiscard]] double prune_threshold() const;
+
+   [[nodiscard]] double elapsed() const;
+
+   // the serial search, on the first worker. Returns false if it stopped before exhausting the tree
+   bool solve_serial(std::vector<Node> &open_nodes);
+
+   // copies the LP of the first worker, with the root solved, to the others
+   void share_first_lp();
+
+   bool solve_work_stealing();
+
+   void run_worker(unsigned int worker_idx);
+
+   // the oldest node with the smallest bound at the front of a deque, or false if all the deques are empty
+   bool take_best_node(Node &node);
+
+   bool solve_deterministic(std::vector<Node> &open_nodes);
+
+   // one slot of a deterministic round: @p node and, unless the selection is BestBound, a dive below it
+   void process_round_slot(Worker &worker, Node node, double threshold, RoundResult &result);
+
+   const MIP_Model &_model;
+   Options _options;
+   double _sense;  // 1 for Min, -1 for Max, 0 for Feasible
+   std::atomic<double> _incumbent_objective;  // minimization sense
+   std::vector<double> _incumbent;
+   bool _has_incumbent;  // a model without columns has the empty incumbent
+   std::mutex _incumbent_mutex;
+   std::atomic<uint64_t> _next_node_id;
+
+   std::vector<std::unique_ptr<Worker>> _workers;
+   std::chrono::steady_clock::time_point _start_time;
+   std::chrono::steady_clock::time_point _deadline;  // of the LPs, from the time limit
+   // the work stealing search
+   std::atomic<size_t> _num_open;  // nodes in the deques or being processed
+   std::atomic<size_t> _num_nodes;
+   std::atomic<bool> _stop;
+   std::atomic<bool> _incomplete;
+   std::atomic<bool> _unbounded;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_BB_SOLVER_H
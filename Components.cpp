@@ -0,0 +1,158 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include "Components.h"
+#include "LP_Provider.h"
+#include "MIP_Model.h"
+#include "Model_Solver.h"
+#include "Trace.h"
+#include "Variables.h"
+
+namespace {
+   constexpr size_t NO_COMPONENT = std::numeric_limits<size_t>::max();
+
+   // union-find over the classes and the teachers, with path halving and union by size
+   class DisjointSets {
+   public:
+      explicit DisjointSets(size_t size_) : _parent(size_), _size(size_, 1) {
+         std::iota(_parent.begin(), _parent.end(), 0);
+      }
+
+      size_t find(size_t element) {
+         while (_parent[element] != element) {
+            _parent[element] = _parent[_parent[element]];
+            element = _parent[element];
+         }
+         return element;
+      }
+
+      void join(size_t first, size_t second) {
+         first = find(first);
+         second = find(second);
+         if (first == second) {
+            return;
+         }
+         if (_size[first] < _size[second]) {
+            std::swap(first, second);
+         }
+         _parent[second] = first;
+         _size[first] += _size[second];
+      }
+
+   private:
+      std::vector<size_t> _parent;
+      std::vector<size_t> _size;
+   };
+
+   // the worse of two statuses of parts, for the status of the whole school
+   BB_Solver::Status combine(BB_Solver::Status first, BB_Solver::Status second) {
+      for (BB_Solver::Status status: {BB_Solver::Infeasible, BB_Solver::Unbounded, BB_Solver::NoSolution,
+                                      BB_Solver::Feasible}) {
+         if (first == status or second == status) {
+            return status;
+         }
+      }
+      return BB_Solver::Optimal;
+   }
+}
+
+SchoolComponents::SchoolComponents(const Input &input_) : _input{input_}, _schedule(input_) {
+   TRACE_SCOPE("SchoolComponents::SchoolComponents");
+   // the classes are 0 to num_classes() - 1, the teachers follow
+   DisjointSets sets(_input.num_classes() + _input.num_teachers());
+   for (unsigned int teacher_idx = 0; teacher_idx != _input.num_teachers(); ++teacher_idx) {
+      for (unsigned int req_idx: _input.get_teachers()[teacher_idx].requirements) {
+         const Input::Requirement &requirement = _input.get_requirements()[req_idx];
+         sets.join(_input.num_classes() + teacher_idx, _input.convert_from_class_id(requirement.class_id()));
+      }
+   }
+   // the components in the order of their first class
+   std::vector<size_t> component_of_root(_input.num_classes() + _input.num_teachers(), NO_COMPONENT);
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      size_t root = sets.find(class_idx);
+      if (component_of_root[root] == NO_COMPONENT) {
+         component_of_root[root] = _class_positions.size();
+         _class_positions.emplace_back();
+         _requirement_positions.emplace_back();
+      }
+      _class_positions[component_of_root[root]].push_back(class_idx);
+   }
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      unsigned int class_idx = _input.convert_from_class_id(_input.get_requirements()[req_idx].class_id());
+      _requirement_positions[component_of_root[sets.find(class_idx)]].push_back(req_idx);
+   }
+   _inputs.reserve(_class_positions.size());
+   for (const std::vector<unsigned int> &class_positions: _class_positions) {
+      _inputs.emplace_back(_input, class_positions);
+   }
+}
+
+SchoolComponents::Result SchoolComponents::solve(const ModelOptions &model_options, BB_Solver::Options options,
+                                                 bool use_presolve) {
+   TRACE_SCOPE("SchoolComponents::solve");
+   auto start_time = std::chrono::steady_clock::now();
+   std::vector<size_t> order(size());
+   std::iota(order.begin(), order.end(), 0);
+   std::stable_sort(order.begin(), order.end(), [&](size_t first, size_t second) {
+      return _requirement_positions[first].size() > _requirement_positions[second].size();
+   });
+   unsigned int num_workers = std::max(1u, std::min<unsigned int>(options.num_threads, size()));
+   options.num_threads = std::max(1u, options.num_threads / num_workers);
+
+   Result result;
+   std::mutex result_mutex;
+   std::atomic<size_t> next_pos{0};
+   auto solve_components = [&]() {
+      for (size_t pos = next_pos++; pos < size(); pos = next_pos++) {
+         size_t component = order[pos];
+         const Input &input = _inputs[component];
+         Variables variables(input, model_options);
+         LP_Provider provider(input, variables, LP_Provider::Min);
+         MIP_Model model(provider);
+         ModelSolver model_solver(provider, model, use_presolve, options);
+         BB_Solver::Result component_result = model_solver.solve();
+         if (component_result.has_solution()) {
+            // the parts have different classes, so they write different lessons of _schedule
+            merge(component, Schedule(input, variables, component_result.values));
+         }
+         std::lock_guard<std::mutex> lock(result_mutex);
+         result.status = combine(result.status, component_result.status);
+         result.objective += component_result.objective;
+         result.bound += component_result.bound;
+         result.has_bound = result.has_bound and component_result.has_bound;
+         result.num_nodes += component_result.num_nodes;
+      }
+   };
+   std::vector<std::thread> threads;
+   for (unsigned int worker = 1; worker < num_workers; ++worker) {
+      threads.emplace_back(solve_components);
+   }
+   solve_components();
+   for (std::thread &thread: threads) {
+      thread.join();
+   }
+   result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+   return result;
+}
+
+void SchoolComponents::merge(size_t component, const Schedule &component_schedule) {
+   const std::vector<unsigned int> &class_positions = _class_positions[component];
+   const std::vector<unsigned int> &requirement_positions = _requirement_positions[component];
+   for (unsigned int class_idx = 0; class_idx != class_positions.size(); ++class_idx) {
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+            unsigned int req_idx = component_schedule.get_lesson(class_idx, day, hour);
+            _schedule.set_lesson(class_positions[class_idx], day, hour,
+                                 req_idx == Schedule::NoLesson ? Schedule::NoLesson : requirement_positions[req_idx]);
+         }
+      }
+   }
+}
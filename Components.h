@@ -0,0 +1,65 @@
+#ifndef SCHEDULE_HIGHSCHOOL_COMPONENTS_H
+#define SCHEDULE_HIGHSCHOOL_COMPONENTS_H
+
+#include <vector>
+#include "BB_Solver.h"
+#include "Input.h"
+#include "Model_Options.h"
+#include "Schedule.h"
+
+// The parts of a school that share no teacher, for example separate campuses or evening courses with their own
+// staff: the connected components of the graph of the classes and the teachers, with the requirements as edges.
+// Every part is an Input of its own, with its own model, and they are solved at the same time; the schedule of the
+// school is the union of theirs, and its objective their sum, since the model has no row across them
+class SchoolComponents {
+public:
+   struct Result {
+      // Optimal if every part is, Infeasible if one is, NoSolution if one has no schedule, Feasible otherwise
+      BB_Solver::Status status;
+      double objective;  // the sum over the parts
+      double bound;
+      bool has_bound;  // if every part has one
+      size_t num_nodes;
+      double seconds;
+
+      Result() : status{BB_Solver::Optimal}, objective{0.0}, bound{0.0}, has_bound{true}, num_nodes{0},
+                 seconds{0.0} {}
+   };
+
+   explicit SchoolComponents(const Input &input_);
+
+   [[nodiscard]] size_t size() const { return _inputs.size(); }
+
+   [[nodiscard]] const Input &get_input(size_t component) const { return _inputs[component]; }
+
+   // the positions in the whole input of the classes of @p component, in the order of its input
+   [[nodiscard]] const std::vector<unsigned int> &get_classes(size_t component) const {
+      return _class_positions[component];
+   }
+
+   // the positions in the whole input of the requirements of @p component, in the order of its input
+   [[nodiscard]] const std::vector<unsigned int> &get_requirements(size_t component) const {
+      return _requirement_positions[component];
+   }
+
+   // builds and solves the model of every part, with presolve if @p use_presolve; the parts are taken by
+   // options.num_threads workers, the largest first, and each solver gets an equal share of the threads. The
+   // time limit applies to every part
+   Result solve(const ModelOptions &model_options, BB_Solver::Options options, bool use_presolve);
+
+   // the schedule of the last solve(), complete if it had a schedule for every part
+   [[nodiscard]] const Schedule &get_schedule() const { return _schedule; }
+
+private:
+   // writes the lessons of @p component_schedule, of the input of @p component, in _schedule
+   void merge(size_t component, const Schedule &component_schedule);
+
+   const Input &_input;
+   std::vector<Input> _inputs;
+   std::vector<std::vector<unsigned int>> _class_positions;
+   std::vector<std::vector<unsigned int>> _requirement_positions;
+   Schedule _schedule;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_COMPONENTS_H
@@ -0,0 +1,72 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include "Constraint_Matrix.h"
+
+void ConstraintMatrix::clear() {
+   _row_begin.assign(1, 0);
+   _col_idx.clear();
+   _coeff.clear();
+   _rhs.clear();
+   _rel.clear();
+}
+
+void ConstraintMatrix::reserve(size_t num_rows_, size_t num_nonzeros_) {
+   _row_begin.reserve(num_rows_ + 1);
+   _col_idx.reserve(num_nonzeros_);
+   _coeff.reserve(num_nonzeros_);
+   _rhs.reserve(num_rows_);
+   _rel.reserve(num_rows_);
+}
+
+void ConstraintMatrix::begin_row(Relation rel, double rhs) {
+   _rhs.push_back(rhs);
+   _rel.push_back(rel);
+}
+
+void ConstraintMatrix::append(const ConstraintMatrix &other) {
+   size_t offset = _col_idx.size();
+   for (size_t row_idx = 1; row_idx != other._row_begin.size(); ++row_idx) {
+      _row_begin.push_back(offset + other._row_begin[row_idx]);
+   }
+   _col_idx.insert(_col_idx.end(), other._col_idx.begin(), other._col_idx.end());
+   _coeff.insert(_coeff.end(), other._coeff.begin(), other._coeff.end());
+   _rhs.insert(_rhs.end(), other._rhs.begin(), other._rhs.end());
+   _rel.insert(_rel.end(), other._rel.begin(), other._rel.end());
+}
+
+void ConstraintMatrix::clear_row(size_t row_idx) {
+   if (row_idx >= num_rows()) {
+      throw std::logic_error("Call to ConstraintMatrix::clear_row out of range");
+   }
+   std::fill(_coeff.begin() + _row_begin[row_idx], _coeff.begin() + _row_begin[row_idx + 1], 0.0);
+   _rhs[row_idx] = 0.0;
+   _rel[row_idx] = Leq;
+}
+
+ConstraintMatrix::RowView ConstraintMatrix::row(size_t row_idx) const {
+   if (row_idx >= num_rows()) {
+      throw std::logic_error("Call to ConstraintMatrix::row out of range");
+   }
+   size_t begin = _row_begin[row_idx];
+   return RowView(RowEntries(_col_idx.data() + begin, _coeff.data() + begin, _row_begin[row_idx + 1] - begin),
+                  _rhs[row_idx], _rel[row_idx]);
+}
+
+void ConstraintMatrix::replay(ConstraintSink &sink) const {
+   for (size_t row_idx = 0; row_idx != num_rows(); ++row_idx) {
+      sink.begin_row(_rel[row_idx], _rhs[row_idx]);
+      for (size_t pos = _row_begin[row_idx]; pos != _row_begin[row_idx + 1]; ++pos) {
+         sink.add_entry(_col_idx[pos], _coeff[pos]);
+      }
+      sink.end_row();
+   }
+}
+
+size_t ConstraintMatrix::memory_usage() const {
+   return _row_begin.capacity() * sizeof(size_t) + _col_idx.capacity() * sizeof(ColIdx) +
+          _coeff.capacity() * sizeof(double) + _rhs.capacity() * sizeof(double) +
+          _rel.capacity() * sizeof(Relation);
+}
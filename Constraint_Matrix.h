@@ -0,0 +1,157 @@
+#ifndef SCHEDULE_HIGHSCHOOL_CONSTRAINT_MATRIX_H
+#define SCHEDULE_HIGHSCHOOL_CONSTRAINT_MATRIX_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "Variables.h"
+
+struct VarIdxCoeffPair {
+   Variables::VarID var_idx;
+   double coeff;
+
+   explicit VarIdxCoeffPair(Variables::VarID var_idx_, double coeff_ = 1.0) : var_idx{var_idx_}, coeff{coeff_} {}
+};
+
+// Receives the rows of a model one at a time. Every row is opened by begin_row, filled by add_entry and closed by
+// end_row
+class ConstraintSink {
+public:
+   enum Relation : unsigned char {
+      Leq, Eq, Geq
+   };
+
+   virtual ~ConstraintSink() = default;
+
+   virtual void begin_row(Relation rel, double rhs) = 0;
+
+   virtual void add_entry(Variables::VarID var_idx, double coeff) = 0;
+
+   virtual void end_row() = 0;
+};
+
+// Only counts rows and nonzeros, so that the real storage can be allocated exactly once
+class CountingSink : public ConstraintSink {
+public:
+   CountingSink() : _num_rows{0}, _num_nonzeros{0} {}
+
+   void begin_row(Relation, double) override { ++_num_rows; }
+
+   void add_entry(Variables::VarID, double) override { ++_num_nonzeros; }
+
+   void end_row() override {}
+
+   [[nodiscard]] size_t num_rows() const { return _num_rows; }
+
+   [[nodiscard]] size_t num_nonzeros() const { return _num_nonzeros; }
+
+private:
+   size_t _num_rows;
+   size_t _num_nonzeros;
+};
+
+// Compressed-sparse-row storage of the constraints: the entries of row i are in [_row_begin[i], _row_begin[i+1])
+class ConstraintMatrix : public ConstraintSink {
+public:
+   typedef uint32_t ColIdx;
+   static constexpr Variables::VarID MAX_NUM_COLUMNS = std::numeric_limits<ColIdx>::max();
+
+   // read-only view of the lhs of a row, iterating over VarIdxCoeffPair
+   class RowEntries {
+   public:
+      class const_iterator {
+      public:
+         const_iterator(const ColIdx *col_, const double *coeff_) : _col{col_}, _coeff{coeff_} {}
+
+         VarIdxCoeffPair operator*() const { return VarIdxCoeffPair(*_col, *_coeff); }
+
+         const_iterator &operator++() {
+            ++_col;
+            ++_coeff;
+            return *this;
+         }
+
+         bool operator==(const const_iterator &other) const { return _col == other._col; }
+
+         bool operator!=(const const_iterator &other) const { return _col != other._col; }
+
+      private:
+         const ColIdx *_col;
+         const double *_coeff;
+      };
+
+      RowEntries(const ColIdx *col_, const double *coeff_, size_t size_) : _col{col_}, _coeff{coeff_}, _size{size_} {}
+
+      [[nodiscard]] size_t size() const { return _size; }
+
+      [[nodiscard]] bool empty() const { return _size == 0; }
+
+      VarIdxCoeffPair operator[](size_t pos) const { return VarIdxCoeffPair(_col[pos], _coeff[pos]); }
+
+      [[nodiscard]] const_iterator begin() const { return const_iterator(_col, _coeff); }
+
+      [[nodiscard]] const_iterator end() const { return const_iterator(_col + _size, _coeff + _size); }
+
+      [[nodiscard]] const ColIdx *columns() const { return _col; }
+
+      [[nodiscard]] const double *coefficients() const { return _coeff; }
+
+   private:
+      const ColIdx *_col;
+      const double *_coeff;
+      size_t _size;
+   };
+
+   struct RowView {
+      RowEntries lhs;
+      double rhs;
+      Relation rel;
+
+      RowView(RowEntries lhs_, double rhs_, Relation rel_) : lhs{lhs_}, rhs{rhs_}, rel{rel_} {}
+   };
+
+   ConstraintMatrix() : _row_begin(1, 0) {}
+
+   void clear();
+
+   void reserve(size_t num_rows_, size_t num_nonzeros_);
+
+   void begin_row(Relation rel, double rhs) override;
+
+   void add_entry(Variables::VarID var_idx, double coeff) override {
+      _col_idx.push_back(static_cast<ColIdx>(var_idx));
+      _coeff.push_back(coeff);
+   }
+
+   void end_row() override { _row_begin.push_back(_col_idx.size()); }
+
+   // adds all the rows of @p other after those already here
+   void append(const ConstraintMatrix &other);
+
+   void set_rhs(size_t row_idx, double rhs) { _rhs[row_idx] = rhs; }
+
+   // leaves the row in place but without effect: 0 <= 0, with the coefficients set to zero
+   void clear_row(size_t row_idx);
+
+   [[nodiscard]] size_t num_rows() const { return _rhs.size(); }
+
+   [[nodiscard]] size_t num_nonzeros() const { return _col_idx.size(); }
+
+   [[nodiscard]] RowView row(size_t row_idx) const;
+
+   // sends all the rows, in order, to @p sink
+   void replay(ConstraintSink &sink) const;
+
+   // approximate number of bytes used by the storage
+   [[nodiscard]] size_t memory_usage() const;
+
+private:
+   std::vector<size_t> _row_begin;
+   std::vector<ColIdx> _col_idx;
+   std::vector<double> _coeff;
+   std::vector<double> _rhs;
+   std::vector<Relation> _rel;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_CONSTRAINT_MATRIX_H
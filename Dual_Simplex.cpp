@@ -0,0 +1,610 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "Dual_Simplex.h"
+
+namespace {
+   constexpr double INF = std::numeric_limits<double>::infinity();
+   constexpr double PRIMAL_TOLERANCE = 1e-7;
+   constexpr double DUAL_TOLERANCE = 1e-9;
+   constexpr double PIVOT_TOLERANCE = 1e-9;
+   constexpr double SINGULAR_TOLERANCE = 1e-11;
+   constexpr double RESIDUAL_TOLERANCE = 1e-6;
+   constexpr double PERTURBATION = 1e-7;
+   // stands for an infinite upper bound of a variable that would be dual infeasible on its lower bound
+   constexpr double ARTIFICIAL_BOUND = 1e7;
+   // the primal residual is checked every CHECK_FREQUENCY iterations, and the etas rebuilt if needed
+   constexpr size_t CHECK_FREQUENCY = 64;
+   // the etas are rebuilt after REFACTOR_FREQUENCY pivots, before they cost more than a refactor
+   constexpr size_t REFACTOR_FREQUENCY = 100;
+   // the clock is read every DEADLINE_FREQUENCY iterations
+   constexpr size_t DEADLINE_FREQUENCY = 16;
+   // smaller entries of an eta are dropped
+   constexpr double ETA_TOLERANCE = 1e-13;
+
+   // deterministic value in [0, 1), different for every column
+   double perturbation_weight(size_t col) {
+      uint64_t hash = (col + 1) * 0x9E3779B97F4A7C15ull;
+      hash ^= hash >> 31u;
+      hash *= 0xBF58476D1CE4E5B9ull;
+      hash ^= hash >> 29u;
+      return double(hash >> 11u) / double(uint64_t(1) << 53u);
+   }
+}
+
+DualSimplex::DualSimplex(const MIP_Model &model) : _num_columns{model.num_columns()}, _num_rows{model.num_rows()},
+                                                   _total_iterations{0}, _num_factor_etas{0} {
+   const ConstraintMatrix &matrix = model.constraints;
+   // transpose the rows into columns
+   _col_begin.assign(_num_columns + 1, 0);
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      for (VarIdxCoeffPair entry: matrix.row(row_idx).lhs) {
+         ++_col_begin[entry.var_idx + 1];
+      }
+   }
+   for (VarID col = 0; col != _num_columns; ++col) {
+      _col_begin[col + 1] += _col_begin[col];
+   }
+   _col_row.resize(_col_begin.back());
+   _col_val.resize(_col_begin.back());
+   std::vector<size_t> next_free(_col_begin.begin(), _col_begin.end() - 1);
+   _rhs.resize(_num_rows);
+   _lower.resize(num_total());
+   _upper.resize(num_total());
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      ConstraintMatrix::RowView row = matrix.row(row_idx);
+      for (VarIdxCoeffPair entry: row.lhs) {
+         size_t pos = next_free[entry.var_idx]++;
+         if (pos != _col_begin[entry.var_idx] and _col_row[pos - 1] == row_idx) {
+            // the same column twice in a row
+            _col_val[pos - 1] += entry.coeff;
+            --next_free[entry.var_idx];
+         } else {
+            _col_row[pos] = row_idx;
+            _col_val[pos] = entry.coeff;
+         }
+      }
+      _rhs[row_idx] = row.rhs;
+      VarID slack = _num_columns + row_idx;
+      _lower[slack] = row.rel == ConstraintSink::Geq ? -INF : 0.0;
+      _upper[slack] = row.rel == ConstraintSink::Leq ? INF : 0.0;
+   }
+   // remove the holes left by merged entries
+   size_t write_pos = 0;
+   for (VarID col = 0; col != _num_columns; ++col) {
+      size_t read_begin = _col_begin[col];
+      _col_begin[col] = write_pos;
+      for (size_t pos = read_begin; pos != next_free[col]; ++pos) {
+         _col_row[write_pos] = _col_row[pos];
+         _col_val[write_pos] = _col_val[pos];
+         ++write_pos;
+      }
+   }
+   _col_begin[_num_columns] = write_pos;
+   _col_row.resize(write_pos);
+   _col_val.resize(write_pos);
+
+   double sense = model.direction == LP_Provider::Min ? 1.0 : model.direction == LP_Provider::Max ? -1.0 : 0.0;
+   _cost.assign(num_total(), 0.0);
+   _perturbed_cost.assign(num_total(), 0.0);
+   for (VarID col = 0; col != _num_columns; ++col) {
+      _cost[col] = sense * model.objective[col];
+      _perturbed_cost[col] = _cost[col];
+      if (model.is_binary(col)) {
+         _perturbed_cost[col] += PERTURBATION * (1.0 + std::abs(_cost[col])) * (1.0 + perturbation_weight(col));
+      }
+      _lower[col] = model.lower[col];
+      _upper[col] = model.upper[col];
+   }
+   _artificial_upper.assign(num_total(), false);
+   _alpha_row.resize(num_total());
+   _alpha_col.resize(_num_rows);
+   _work.resize(_num_rows);
+   reset_to_slack_basis();
+}
+
+void DualSimplex::set_bounds(VarID col, double lb, double ub) {
+   _lower[col] = lb;
+   _upper[col] = ub;
+   _artificial_upper[col] = false;
+}
+
+void DualSimplex::add_rows(const ConstraintMatrix &rows) {
+   size_t num_old_rows = _num_rows;
+   size_t num_new_rows = rows.num_rows();
+   if (num_new_rows == 0) {
+      return;
+   }
+   // the entries of the new rows go at the end of their columns, merged if a column repeats in a row
+   std::vector<size_t> num_added(_num_columns, 0);
+   for (size_t new_idx = 0; new_idx != num_new_rows; ++new_idx) {
+      for (VarIdxCoeffPair entry: rows.row(new_idx).lhs) {
+         ++num_added[entry.var_idx];
+      }
+   }
+   std::vector<size_t> col_begin(_num_columns + 1, 0);
+   for (VarID col = 0; col != _num_columns; ++col) {
+      col_begin[col + 1] = col_begin[col] + (_col_begin[col + 1] - _col_begin[col]) + num_added[col];
+   }
+   std::vector<size_t> col_row(col_begin.back());
+   std::vector<double> col_val(col_begin.back());
+   std::vector<size_t> next_free(_num_columns);
+   for (VarID col = 0; col != _num_columns; ++col) {
+      next_free[col] = col_begin[col];
+      for (size_t pos = _col_begin[col]; pos != _col_begin[col + 1]; ++pos) {
+         col_row[next_free[col]] = _col_row[pos];
+         col_val[next_free[col]] = _col_val[pos];
+         ++next_free[col];
+      }
+   }
+   for (size_t new_idx = 0; new_idx != num_new_rows; ++new_idx) {
+      size_t row_idx = num_old_rows + new_idx;
+      for (VarIdxCoeffPair entry: rows.row(new_idx).lhs) {
+         size_t &pos = next_free[entry.var_idx];
+         if (pos != col_begin[entry.var_idx] and col_row[pos - 1] == row_idx) {
+            col_val[pos - 1] += entry.coeff;
+         } else {
+            col_row[pos] = row_idx;
+            col_val[pos] = entry.coeff;
+            ++pos;
+         }
+      }
+   }
+   // remove the holes left by merged entries
+   size_t write_pos = 0;
+   for (VarID col = 0; col != _num_columns; ++col) {
+      size_t read_begin = col_begin[col];
+      col_begin[col] = write_pos;
+      for (size_t pos = read_begin; pos != next_free[col]; ++pos) {
+         col_row[write_pos] = col_row[pos];
+         col_val[write_pos] = col_val[pos];
+         ++write_pos;
+      }
+   }
+   col_begin[_num_columns] = write_pos;
+   col_row.resize(write_pos);
+   col_val.resize(write_pos);
+   _col_begin = std::move(col_begin);
+   _col_row = std::move(col_row);
+   _col_val = std::move(col_val);
+
+   _num_rows += num_new_rows;
+   for (size_t new_idx = 0; new_idx != num_new_rows; ++new_idx) {
+      ConstraintMatrix::RowView row = rows.row(new_idx);
+      _rhs.push_back(row.rhs);
+      _lower.push_back(row.rel == ConstraintSink::Geq ? -INF : 0.0);
+      _upper.push_back(row.rel == ConstraintSink::Leq ? INF : 0.0);
+      _cost.push_back(0.0);
+      _perturbed_cost.push_back(0.0);
+      _artificial_upper.push_back(false);
+      _status.push_back(Basic);
+      _basic.push_back(num_total() - num_new_rows + new_idx);
+      _d.push_back(0.0);
+      // the slack closes the row at the current point; its bounds are restored by the next solve
+      double slack_value = row.rhs;
+      for (VarIdxCoeffPair entry: row.lhs) {
+         slack_value -= entry.coeff * _x[entry.var_idx];
+      }
+      _x.push_back(slack_value);
+   }
+
+   _alpha_row.resize(num_total());
+   _alpha_col.resize(_num_rows);
+   _work.resize(_num_rows);
+   // the basis gets the new slacks, and stays nonsingular
+   if (not refactor()) {
+      reset_to_slack_basis();
+   }
+}
+
+void DualSimplex::get_values(std::vector<double> &values) const {
+   values.assign(_x.begin(), _x.begin() + _num_columns);
+}
+
+double DualSimplex::objective() const {
+   double value = 0.0;
+   for (VarID col = 0; col != _num_columns; ++col) {
+      value += _cost[col] * _x[col];
+   }
+   return value;
+}
+
+double DualSimplex::dual_bound() const {
+   // Lagrangian bound with the duals of the perturbed problem and the original costs
+   double bound = 0.0;
+   std::vector<double> slack_lowest;  // computed for the first slack that needs them
+   std::vector<double> slack_highest;
+   for (VarID var = 0; var != num_total(); ++var) {
+      bound += _perturbed_cost[var] * _x[var];
+   }
+   for (VarID var = 0; var != num_total(); ++var) {
+      double perturbation = _perturbed_cost[var] - _cost[var];
+      double reduced_cost = _d[var] - perturbation;
+      if (std::abs(reduced_cost) <= DUAL_TOLERANCE) {
+         reduced_cost = 0.0;
+      }
+      double upper = _artificial_upper[var] ? INF : _upper[var];
+      double best_value = reduced_cost > 0.0 ? _lower[var] : reduced_cost < 0.0 ? upper : 0.0;
+      if (std::isinf(best_value)) {
+         // the ratio test and the refactors leave reduced costs a little off: a slack still has a finite bound
+         if (var < _num_columns) {
+            return -INF;
+         }
+         if (slack_lowest.empty()) {
+            slack_ranges(slack_lowest, slack_highest);
+         }
+         best_value = reduced_cost > 0.0 ? slack_lowest[var - _num_columns] : slack_highest[var - _num_columns];
+         if (std::isinf(best_value)) {
+            return -INF;
+         }
+      }
+      bound += reduced_cost * best_value - _d[var] * _x[var];
+   }
+   return bound;
+}
+
+void DualSimplex::slack_ranges(std::vector<double> &lowest, std::vector<double> &highest) const {
+   // the slack of a row is b - a x
+   lowest = _rhs;
+   highest = _rhs;
+   for (VarID col = 0; col != _num_columns; ++col) {
+      double upper = _artificial_upper[col] ? INF : _upper[col];
+      for (size_t pos = _col_begin[col]; pos != _col_begin[col + 1]; ++pos) {
+         double coeff = _col_val[pos];
+         lowest[_col_row[pos]] -= coeff * (coeff > 0.0 ? upper : _lower[col]);
+         highest[_col_row[pos]] -= coeff * (coeff > 0.0 ? _lower[col] : upper);
+      }
+   }
+}
+
+void DualSimplex::place_nonbasic(VarID var) {
+   if (_artificial_upper[var]) {
+      _upper[var] = INF;
+      _artificial_upper[var] = false;
+   }
+   if (_lower[var] == _upper[var]) {
+      _status[var] = AtLower;
+      _x[var] = _lower[var];
+   } else if (_status[var] == AtLower and not std::isinf(_lower[var]) and _d[var] >= -DUAL_TOLERANCE) {
+      _x[var] = _lower[var];
+   } else if (_status[var] == AtUpper and not std::isinf(_upper[var]) and _d[var] <= DUAL_TOLERANCE) {
+      _x[var] = _upper[var];
+   } else if (_d[var] >= 0.0) {
+      if (not std::isinf(_lower[var])) {
+         _status[var] = AtLower;
+         _x[var] = _lower[var];
+      } else if (not std::isinf(_upper[var])) {
+         _status[var] = AtUpper;
+         _x[var] = _upper[var];
+      } else {
+         _status[var] = AtZero;
+         _x[var] = 0.0;
+      }
+   } else {
+      if (std::isinf(_upper[var])) {
+         _upper[var] = std::max(ARTIFICIAL_BOUND, _lower[var] + ARTIFICIAL_BOUND);
+         _artificial_upper[var] = true;
+      }
+      _status[var] = AtUpper;
+      _x[var] = _upper[var];
+   }
+}
+
+void DualSimplex::recompute_primal() {
+   std::vector<double> &residual = _work;
+   residual = _rhs;
+   for (VarID col = 0; col != _num_columns; ++col) {
+      if (_status[col] != Basic and _x[col] != 0.0) {
+         for (size_t pos = _col_begin[col]; pos != _col_begin[col + 1]; ++pos) {
+            residual[_col_row[pos]] -= _col_val[pos] * _x[col];
+         }
+      }
+   }
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      VarID slack = _num_columns + row_idx;
+      if (_status[slack] != Basic) {
+         residual[row_idx] -= _x[slack];
+      }
+   }
+   ftran(residual);
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      _x[_basic[row_idx]] = residual[row_idx];
+   }
+}
+
+void DualSimplex::recompute_duals() {
+   std::vector<double> &duals = _work;
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      duals[row_idx] = _perturbed_cost[_basic[row_idx]];
+   }
+   btran(duals);
+   for (VarID col = 0; col != _num_columns; ++col) {
+      double value = _perturbed_cost[col];
+      for (size_t pos = _col_begin[col]; pos != _col_begin[col + 1]; ++pos) {
+         value -= duals[_col_row[pos]] * _col_val[pos];
+      }
+      _d[col] = _status[col] == Basic ? 0.0 : value;
+   }
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      VarID slack = _num_columns + row_idx;
+      _d[slack] = _status[slack] == Basic ? 0.0 : -duals[row_idx];
+   }
+}
+
+bool DualSimplex::refactor() {
+   clear_etas();
+   // the basic slacks keep their own rows, the basic structural columns are pivoted into the rows of the others
+   std::vector<VarID> columns;
+   for (VarID var: _basic) {
+      if (var < _num_columns) {
+         columns.push_back(var);
+      }
+   }
+   std::vector<bool> free_row(_num_rows);
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      VarID slack = _num_columns + row_idx;
+      _basic[row_idx] = slack;
+      free_row[row_idx] = _status[slack] != Basic;
+   }
+   // the sparsest columns first, which keeps the etas short
+   std::sort(columns.begin(), columns.end(), [this](VarID first, VarID second) {
+      size_t first_size = _col_begin[first + 1] - _col_begin[first];
+      size_t second_size = _col_begin[second + 1] - _col_begin[second];
+      return first_size < second_size or (first_size == second_size and first < second);
+   });
+   std::vector<double> &column = _work;
+   for (VarID col: columns) {
+      column.assign(_num_rows, 0.0);
+      for (size_t pos = _col_begin[col]; pos != _col_begin[col + 1]; ++pos) {
+         column[_col_row[pos]] = _col_val[pos];
+      }
+      ftran(column);
+      size_t pivot_row = _num_rows;
+      double max_value = SINGULAR_TOLERANCE;
+      for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+         if (free_row[row_idx] and std::abs(column[row_idx]) > max_value) {
+            max_value = std::abs(column[row_idx]);
+            pivot_row = row_idx;
+         }
+      }
+      if (pivot_row == _num_rows) {
+         return false;
+      }
+      push_eta(pivot_row, column);
+      free_row[pivot_row] = false;
+      _basic[pivot_row] = col;
+   }
+   _num_factor_etas = _eta_row.size();
+   return true;
+}
+
+void DualSimplex::clear_etas() {
+   _eta_row.clear();
+   _eta_pivot.clear();
+   _eta_begin.assign(1, 0);
+   _eta_index.clear();
+   _eta_value.clear();
+   _num_factor_etas = 0;
+}
+
+void DualSimplex::push_eta(size_t row_idx, const std::vector<double> &column) {
+   _eta_row.push_back(row_idx);
+   _eta_pivot.push_back(column[row_idx]);
+   for (size_t k = 0; k != _num_rows; ++k) {
+      if (k != row_idx and std::abs(column[k]) > ETA_TOLERANCE) {
+         _eta_index.push_back(k);
+         _eta_value.push_back(column[k]);
+      }
+   }
+   _eta_begin.push_back(_eta_index.size());
+}
+
+void DualSimplex::ftran(std::vector<double> &column) const {
+   for (size_t eta = 0; eta != _eta_row.size(); ++eta) {
+      double &pivot_value = column[_eta_row[eta]];
+      if (pivot_value == 0.0) {
+         continue;
+      }
+      pivot_value /= _eta_pivot[eta];
+      for (size_t pos = _eta_begin[eta]; pos != _eta_begin[eta + 1]; ++pos) {
+         column[_eta_index[pos]] -= _eta_value[pos] * pivot_value;
+      }
+   }
+}
+
+void DualSimplex::btran(std::vector<double> &row) const {
+   for (size_t eta = _eta_row.size(); eta-- != 0;) {
+      double value = row[_eta_row[eta]];
+      for (size_t pos = _eta_begin[eta]; pos != _eta_begin[eta + 1]; ++pos) {
+         value -= _eta_value[pos] * row[_eta_index[pos]];
+      }
+      row[_eta_row[eta]] = value / _eta_pivot[eta];
+   }
+}
+
+void DualSimplex::reset_to_slack_basis() {
+   _status.assign(num_total(), AtLower);
+   _basic.resize(_num_rows);
+   clear_etas();
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      _basic[row_idx] = _num_columns + row_idx;
+      _status[_num_columns + row_idx] = Basic;
+   }
+   _x.assign(num_total(), 0.0);
+   _d.assign(num_total(), 0.0);
+   for (VarID col = 0; col != _num_columns; ++col) {
+      _d[col] = _perturbed_cost[col];
+      place_nonbasic(col);
+   }
+}
+
+double DualSimplex::primal_residual() const {
+   std::vector<double> residual = _rhs;
+   for (VarID col = 0; col != _num_columns; ++col) {
+      for (size_t pos = _col_begin[col]; pos != _col_begin[col + 1]; ++pos) {
+         residual[_col_row[pos]] -= _col_val[pos] * _x[col];
+      }
+   }
+   double max_residual = 0.0;
+   for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+      max_residual = std::max(max_residual, std::abs(residual[row_idx] - _x[_num_columns + row_idx]));
+   }
+   return max_residual;
+}
+
+void DualSimplex::compute_alpha_row(size_t row_idx) {
+   std::vector<double> &rho = _work;
+   rho.assign(_num_rows, 0.0);
+   rho[row_idx] = 1.0;
+   btran(rho);
+   for (VarID col = 0; col != _num_columns; ++col) {
+      double value = 0.0;
+      if (_status[col] != Basic) {
+         for (size_t pos = _col_begin[col]; pos != _col_begin[col + 1]; ++pos) {
+            value += rho[_col_row[pos]] * _col_val[pos];
+         }
+      }
+      _alpha_row[col] = value;
+   }
+   for (size_t k = 0; k != _num_rows; ++k) {
+      _alpha_row[_num_columns + k] = _status[_num_columns + k] == Basic ? 0.0 : rho[k];
+   }
+}
+
+void DualSimplex::compute_alpha_col(VarID var) {
+   _alpha_col.assign(_num_rows, 0.0);
+   if (var >= _num_columns) {
+      _alpha_col[var - _num_columns] = 1.0;
+   } else {
+      for (size_t pos = _col_begin[var]; pos != _col_begin[var + 1]; ++pos) {
+         _alpha_col[_col_row[pos]] = _col_val[pos];
+      }
+   }
+   ftran(_alpha_col);
+}
+
+void DualSimplex::pivot(size_t row_idx, VarID entering, double delta) {
+   VarID leaving = _basic[row_idx];
+   double theta_dual = _d[entering] / _alpha_row[entering];
+   for (VarID var = 0; var != num_total(); ++var) {
+      if (_status[var] != Basic and _alpha_row[var] != 0.0) {
+         _d[var] -= theta_dual * _alpha_row[var];
+      }
+   }
+   _d[leaving] = -theta_dual;
+   _d[entering] = 0.0;
+
+   double theta_primal = delta / _alpha_col[row_idx];
+   for (size_t basis_idx = 0; basis_idx != _num_rows; ++basis_idx) {
+      _x[_basic[basis_idx]] -= theta_primal * _alpha_col[basis_idx];
+   }
+   _x[entering] += theta_primal;
+   _status[leaving] = delta < 0.0 ? AtLower : AtUpper;
+   _x[leaving] = delta < 0.0 ? _lower[leaving] : _upper[leaving];
+   _status[entering] = Basic;
+   _basic[row_idx] = entering;
+
+   // B^-1 <- E B^-1
+   push_eta(row_idx, _alpha_col);
+}
+
+DualSimplex::Status DualSimplex::solve(size_t max_iterations, std::chrono::steady_clock::time_point deadline) {
+   for (VarID var = 0; var != num_total(); ++var) {
+      if (_status[var] != Basic) {
+         place_nonbasic(var);
+      }
+   }
+   recompute_primal();
+   bool has_deadline = deadline != std::chrono::steady_clock::time_point::max();
+   for (size_t iteration = 0; iteration != max_iterations; ++iteration) {
+      if (has_deadline and iteration % DEADLINE_FREQUENCY == 0 and std::chrono::steady_clock::now() >= deadline) {
+         return TimeLimit;
+      }
+      if (_eta_row.size() - _num_factor_etas >= REFACTOR_FREQUENCY or
+          (iteration % CHECK_FREQUENCY == CHECK_FREQUENCY - 1 and primal_residual() > RESIDUAL_TOLERANCE)) {
+         if (not refactor()) {
+            reset_to_slack_basis();
+         }
+         recompute_duals();
+         recompute_primal();
+      }
+
+      // leaving variable: the basic variable with the largest bound violation
+      size_t leaving_row = _num_rows;
+      double max_violation = PRIMAL_TOLERANCE;
+      for (size_t row_idx = 0; row_idx != _num_rows; ++row_idx) {
+         VarID var = _basic[row_idx];
+         double violation = std::max(_lower[var] - _x[var], _x[var] - _upper[var]);
+         if (violation > max_violation) {
+            max_violation = violation;
+            leaving_row = row_idx;
+         }
+      }
+      if (leaving_row == _num_rows) {
+         for (VarID var = 0; var != num_total(); ++var) {
+            if (_artificial_upper[var] and _x[var] >= 0.5 * _upper[var]) {
+               return Unbounded;
+            }
+         }
+         return Optimal;
+      }
+      VarID leaving = _basic[leaving_row];
+      double delta = _x[leaving] < _lower[leaving] ? _x[leaving] - _lower[leaving] : _x[leaving] - _upper[leaving];
+
+      // Harris ratio test: the largest step allowed by the relaxed dual bounds, then the largest pivot within it
+      compute_alpha_row(leaving_row);
+      double max_step = INF;
+      bool has_candidate = false;
+      for (VarID var = 0; var != num_total(); ++var) {
+         if (_status[var] == Basic or _lower[var] == _upper[var]) {
+            continue;
+         }
+         double alpha = delta < 0.0 ? -_alpha_row[var] : _alpha_row[var];
+         if ((_status[var] == AtLower and alpha > PIVOT_TOLERANCE) or
+             (_status[var] == AtZero and alpha > PIVOT_TOLERANCE)) {
+            max_step = std::min(max_step, (_d[var] + DUAL_TOLERANCE) / alpha);
+            has_candidate = true;
+         } else if ((_status[var] == AtUpper and alpha < -PIVOT_TOLERANCE) or
+                    (_status[var] == AtZero and alpha < -PIVOT_TOLERANCE)) {
+            max_step = std::min(max_step, (_d[var] - DUAL_TOLERANCE) / alpha);
+            has_candidate = true;
+         }
+      }
+      if (not has_candidate) {
+         return Infeasible;
+      }
+      VarID entering = num_total();
+      double best_alpha = 0.0;
+      for (VarID var = 0; var != num_total(); ++var) {
+         if (_status[var] == Basic or _lower[var] == _upper[var]) {
+            continue;
+         }
+         double alpha = delta < 0.0 ? -_alpha_row[var] : _alpha_row[var];
+         bool candidate = ((_status[var] == AtLower or _status[var] == AtZero) and alpha > PIVOT_TOLERANCE) or
+                          ((_status[var] == AtUpper or _status[var] == AtZero) and alpha < -PIVOT_TOLERANCE);
+         if (candidate and _d[var] / alpha <= max_step and std::abs(alpha) > best_alpha) {
+            best_alpha = std::abs(alpha);
+            entering = var;
+         }
+      }
+
+      compute_alpha_col(entering);
+      double row_pivot = _alpha_row[entering];
+      double col_pivot = _alpha_col[leaving_row];
+      if (std::abs(row_pivot - col_pivot) > 1e-7 * (1.0 + std::abs(row_pivot))) {
+         // the row and the column disagree on the pivot: the etas have lost precision
+         if (not refactor()) {
+            reset_to_slack_basis();
+         }
+         recompute_duals();
+         recompute_primal();
+         continue;
+      }
+      pivot(leaving_row, entering, delta);
+      ++_total_iterations;
+   }
+   return IterationLimit;
+}
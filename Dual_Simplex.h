@@ -0,0 +1,141 @@
+#ifndef SCHEDULE_HIGHSCHOOL_DUAL_SIMPLEX_H
+#define SCHEDULE_HIGHSCHOOL_DUAL_SIMPLEX_H
+
+#include <chrono>
+#include <vector>
+#include "MIP_Model.h"
+
+// Bounded-variable dual simplex on the LP relaxation of a MIP_Model, with the basis inverse in product form: a file of
+// sparse eta columns, one for every pivot, which is rebuilt from the basic columns every few dozen pivots.
+// Every row gets a slack, so that the rows become [A I] x = b with the relation moved into the bounds of the slack.
+// The costs of the binary columns are slightly perturbed against dual degeneracy; objective() and dual_bound() are
+// always given with the original costs, and in the minimization sense (the costs of a Max model are negated).
+// Once a basis is optimal it stays dual feasible when the bounds change, so the solver can be re-run after
+// set_bounds without starting from scratch: this is what branch-and-bound does at every node
+class DualSimplex {
+public:
+   typedef Variables::VarID VarID;
+
+   enum Status {
+      Optimal, Infeasible, Unbounded, IterationLimit, TimeLimit
+   };
+
+   explicit DualSimplex(const MIP_Model &model);
+
+   [[nodiscard]] size_t num_columns() const { return _num_columns; }
+
+   [[nodiscard]] size_t num_rows() const { return _num_rows; }
+
+   // changes the bounds of the structural column @p col
+   void set_bounds(VarID col, double lb, double ub);
+
+   [[nodiscard]] double get_lower(VarID col) const { return _lower[col]; }
+
+   [[nodiscard]] double get_upper(VarID col) const { return _upper[col]; }
+
+   // appends @p rows, each with its slack basic, so that the basis stays dual feasible and the next solve goes on
+   // from it. Their columns must be structural
+   void add_rows(const ConstraintMatrix &rows);
+
+   // stops with TimeLimit once @p deadline has passed, checked every few pivots
+   Status solve(size_t max_iterations,
+                std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+   // objective of the current point, with the original costs and in the minimization sense
+   [[nodiscard]] double objective() const;
+
+   // a lower bound, in the minimization sense, on the objective of every point within the bounds. The basis is dual
+   // feasible after every pivot, so the bound is also valid after IterationLimit and TimeLimit
+   [[nodiscard]] double dual_bound() const;
+
+   [[nodiscard]] double value(VarID col) const { return _x[col]; }
+
+   // the values of the structural columns
+   void get_values(std::vector<double> &values) const;
+
+   [[nodiscard]] size_t total_iterations() const { return _total_iterations; }
+
+private:
+   enum VarStatus : unsigned char {
+      Basic, AtLower, AtUpper, AtZero
+   };
+
+   [[nodiscard]] size_t num_total() const { return _num_columns + _num_rows; }
+
+   // puts the nonbasic variable @p var on the bound that keeps its reduced cost dual feasible
+   void place_nonbasic(VarID var);
+
+   // x_B = B^-1 (b - N x_N)
+   void recompute_primal();
+
+   // d = c - (c_B B^-1) A
+   void recompute_duals();
+
+   // rebuilds the eta file from the basic columns, which may move to other rows. Returns false if the basis is
+   // singular
+   bool refactor();
+
+   void clear_etas();
+
+   // appends the eta of a pivot on row @p row_idx, with @p column the entering column times B^-1
+   void push_eta(size_t row_idx, const std::vector<double> &column);
+
+   // @p column <- B^-1 @p column
+   void ftran(std::vector<double> &column) const;
+
+   // @p row <- @p row B^-1
+   void btran(std::vector<double> &row) const;
+
+   // goes back to the all-slack basis, which is dual feasible since the perturbed costs are non-negative
+   void reset_to_slack_basis();
+
+   // the lowest and the highest value of the slack of every row within the bounds of the structural columns
+   void slack_ranges(std::vector<double> &lowest, std::vector<double> &highest) const;
+
+   // max_i |(b - A x)_i|
+   [[nodiscard]] double primal_residual() const;
+
+   // row @p row_idx of B^-1 A for the nonbasic variables, into _alpha_row
+   void compute_alpha_row(size_t row_idx);
+
+   // B^-1 a_var into _alpha_col
+   void compute_alpha_col(VarID var);
+
+   void pivot(size_t row_idx, VarID entering, double delta);
+
+   size_t _num_columns;
+   size_t _num_rows;
+   size_t _total_iterations;
+
+   // structural columns in compressed-sparse-column form; the slack of row i is the column e_i
+   std::vector<size_t> _col_begin;
+   std::vector<size_t> _col_row;
+   std::vector<double> _col_val;
+   std::vector<double> _rhs;
+
+   std::vector<double> _cost;  // original costs, minimization sense, zero for the slacks
+   std::vector<double> _perturbed_cost;
+   std::vector<double> _lower;
+   std::vector<double> _upper;
+   std::vector<bool> _artificial_upper;  // the upper bound is a large value standing for infinity
+
+   std::vector<VarID> _basic;  // _basic[i] is the variable basic in row i
+   std::vector<VarStatus> _status;
+   // B^-1 = E_k ... E_1, where E_j is the identity with column _eta_row[j] replaced by the eta of pivot j: the
+   // entering column, pivot excluded, is kept in _eta_index and _eta_value from _eta_begin[j]
+   std::vector<size_t> _eta_row;
+   std::vector<double> _eta_pivot;
+   std::vector<size_t> _eta_begin;
+   std::vector<size_t> _eta_index;
+   std::vector<double> _eta_value;
+   size_t _num_factor_etas;  // those written by the last refactor; the later ones are pivots
+   std::vector<double> _x;
+   std::vector<double> _d;
+
+   std::vector<double> _alpha_row;
+   std::vector<double> _alpha_col;
+   std::vector<double> _work;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_DUAL_SIMPLEX_H
@@ -2,12 +2,94 @@
 // Created by mich on 16/07/19.
 //
 
+#include <charconv>
+#include <cstring>
 #include <sstream>
 #include "Input.h"
+#include "Trace.h"
 
-unsigned int Input::total_num_hours_in_week = 0;
+namespace {
+void check_input_id(Input::ID id) {
+   if (id <= 0 or id >= Input::MAX_ID) {
+      throw std::logic_error(
+            "The index " + std::to_string(id) + " is not allowed. Indices should be in the interval [1," +
+            std::to_string(Input::MAX_ID) + ")");
+   }
+}
+
+bool is_blank(char c) {
+   return c == ' ' or c == '\t' or c == '\r' or c == '\n';
+}
+
+// Splits one line of the input into the tokens between blanks, without copying them. Its errors tell the line and
+// the column where they are found
+class LineTokenizer {
+public:
+   LineTokenizer(const char *line_begin_, const char *line_end_, size_t line_number_)
+         : _line_begin{line_begin_}, _line_end{line_end_}, _pos{line_begin_}, _line_number{line_number_} {}
+
+   // true if only blanks are left
+   bool at_end() {
+      skip_blanks();
+      return _pos == _line_end;
+   }
+
+   const char *position() const { return _pos; }
+
+   // skips one character, which at_end() has already shown
+   void skip_char() { ++_pos; }
+
+   std::string_view next(std::string_view what) {
+      if (at_end()) {
+         fail(_pos, "missing " + std::string(what));
+      }
+      const char *token_begin = _pos;
+      while (_pos != _line_end and not is_blank(*_pos)) {
+         ++_pos;
+      }
+      return std::string_view(token_begin, _pos - token_begin);
+   }
 
-Input::Input(std::istream &is) {
+   template<typename T>
+   T number(std::string_view what) {
+      std::string_view token = next(what);
+      T value{};
+      std::from_chars_result result = std::from_chars(token.data(), token.data() + token.size(), value);
+      if (result.ec != std::errc() or result.ptr != token.data() + token.size()) {
+         fail(token.data(), "invalid " + std::string(what) + " '" + std::string(token) + "'");
+      }
+      return value;
+   }
+
+   void expect_end(std::string_view record) {
+      if (not at_end()) {
+         fail(_pos, "unexpected '" + std::string(next("token")) + "' at the end of the " + std::string(record));
+      }
+   }
+
+   [[noreturn]] void fail(const char *at, const std::string &message) const {
+      throw std::logic_error("line " + std::to_string(_line_number) + ", column " +
+                             std::to_string(at - _line_begin + 1) + ": " + message);
+   }
+
+private:
+   void skip_blanks() {
+      while (_pos != _line_end and is_blank(*_pos)) {
+         ++_pos;
+      }
+   }
+
+   const char *_line_begin;
+   const char *_line_end;
+   const char *_pos;
+   size_t _line_number;
+};
+}
+
+Input::Input() : _class_pos(MAX_ID, InvalidID), _teacher_pos(MAX_ID, InvalidID),
+                 _requirement_pos_per_teacher(MAX_ID) {}
+
+Input::Input(std::istream &is) : Input() {
    check_nonzero_day();
    read_file(is);
    check_indices();
@@ -15,6 +97,54 @@ Input::Input(std::istream &is) {
    record_requirements();
 }
 
+Input::Input(const char *begin, const char *end) : Input() {
+   check_nonzero_day();
+   read_buffer(begin, end);
+   check_indices();
+   set_allow_extra_pairs();
+   record_requirements();
+}
+
+Input::Input(const Input &input, const std::vector<unsigned int> &class_positions) : Input() {
+   std::vector<bool> has_class(input.num_classes(), false);
+   for (unsigned int class_pos: class_positions) {
+      has_class[class_pos] = true;
+   }
+   std::vector<bool> has_teacher(input.num_teachers(), false);
+   for (const Requirement &requirement: input._requirements) {
+      if (has_class[input.convert_from_class_id(requirement.class_id())]) {
+         has_teacher[input.convert_from_teacher_id(requirement.teacher_id())] = true;
+      }
+   }
+   for (unsigned int class_pos = 0; class_pos != input.num_classes(); ++class_pos) {
+      if (has_class[class_pos]) {
+         Class school_class = input._classes[class_pos];
+         school_class.requirements.clear();
+         add_class(school_class);
+      }
+   }
+   for (unsigned int teacher_pos = 0; teacher_pos != input.num_teachers(); ++teacher_pos) {
+      if (has_teacher[teacher_pos]) {
+         Teacher teacher = input._teachers[teacher_pos];
+         teacher.requirements.clear();
+         add_teacher(teacher);
+      }
+   }
+   for (const Requirement &requirement: input._requirements) {
+      if (has_class[input.convert_from_class_id(requirement.class_id())]) {
+         add_requirement(requirement);
+      }
+   }
+   check_indices();
+   set_allow_extra_pairs();
+   record_requirements();
+}
+
+Input::Class::Class(ID id_, std::string name_, const std::array<unsigned int, NUM_DAYS_PER_WEEK> &num_hours_per_day_)
+      : id{id_}, name{std::move(name_)}, num_hours_per_day{num_hours_per_day_} {
+   check_input_id(id);
+}
+
 Input::Class::Class(const std::string &input) : id{0}, num_hours_per_day{0, 0, 0, 0, 0, 0} {
    std::stringstream stream(input);
    char c;
@@ -22,11 +152,7 @@ Input::Class::Class(const std::string &input) : id{0}, num_hours_per_day{0, 0, 0
    if (c != input_signal) {
       throw std::logic_error("The input string for Class is not a class string");
    }
-   if (id <= 0 or id >= MAX_ID) {
-      throw std::logic_error(
-            "The index " + std::to_string(id) + " is not allowed. Indices should be in the interval [1," +
-            std::to_string(MAX_ID) + ")");
-   }
+   check_input_id(id);
    for (unsigned int day = 0; day != NUM_DAYS_PER_WEEK; ++day) {
       if (stream.rdbuf()->in_avail() <= 0) {
          throw std::logic_error(
@@ -40,30 +166,41 @@ Input::Class::Class(const std::string &input) : id{0}, num_hours_per_day{0, 0, 0
    }
 }
 
-Input::Teacher::Teacher(const std::string &input) : id{0}, penalties(NUM_DAYS_PER_WEEK), num_days_available{0} {
+Input::Teacher::Teacher(ID id_, std::string name_, const WeekGrid<int> &penalties_)
+      : id{id_}, name{std::move(name_)}, penalties{penalties_}, num_days_available{0} {
+   check_input_id(id);
+   id *= MAX_ID;  // so it is different from the class id
+   convert_penalties();
+}
+
+Input::Teacher::Teacher(const std::string &input) : id{0}, penalties(0), num_days_available{0} {
    std::stringstream stream(input);
    char c;
    stream >> c >> id >> name;
    if (c != input_signal) {
       throw std::logic_error("The input string for Teacher is not a teacher string");
    }
-   if (id <= 0 or id >= MAX_ID) {
+   check_input_id(id);
+   id *= MAX_ID;  // so it is different from the class id
+   for (int &hour: penalties) {
+      if (stream.rdbuf()->in_avail() <= 0) {
+         throw std::logic_error(
+               "Too few penalty inputs for teacher" + name + ": required " + std::to_string(WeekShape::NUM_SLOTS));
+      }
+      stream >> hour;
+   }
+   if (stream.rdbuf()->in_avail() > 0) {
       throw std::logic_error(
-            "The index " + std::to_string(id) + " is not allowed. Indices should be in the interval [1," +
-            std::to_string(MAX_ID) + ")");
+            "Too many penalty inputs for teacher" + name + ": required " + std::to_string(WeekShape::NUM_SLOTS));
    }
-   id *= MAX_ID;  // so it is different from the class id
+   convert_penalties();
+}
+
+void Input::Teacher::convert_penalties() {
    unsigned int sum = 0;
    for (unsigned int day = 0; day != NUM_DAYS_PER_WEEK; ++day) {
       bool add_day = false;
-      penalties[day].resize(NUM_HOURS_PER_DAY[day], 0);
-      for (int &hour: penalties[day]) {
-         if (stream.rdbuf()->in_avail() <= 0) {
-            throw std::logic_error(
-                  "Too few penalty inputs for teacher" + name + ": required " +
-                  std::to_string(total_num_hours_in_week));
-         }
-         stream >> hour;
+      for (int &hour: penalties.day(day)) {
          if (hour < 0) {
             hour = InvalidPenality;
          } else {
@@ -75,15 +212,21 @@ Input::Teacher::Teacher(const std::string &input) : id{0}, penalties(NUM_DAYS_PE
          ++num_days_available;
       }
    }
-   if (stream.rdbuf()->in_avail() > 0) {
-      throw std::logic_error(
-            "Too many penalty inputs for teacher" + name + ": required " + std::to_string(total_num_hours_in_week));
-   }
    if (sum > 50) {
       throw std::logic_error("Teacher " + name + " sum of penalties is > 50");
    }
 }
 
+Input::Requirement::Requirement(ID teacher_id_, ID class_id_, std::string_view lessons_code,
+                                unsigned int num_days_with_cons_hours_)
+      : id{0}, num_days_with_cons_hours{num_days_with_cons_hours_}, allow_extra_pairs{false},
+        average_lesson_weight{0.0} {
+   check_input_id(teacher_id_);
+   check_input_id(class_id_);
+   id = teacher_id_ * MAX_ID + class_id_;
+   set_lessons(lessons_code);
+}
+
 Input::Requirement::Requirement(const std::string &input)
       : id{0}, num_days_with_cons_hours{0}, allow_extra_pairs{false}, average_lesson_weight{0.0} {
    std::stringstream stream(input);
@@ -94,30 +237,26 @@ Input::Requirement::Requirement(const std::string &input)
    if (c != input_signal) {
       throw std::logic_error("The input string for Requirement is not a teacher string");
    }
-   if (teacher_id <= 0 or teacher_id >= MAX_ID) {
-      throw std::logic_error(
-            "The index " + std::to_string(teacher_id) + " is not allowed. Indices should be in the interval [1," +
-            std::to_string(MAX_ID) + ")");
-   }
-   if (class_id <= 0 or class_id >= MAX_ID) {
-      throw std::logic_error(
-            "The index " + std::to_string(class_id) + " is not allowed. Indices should be in the interval [1," +
-            std::to_string(MAX_ID) + ")");
-   }
+   check_input_id(teacher_id);
+   check_input_id(class_id);
    id = teacher_id * MAX_ID + class_id;
    if (stream.rdbuf()->in_avail() > 0) {
       stream >> num_days_with_cons_hours;
    }
+   set_lessons(s);
+}
+
+void Input::Requirement::set_lessons(std::string_view lessons_code) {
    int counter = 0;
-   for (unsigned int idx = 0; idx != s.length(); ++idx) {
-      if (s[idx] >= 'A' and s[idx] <= 'Z') {
-         lessons += std::string(std::max(counter, 1), s[idx]);
+   for (char code: lessons_code) {
+      if (code >= 'A' and code <= 'Z') {
+         lessons.append(std::max(counter, 1), code);
          counter = 0;
-      } else if (s[idx] >= 'a' and s[idx] <= 'z') {
-         lessons += std::string(std::max(counter, 1), s[idx] - 'a' + 'A');
+      } else if (code >= 'a' and code <= 'z') {
+         lessons.append(std::max(counter, 1), static_cast<char>(code - 'a' + 'A'));
          counter = 0;
-      } else if (s[idx] >= '0' and s[idx] <= '9') {
-         counter = 10 * counter + s[idx] - '0';
+      } else if (code >= '0' and code <= '9') {
+         counter = 10 * counter + code - '0';
       }
    }
    for(char l: lessons) {
@@ -134,18 +273,18 @@ Input::Requirement::Requirement(const std::string &input)
 
 
 const Input::Class *Input::find_class(ID id) const {
-   const auto &map_point = _class_id_map.find(id);
-   return map_point == _class_id_map.end() ? nullptr : &_classes[map_point->second];
+   ID vector_id = convert_from_class_id(id);
+   return vector_id == InvalidID ? nullptr : &_classes[vector_id];
 }
 
 const Input::Teacher *Input::find_teacher(ID id) const {
-   const auto &map_point = _teacher_id_map.find(id);
-   return map_point == _teacher_id_map.end() ? nullptr : &_teachers[map_point->second];
+   ID vector_id = convert_from_teacher_id(id);
+   return vector_id == InvalidID ? nullptr : &_teachers[vector_id];
 }
 
 const Input::Requirement *Input::find_requirement(ID requirement_id) const {
-   const auto &map_point = _requirement_id_map.find(requirement_id);
-   return map_point == _requirement_id_map.end() ? nullptr : &_requirements[map_point->second];
+   ID vector_id = convert_from_requirement_id(requirement_id);
+   return vector_id == InvalidID ? nullptr : &_requirements[vector_id];
 }
 
 const Input::Requirement *Input::find_requirement(ID teacher_id, ID class_id) const {
@@ -153,18 +292,28 @@ const Input::Requirement *Input::find_requirement(ID teacher_id, ID class_id) co
 }
 
 Input::ID Input::convert_from_class_id(Input::ID class_id) const {
-   const auto &map_point = _class_id_map.find(class_id);
-   return map_point == _class_id_map.end() ? InvalidID : map_point->second;
+   return class_id >= 0 and class_id < MAX_ID ? _class_pos[class_id] : InvalidID;
 }
 
 Input::ID Input::convert_from_teacher_id(Input::ID teacher_id) const {
-   const auto &map_point = _teacher_id_map.find(teacher_id);
-   return map_point == _class_id_map.end() ? InvalidID : map_point->second;
+   if (teacher_id < 0 or teacher_id % MAX_ID != 0 or teacher_id / MAX_ID >= MAX_ID) {
+      return InvalidID;
+   }
+   return _teacher_pos[teacher_id / MAX_ID];
 }
+
 Input::ID Input::convert_from_requirement_id(Input::ID requirement_id) const {
-   const auto &map_point = _requirement_id_map.find(requirement_id);
-   return map_point == _requirement_id_map.end() ? InvalidID : map_point->second;
+   if (requirement_id < 0 or requirement_id / MAX_ID >= MAX_ID) {
+      return InvalidID;
+   }
+   for (ID requirement_pos: _requirement_pos_per_teacher[requirement_id / MAX_ID]) {
+      if (_requirements[requirement_pos].id == requirement_id) {
+         return requirement_pos;
+      }
+   }
+   return InvalidID;
 }
+
 Input::ID Input::convert_from_requirement_id(Input::ID teacher_id, Input::ID class_id) const {
    return convert_from_requirement_id(to_requirement_id(teacher_id, class_id));
 }
@@ -189,11 +338,7 @@ Input::Requirement *Input::find_requirement(ID teacher_id, ID class_id) {
    return vector_id < num_requirements() ? &_requirements[vector_id] : nullptr;
 }
 
-bool Input::add_class(const std::string &input) {
-   if (input.empty() or input[0] != Class::input_signal) {
-      return false;
-   }
-   Class new_class(input);
+bool Input::add_class(const Class &new_class) {
    const Class *other = find_class(new_class.id);
    if (other != nullptr) {
       if (other->name != new_class.name) {
@@ -207,35 +352,26 @@ bool Input::add_class(const std::string &input) {
       }
    }
    if (other == nullptr) {
-      _class_id_map.emplace(new_class.id, num_classes());
+      _class_pos[new_class.id] = num_classes();
       _classes.push_back(new_class);
       return true;
    }
    return false;
 }
 
-bool Input::add_teacher(const std::string &input) {
-   if (input.empty() or input[0] != Teacher::input_signal) {
-      return false;
-   }
-   Teacher new_teacher(input);
+bool Input::add_teacher(const Teacher &new_teacher) {
    const Teacher *other = find_teacher(new_teacher.id);
    if (other != nullptr) {
       if (other->name != new_teacher.name) {
          throw std::logic_error("Classes " + other->name + " and " + new_teacher.name + " both have id " +
                                 std::to_string(new_teacher.id / MAX_ID));
       }
-      for (unsigned int day = 0; day != NUM_DAYS_PER_WEEK; ++day) {
-         for (unsigned int hour = 0; hour != NUM_HOURS_PER_DAY[day]; ++hour) {
-            if (other->penalties[day][hour] != new_teacher.penalties[day][hour]) {
-               throw std::logic_error("Double definition of teacher " + new_teacher.name);
-            }
-         }
-
+      if (other->penalties != new_teacher.penalties) {
+         throw std::logic_error("Double definition of teacher " + new_teacher.name);
       }
    }
    if (other == nullptr) {
-      _teacher_id_map.emplace(new_teacher.id, num_teachers());
+      _teacher_pos[new_teacher.id / MAX_ID] = num_teachers();
       _teachers.push_back(new_teacher);
       return true;
    }
@@ -243,11 +379,7 @@ bool Input::add_teacher(const std::string &input) {
 }
 
 
-bool Input::add_requirement(const std::string &input) {
-   if (input.empty() or input[0] != Requirement::input_signal) {
-      return false;
-   }
-   Requirement new_requirement(input);
+bool Input::add_requirement(const Requirement &new_requirement) {
    const Requirement *other = find_requirement(new_requirement.id);
    if (other != nullptr) {
       if (other->num_lessons() != new_requirement.num_lessons()) {
@@ -262,7 +394,7 @@ bool Input::add_requirement(const std::string &input) {
       }
    }
    if (other == nullptr) {
-      _requirement_id_map.emplace(new_requirement.id, num_requirements());
+      _requirement_pos_per_teacher[new_requirement.id / MAX_ID].push_back(num_requirements());
       _requirements.push_back(new_requirement);
       return true;
    }
@@ -274,11 +406,11 @@ void Input::check_nonzero_day() const {
       if (NUM_HOURS_PER_DAY[day] == 0) {
          throw std::logic_error("Day has zero hours");
       }
-      total_num_hours_in_week += NUM_HOURS_PER_DAY[day];
    }
 }
 
 void Input::read_file(std::istream &is) {
+   TRACE_SCOPE("Input::read_file");
    std::string line;
 
    auto cut_line_extrema = [&]() -> std::string {
@@ -303,15 +435,15 @@ void Input::read_file(std::istream &is) {
       if (not cut_input_line.empty()) {
          switch (cut_input_line[0]) {
             case Class::input_signal: {
-               add_class(cut_input_line);
+               add_class(Class(cut_input_line));
                break;
             }
             case Teacher::input_signal: {
-               add_teacher(cut_input_line);
+               add_teacher(Teacher(cut_input_line));
                break;
             }
             case Requirement::input_signal: {
-               add_requirement(cut_input_line);
+               add_requirement(Requirement(cut_input_line));
                break;
             }
          }
@@ -319,47 +451,115 @@ void Input::read_file(std::istream &is) {
    }
 }
 
-void Input::check_indices() const {
-   for (const Class &cl: _classes) {
-      unsigned int residual_hours = 0;
-      for (unsigned int hour_in_day: cl.num_hours_per_day) {
-         residual_hours += hour_in_day;
-      }
-      if (residual_hours == 0) {
-         throw std::logic_error("Class " + cl.name + " has 0 hours on every day");
-      }
-      for (const Requirement &req: _requirements) {
-         if (req.class_id() == cl.id) {
-            residual_hours -= req.num_lessons();
+void Input::read_buffer(const char *begin, const char *end) {
+   TRACE_SCOPE("Input::read_buffer");
+   const std::string hours_what = "number of hours (" + std::to_string(NUM_DAYS_PER_WEEK) + " are required)";
+   const std::string penalty_what = "penalty (" + std::to_string(WeekShape::NUM_SLOTS) + " are required)";
+   size_t line_number = 0;
+   for (const char *line_begin = begin; line_begin != end;) {
+      const char *line_end = static_cast<const char *>(std::memchr(line_begin, '\n', end - line_begin));
+      if (line_end == nullptr) {
+         line_end = end;
+      }
+      LineTokenizer tokens(line_begin, line_end, ++line_number);
+      line_begin = line_end == end ? end : line_end + 1;
+      if (tokens.at_end()) {
+         continue;
+      }
+      const char *record_begin = tokens.position();
+      char signal = *record_begin;
+      if (signal != Class::input_signal and signal != Teacher::input_signal and
+          signal != Requirement::input_signal) {
+         continue;  // as in read_file, lines of any other kind are ignored
+      }
+      tokens.skip_char();
+      // the errors of the record itself, found when it is built or added, get the position of the line
+      auto add_record = [&](const auto &add) {
+         try {
+            add();
+         } catch (const std::logic_error &error) {
+            tokens.fail(record_begin, error.what());
          }
-      }
-      if (residual_hours != 0) {
-         throw std::logic_error("Class " + cl.name + " has the wrong number of total hours");
-      }
-   }
-
-   for (const Teacher &tc: _teachers) {
-      bool has_req = false;
-      for (const Requirement &req: _requirements) {
-         if (req.teacher_id() == tc.id) {
-            has_req = true;
+      };
+      switch (signal) {
+         case Class::input_signal: {
+            ID id = tokens.number<ID>("class id");
+            std::string_view name = tokens.next("class name");
+            std::array<unsigned int, NUM_DAYS_PER_WEEK> num_hours_per_day{};
+            for (unsigned int day = 0; day != NUM_DAYS_PER_WEEK; ++day) {
+               num_hours_per_day[day] = tokens.number<unsigned int>(hours_what);
+            }
+            tokens.expect_end("class");
+            add_record([&] { add_class(Class(id, std::string(name), num_hours_per_day)); });
+            break;
+         }
+         case Teacher::input_signal: {
+            ID id = tokens.number<ID>("teacher id");
+            std::string_view name = tokens.next("teacher name");
+            WeekGrid<int> penalties(0);
+            for (unsigned int slot = 0; slot != WeekShape::NUM_SLOTS; ++slot) {
+               penalties[slot] = tokens.number<int>(penalty_what);
+            }
+            tokens.expect_end("teacher");
+            add_record([&] { add_teacher(Teacher(id, std::string(name), penalties)); });
+            break;
+         }
+         default: {
+            ID teacher_id = tokens.number<ID>("teacher id");
+            ID class_id = tokens.number<ID>("class id");
+            std::string_view lessons_code = tokens.next("lessons");
+            unsigned int num_days_with_cons_hours = 0;
+            if (not tokens.at_end()) {
+               num_days_with_cons_hours = tokens.number<unsigned int>("number of days with consecutive hours");
+            }
+            tokens.expect_end("requirement");
+            add_record([&] {
+               add_requirement(Requirement(teacher_id, class_id, lessons_code, num_days_with_cons_hours));
+            });
             break;
          }
-      }
-      if (not has_req) {
-         throw std::logic_error("Teacher " + tc.name + " doesn't have any class");
       }
    }
+}
 
+void Input::check_indices() const {
+   TRACE_SCOPE("Input::check_indices");
+   // one pass over the requirements collects the hours of every class and the requirements of every teacher
+   std::vector<unsigned int> class_hours(num_classes(), 0);
+   std::vector<unsigned int> teacher_num_requirements(num_teachers(), 0);
    for (const Requirement &req: _requirements) {
-      if (find_teacher(req.teacher_id()) == nullptr) {
+      ID teacher_pos = convert_from_teacher_id(req.teacher_id());
+      if (teacher_pos == InvalidID) {
          throw std::logic_error(
                "Requirement for teacher id " + std::to_string(req.teacher_id()) + " for non-existing teacher id");
       }
-      if (find_class(req.class_id()) == nullptr) {
+      ID class_pos = convert_from_class_id(req.class_id());
+      if (class_pos == InvalidID) {
          throw std::logic_error(
                "Requirement for class id " + std::to_string(req.class_id()) + " for non-existing class id");
       }
+      class_hours[class_pos] += req.num_lessons();
+      ++teacher_num_requirements[teacher_pos];
+   }
+
+   for (unsigned int class_pos = 0; class_pos != num_classes(); ++class_pos) {
+      const Class &cl = _classes[class_pos];
+      unsigned int total_hours = 0;
+      for (unsigned int hour_in_day: cl.num_hours_per_day) {
+         total_hours += hour_in_day;
+      }
+      if (total_hours == 0) {
+         throw std::logic_error("Class " + cl.name + " has 0 hours on every day");
+      }
+      if (class_hours[class_pos] != total_hours) {
+         throw std::logic_error("Class " + cl.name + " has the wrong number of total hours");
+      }
+   }
+
+   for (unsigned int teacher_pos = 0; teacher_pos != num_teachers(); ++teacher_pos) {
+      if (teacher_num_requirements[teacher_pos] == 0) {
+         throw std::logic_error("Teacher " + _teachers[teacher_pos].name + " doesn't have any class");
+      }
    }
 }
 
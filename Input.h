@@ -2,9 +2,12 @@
 #define SCHEDULE_HIGHSCHOOL_INPUT_H
 
 #include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <array>
-#include <unordered_map>
+#include "Week_Grid.h"
 
 struct Hour {
    unsigned int week_day;
@@ -18,19 +21,26 @@ public:
    typedef int ID;  // identifies a teacher or a class
    static constexpr ID InvalidID = std::numeric_limits<ID>::max();
    static constexpr int MAX_ID = 4096;  // 2^12;
-   static constexpr unsigned int NUM_DAYS_PER_WEEK = 6;
-   static constexpr std::array<unsigned int, NUM_DAYS_PER_WEEK> NUM_HOURS_PER_DAY{6, 6, 6, 6, 6, 5};
-
-   static unsigned int total_num_hours_in_week;
+   static constexpr unsigned int NUM_DAYS_PER_WEEK = WeekShape::NUM_DAYS;
+   static constexpr std::array<unsigned int, NUM_DAYS_PER_WEEK> NUM_HOURS_PER_DAY = WeekShape::NUM_HOURS_PER_DAY;
 
    explicit Input(std::istream &is);
 
+   // parses the text in [begin, end), usually a MappedFile, in place. Errors report their line and column
+   Input(const char *begin, const char *end);
+
+   // the classes of @p input at @p class_positions, their requirements and their teachers, as an input of its own
+   // with the same ids and in the same order; the teachers keep only the requirements of these classes
+   Input(const Input &input, const std::vector<unsigned int> &class_positions);
+
    struct Class {
       ID id;  // in interval [0, max_ID)
       std::string name;
       std::array<unsigned int, NUM_DAYS_PER_WEEK> num_hours_per_day;
       std::vector<unsigned int> requirements;
 
+      Class(ID id_, std::string name_, const std::array<unsigned int, NUM_DAYS_PER_WEEK> &num_hours_per_day_);
+
       explicit Class(const std::string &input);
 
       static constexpr char input_signal = 'c';
@@ -40,17 +50,24 @@ public:
       static constexpr int InvalidPenality = std::numeric_limits<int>::max();
       ID id;  // in interval [0, MAX_ID^2) and multiple of MAX_ID
       std::string name;
-      std::vector<std::vector<int>> penalties;
+      WeekGrid<int> penalties;
       unsigned int num_days_available;
       std::vector<unsigned int> requirements;
 
+      // @p penalties_ as in the input, with a negative number for the hours in which the teacher is unavailable
+      Teacher(ID id_, std::string name_, const WeekGrid<int> &penalties_);
+
       explicit Teacher(const std::string &input);
 
       [[nodiscard]] bool is_available(unsigned int day, unsigned int hour) const {
-         return penalties[day][hour] != InvalidPenality;
+         return penalties(day, hour) != InvalidPenality;
       }
 
       static constexpr char input_signal = 't';
+
+   private:
+      // marks the unavailable hours and checks the sum of the penalties
+      void convert_penalties();
    };
 
    struct Requirement {
@@ -60,6 +77,9 @@ public:
       bool allow_extra_pairs;
       double average_lesson_weight;
 
+      // @p lessons_code as in the input, for example MMMMPP or 4M2P
+      Requirement(ID teacher_id_, ID class_id_, std::string_view lessons_code, unsigned int num_days_with_cons_hours_);
+
       explicit Requirement(const std::string &input);
 
       [[nodiscard]] ID teacher_id() const { return to_teacher_id(id); }
@@ -69,6 +89,10 @@ public:
       static constexpr char input_signal = 'r';
 
       [[nodiscard]] unsigned int num_lessons() const { return lessons.length(); }
+
+   private:
+      // expands @p lessons_code into lessons, and checks them against num_days_with_cons_hours
+      void set_lessons(std::string_view lessons_code);
    };
 
    static ID to_requirement_id(ID teacher_id, ID class_id) { return MAX_ID * teacher_id + class_id; }
@@ -114,11 +138,13 @@ public:
    Requirement *find_requirement(ID teacher_id, ID class_id);
 
 private:
-   bool add_class(const std::string &input);
+   Input();
 
-   bool add_teacher(const std::string &input);
+   bool add_class(const Class &new_class);
 
-   bool add_requirement(const std::string &input);
+   bool add_teacher(const Teacher &new_teacher);
+
+   bool add_requirement(const Requirement &new_requirement);
 
    static double
    weight_lesson(char l);  // the number is bigger the  "heavier" ie the lesson (ex. math is heavy, pe is not)
@@ -127,6 +153,8 @@ private:
 
    void read_file(std::istream &is);
 
+   void read_buffer(const char *begin, const char *end);
+
    void check_indices() const;
 
    void set_allow_extra_pairs();
@@ -136,9 +164,13 @@ private:
    std::vector<Class> _classes;
    std::vector<Teacher> _teachers;
    std::vector<Requirement> _requirements;
-   std::unordered_map<unsigned int, unsigned int> _class_id_map;
-   std::unordered_map<unsigned int, unsigned int> _teacher_id_map;
-   std::unordered_map<unsigned int, unsigned int> _requirement_id_map;
+   // the ids are below MAX_ID, so they index the positions directly: _class_pos[class id] is the position in
+   // _classes, _teacher_pos[teacher id / MAX_ID] the one in _teachers, InvalidID if there is no such entity
+   std::vector<ID> _class_pos;
+   std::vector<ID> _teacher_pos;
+   // the positions in _requirements of the requirements of every teacher, by teacher id / MAX_ID. A table over all
+   // the requirement ids would have MAX_ID^2 entries, while a teacher has only a few requirements
+   std::vector<std::vector<ID>> _requirement_pos_per_teacher;
 };
 
 
@@ -0,0 +1,162 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Instance_Generator.h"
+
+namespace {
+   // the lesson codes of Input::weight_lesson
+   constexpr char LESSON_CODES[] = "ABCEFGHIJLMOPRS";
+   // the penalty of an hour is one of these, while the sum of a teacher stays within MAX_PENALTY_SUM
+   constexpr int PENALTY_CHOICES[] = {0, 0, 0, 1, 2, 3};
+   constexpr int MAX_PENALTY_SUM = 50;
+
+   // the lessons of a teacher in the class being drawn
+   struct DrawnRequirement {
+      unsigned int teacher_idx;
+      unsigned int num_lessons;
+      unsigned int num_pair_days;
+      DayArray<bool> has_lesson;
+   };
+
+   void check_options(const GeneratorOptions &options, unsigned int num_teachers) {
+      if (options.num_classes == 0 or options.num_classes >= Input::MAX_ID) {
+         throw std::logic_error("The number of classes must be in [1, " + std::to_string(Input::MAX_ID - 1) + "]");
+      }
+      if (num_teachers == 0 or num_teachers >= Input::MAX_ID) {
+         throw std::logic_error("The number of teachers must be in [1, " + std::to_string(Input::MAX_ID - 1) + "]");
+      }
+      if (options.min_hours_per_day == 0 or
+          options.min_hours_per_day > *std::min_element(WeekShape::NUM_HOURS_PER_DAY.begin(),
+                                                         WeekShape::NUM_HOURS_PER_DAY.end())) {
+         throw std::logic_error("The minimum number of hours of a class is not within every day");
+      }
+   }
+}
+
+void write_random_input(std::ostream &os, const GeneratorOptions &options) {
+   unsigned int num_teachers = options.num_teachers != 0 ? options.num_teachers
+                                                         : std::max(options.teachers_per_class,
+                                                                    (3 * options.num_classes + 1) / 2);
+   check_options(options, num_teachers);
+   std::mt19937 random(options.seed);
+   std::bernoulli_distribution double_lesson(options.double_lesson_probability);
+   std::bernoulli_distribution unavailable(options.unavailable_probability);
+   std::uniform_int_distribution<unsigned int> lesson_code(0, sizeof(LESSON_CODES) - 2);
+   std::uniform_int_distribution<unsigned int> penalty(0, std::size(PENALTY_CHOICES) - 1);
+
+   std::vector<WeekMask> teacher_busy(num_teachers);
+   std::vector<unsigned int> all_teachers(num_teachers);
+   for (unsigned int teacher_idx = 0; teacher_idx != num_teachers; ++teacher_idx) {
+      all_teachers[teacher_idx] = teacher_idx;
+   }
+   std::string requirement_lines;
+   std::vector<DrawnRequirement> drawn;
+   for (unsigned int class_idx = 0; class_idx != options.num_classes; ++class_idx) {
+      std::array<unsigned int, WeekShape::NUM_DAYS> num_hours{};
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         num_hours[day] = std::uniform_int_distribution<unsigned int>(options.min_hours_per_day,
+                                                                      WeekShape::NUM_HOURS_PER_DAY[day])(random);
+      }
+      os << "c " << class_idx + 1 << " C" << class_idx + 1;
+      for (unsigned int hours: num_hours) {
+         os << ' ' << hours;
+      }
+      os << '\n';
+
+      drawn.clear();
+      std::shuffle(all_teachers.begin(), all_teachers.end(), random);
+      for (unsigned int pos = 0; pos != std::min(options.teachers_per_class, num_teachers); ++pos) {
+         drawn.push_back(DrawnRequirement{all_teachers[pos], 0, 0, {}});
+      }
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour < num_hours[day];) {
+            unsigned int slot = WeekShape::slot(day, hour);
+            unsigned int length = hour + 1 < num_hours[day] and double_lesson(random) ? 2 : 1;
+            // a teacher of the class without lessons today and free for the whole block, or failing that a new one
+            auto can_teach = [&](const DrawnRequirement &requirement, unsigned int block_length) {
+               return not requirement.has_lesson[day] and not teacher_busy[requirement.teacher_idx].test(slot) and
+                      (block_length == 1 or not teacher_busy[requirement.teacher_idx].test(slot + 1));
+            };
+            std::shuffle(drawn.begin(), drawn.end(), random);
+            auto chosen = std::find_if(drawn.begin(), drawn.end(), [&](const DrawnRequirement &requirement) {
+               return can_teach(requirement, length);
+            });
+            if (chosen == drawn.end() and length == 2) {
+               length = 1;
+               chosen = std::find_if(drawn.begin(), drawn.end(), [&](const DrawnRequirement &requirement) {
+                  return can_teach(requirement, length);
+               });
+            }
+            if (chosen == drawn.end()) {
+               std::shuffle(all_teachers.begin(), all_teachers.end(), random);
+               for (unsigned int teacher_idx: all_teachers) {
+                  bool in_class = std::any_of(drawn.begin(), drawn.end(), [&](const DrawnRequirement &requirement) {
+                     return requirement.teacher_idx == teacher_idx;
+                  });
+                  if (not in_class and not teacher_busy[teacher_idx].test(slot)) {
+                     drawn.push_back(DrawnRequirement{teacher_idx, 0, 0, {}});
+                     chosen = drawn.end() - 1;
+                     break;
+                  }
+               }
+               if (chosen == drawn.end()) {
+                  throw std::logic_error("Too few teachers for the hours of the classes");
+               }
+            }
+            for (unsigned int block_hour = 0; block_hour != length; ++block_hour) {
+               teacher_busy[chosen->teacher_idx].set(slot + block_hour);
+            }
+            chosen->num_lessons += length;
+            chosen->num_pair_days += length == 2 ? 1 : 0;
+            chosen->has_lesson[day] = true;
+            hour += length;
+         }
+      }
+
+      std::sort(drawn.begin(), drawn.end(), [](const DrawnRequirement &first, const DrawnRequirement &second) {
+         return first.teacher_idx < second.teacher_idx;
+      });
+      for (const DrawnRequirement &requirement: drawn) {
+         if (requirement.num_lessons == 0) {
+            continue;
+         }
+         // half of the requirements want some of the days on which they got two consecutive hours
+         unsigned int num_cons_days = 0;
+         if (requirement.num_pair_days != 0 and random() % 2 == 0) {
+            num_cons_days = std::uniform_int_distribution<unsigned int>(1, requirement.num_pair_days)(random);
+         }
+         requirement_lines += "r " + std::to_string(requirement.teacher_idx + 1) + ' ' +
+                              std::to_string(class_idx + 1) + ' ' + std::to_string(requirement.num_lessons) +
+                              LESSON_CODES[lesson_code(random)] + ' ' + std::to_string(num_cons_days) + '\n';
+      }
+   }
+
+   for (unsigned int teacher_idx = 0; teacher_idx != num_teachers; ++teacher_idx) {
+      if (teacher_busy[teacher_idx].empty()) {
+         continue;  // Input rejects a teacher without classes
+      }
+      os << "t " << teacher_idx + 1 << " T" << teacher_idx + 1;
+      int penalty_sum = 0;
+      for (unsigned int slot = 0; slot != WeekShape::NUM_SLOTS; ++slot) {
+         if (not teacher_busy[teacher_idx].test(slot) and unavailable(random)) {
+            os << " -1";
+            continue;
+         }
+         int hour_penalty = PENALTY_CHOICES[penalty(random)];
+         if (penalty_sum + hour_penalty > MAX_PENALTY_SUM) {
+            hour_penalty = 0;
+         }
+         penalty_sum += hour_penalty;
+         os << ' ' << hour_penalty;
+      }
+      os << '\n';
+   }
+   os << requirement_lines;
+}
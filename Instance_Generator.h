@@ -0,0 +1,31 @@
+#ifndef SCHEDULE_HIGHSCHOOL_INSTANCE_GENERATOR_H
+#define SCHEDULE_HIGHSCHOOL_INSTANCE_GENERATOR_H
+
+#include <ostream>
+#include "Input.h"
+
+// Random input files of any size, for benchmarks and experiments. They are valid for Input and always have a
+// schedule: one is drawn first, class by class and day by day, in blocks of one or two hours of a teacher that is
+// free, and the class hours, the requirements with their consecutive-hour days and the teacher availabilities are
+// read from it. The same options give the same file
+struct GeneratorOptions {
+   unsigned int num_classes;
+   unsigned int num_teachers;  // 0 chooses about three teachers for every two classes
+   unsigned int teachers_per_class;  // drawn for every class; more are added where they are all busy
+   unsigned int min_hours_per_day;  // of a class; the most is the length of the day
+   double double_lesson_probability;  // that a block takes two hours
+   double unavailable_probability;  // that a teacher is unavailable at an hour without a lesson
+   unsigned int seed;
+
+   explicit GeneratorOptions(unsigned int num_classes_ = 10) : num_classes{num_classes_}, num_teachers{0},
+                                                               teachers_per_class{8}, min_hours_per_day{4},
+                                                               double_lesson_probability{0.3},
+                                                               unavailable_probability{0.1}, seed{1} {}
+};
+
+// writes an input file in the format of README. Throws std::logic_error if the options cannot give one, for
+// example with too many classes for the ids or too few teachers for the hours
+void write_random_input(std::ostream &os, const GeneratorOptions &options);
+
+
+#endif //SCHEDULE_HIGHSCHOOL_INSTANCE_GENERATOR_H
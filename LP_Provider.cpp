@@ -2,72 +2,235 @@
 // Created by mich on 28/07/19.
 //
 
+#include <atomic>
+#include <thread>
 #include "LP_Provider.h"
+#include "Model_Writer.h"
+#include "Trace.h"
 
-LP_Provider::LP_Provider(const Input &input_, const Variables &variables_, Direction objective_dir_) :
-      _input{input_}, _variables{variables_}, _objective{objective_dir_} {
-   initialize_sorted_subsets();
+namespace {
+   constexpr unsigned int CHUNKS_PER_THREAD = 4;
+}
+
+LP_Provider::LP_Provider(const Input &input_, const Variables &variables_, Direction objective_dir_,
+                         Storage storage_, unsigned int num_threads_) :
+      _input{input_}, _variables{variables_}, _objective{objective_dir_}, _storage{storage_},
+      _num_threads{std::max(1u, num_threads_)} {
+   if (_variables.get_options().day_weight == ModelOptions::SubsetsDayWeight) {
+      initialize_sorted_subsets();
+   }
    create_objective();
-   create_constraints();
+   if (_storage == InMemory) {
+      create_constraints();
+   }
 }
 
-const LP_Provider::Constraint &LP_Provider::get_constraint(size_t constr_idx) const {
+LP_Provider::Constraint LP_Provider::get_constraint(size_t constr_idx) const {
    if (constr_idx >= num_constraints()) {
       throw std::logic_error("Call to get_constraint with too large const_idx");
    }
-   return _constraints[constr_idx];
+   return _constraints.row(constr_idx);
 }
 
 void LP_Provider::create_objective() {
+   TRACE_SCOPE("create_objective");
    _objective.lin_vec.clear();
-   const std::vector<std::vector<std::vector<Variables::VarID>>> &teacher_is_in_school_var = _variables.get_teacher_is_in_school_var();
-   const std::vector<std::vector<Variables::VarID>> &day_weight_for_class_sorted = _variables.get_day_weight_for_class_sorted();
 
-   size_t num_var_in_objective = 0;
-   for (const auto &teacher_matr: teacher_is_in_school_var) {
-      for (const auto &day_vec: teacher_matr) {
-         num_var_in_objective += day_vec.size();
-      }
-   }
-   for (const auto &class_vec: day_weight_for_class_sorted) {
-      num_var_in_objective += class_vec.size();
-   }
+   size_t num_var_in_objective = _input.num_teachers() * WeekShape::NUM_SLOTS;
+   num_var_in_objective += _input.num_classes() * Input::NUM_DAYS_PER_WEEK;
 
    _objective.lin_vec.reserve(num_var_in_objective);
 
-   for (size_t teacher_idx = 0; teacher_idx != teacher_is_in_school_var.size(); ++teacher_idx) {
-      for (unsigned int day_idx = 0; day_idx != teacher_is_in_school_var[teacher_idx].size(); ++day_idx) {
-         for (unsigned int hour_idx = 0;
-              hour_idx != teacher_is_in_school_var[teacher_idx][hour_idx].size(); ++hour_idx) {
+   for (unsigned int teacher_idx = 0; teacher_idx != _input.num_teachers(); ++teacher_idx) {
+      const Input::Teacher &teacher = _input.get_teachers()[teacher_idx];
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+         for (unsigned int hour_idx = 0; hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
+            if (not teacher.is_available(day_idx, hour_idx)) {
+               continue;  // the variable is forced to 0, and the penalty is not a number
+            }
             // objective to minimize the penalties to teachers
-            _objective.lin_vec.emplace_back(teacher_is_in_school_var[teacher_idx][day_idx][hour_idx],
-                                            _input.get_teachers()[teacher_idx].penalties[day_idx][hour_idx]);
+            _objective.lin_vec.emplace_back(_variables.teacher_is_in_school_var(teacher_idx, day_idx, hour_idx),
+                                            teacher.penalties(day_idx, hour_idx));
          }
       }
    }
-   for (size_t class_idx = 0; class_idx != day_weight_for_class_sorted.size(); ++class_idx) {
-      for (unsigned int day_idx = 0; day_idx != day_weight_for_class_sorted[class_idx].size(); ++day_idx) {
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
          // objective to make the weight of classes as uniform as possible
-         _objective.lin_vec.emplace_back(day_weight_for_class_sorted[class_idx][day_idx],
+         _objective.lin_vec.emplace_back(_variables.day_weight_for_class_sorted(class_idx, day_idx),
                                          std::max(1 - double(day_idx) / (Input::NUM_DAYS_PER_WEEK - 1), 0.0));
       }
    }
 }
 
 void LP_Provider::create_constraints() {
+   if (_variables.num_var() > ConstraintMatrix::MAX_NUM_COLUMNS) {
+      throw std::logic_error("Too many variables for the constraint matrix");
+   }
+   if (_num_threads > 1) {
+      create_constraints_parallel();
+      return;
+   }
+   CountingSink counter;
+   {
+      TRACE_SCOPE("count_constraints");
+      emit_constraints(counter);
+   }
    _constraints.clear();
-   _constraints.reserve(guess_num_constraints());
-
-   // create the constraints
-   create_teacher_available_constraints();
-   create_teacher_has_lesson_constraints();
-   create_teacher_is_in_school_constraints();
-   create_class_sovrapposition_constraints();
-   create_num_lessons_constraints();
-   prevent_non_consecutive_hours();
-   create_cons_var_constraints();
-   create_day_weight_constraints();
-   create_day_weight_sorted_constraints();
+   _constraints.reserve(counter.num_rows(), counter.num_nonzeros());
+   _family_rows.clear();
+   for (const RowFamily &family: row_families()) {
+      TRACE_ROWS_SCOPE(family.name, _constraints);
+      size_t first_row = _constraints.num_rows();
+      (this->*family.generator)(_constraints, 0, family.num_entities);
+      _family_rows.push_back(FamilyRows{family.name, first_row, _constraints.num_rows() - first_row});
+   }
+}
+
+void LP_Provider::create_constraints_parallel() {
+   struct Chunk {
+      const char *name;
+      RowGenerator generator;
+      unsigned int first;
+      unsigned int last;
+   };
+   // a few chunks per thread and family, so that the threads stay busy when the families have different costs
+   std::vector<Chunk> chunks;
+   for (const RowFamily &family: row_families()) {
+      unsigned int chunk_size = std::max(1u, family.num_entities / (CHUNKS_PER_THREAD * _num_threads));
+      for (unsigned int first = 0; first < family.num_entities; first += chunk_size) {
+         chunks.push_back(
+               Chunk{family.name, family.generator, first, std::min(first + chunk_size, family.num_entities)});
+      }
+   }
+   std::vector<ConstraintMatrix> chunk_rows(chunks.size());
+   std::atomic<size_t> next_chunk{0};
+   auto build_chunks = [&]() {
+      for (size_t chunk_idx = next_chunk++; chunk_idx < chunks.size(); chunk_idx = next_chunk++) {
+         const Chunk &chunk = chunks[chunk_idx];
+         TRACE_ROWS_SCOPE(chunk.name, chunk_rows[chunk_idx]);
+         (this->*chunk.generator)(chunk_rows[chunk_idx], chunk.first, chunk.last);
+      }
+   };
+   std::vector<std::thread> threads;
+   for (unsigned int thread_idx = 1; thread_idx < std::min<size_t>(_num_threads, chunks.size()); ++thread_idx) {
+      threads.emplace_back(build_chunks);
+   }
+   build_chunks();
+   for (std::thread &thread: threads) {
+      thread.join();
+   }
+
+   TRACE_SCOPE("append_constraints");
+   size_t num_rows = 0, num_nonzeros = 0;
+   for (const ConstraintMatrix &rows: chunk_rows) {
+      num_rows += rows.num_rows();
+      num_nonzeros += rows.num_nonzeros();
+   }
+   _constraints.clear();
+   _constraints.reserve(num_rows, num_nonzeros);
+   _family_rows.clear();
+   for (size_t chunk_idx = 0; chunk_idx != chunks.size(); ++chunk_idx) {
+      // the chunks of a family are consecutive
+      if (_family_rows.empty() or _family_rows.back().name != chunks[chunk_idx].name) {
+         _family_rows.push_back(FamilyRows{chunks[chunk_idx].name, _constraints.num_rows(), 0});
+      }
+      _family_rows.back().num_rows += chunk_rows[chunk_idx].num_rows();
+      _constraints.append(chunk_rows[chunk_idx]);
+      chunk_rows[chunk_idx] = ConstraintMatrix();  // releases the chunk
+   }
+}
+
+std::vector<LP_Provider::RowFamily> LP_Provider::row_families() const {
+   const ModelOptions &options = _variables.get_options();
+   unsigned int num_teachers = _input.num_teachers();
+   unsigned int num_classes = _input.num_classes();
+   unsigned int num_requirements = _input.num_requirements();
+   std::vector<RowFamily> families;
+   families.emplace_back("create_teacher_available_constraints",
+                         &LP_Provider::create_teacher_available_constraints, num_teachers);
+   families.emplace_back("create_teacher_has_lesson_constraints",
+                         &LP_Provider::create_teacher_has_lesson_constraints, num_teachers);
+   if (options.in_school == ModelOptions::CompactInSchool) {
+      families.emplace_back("create_teacher_is_in_school_compact_constraints",
+                            &LP_Provider::create_teacher_is_in_school_compact_constraints, num_teachers);
+   } else if (options.lazy_rows) {
+      families.emplace_back("create_teacher_not_in_school_constraints",
+                            &LP_Provider::create_teacher_not_in_school_constraints, num_teachers);
+   } else {
+      families.emplace_back("create_teacher_is_in_school_constraints",
+                            &LP_Provider::create_teacher_is_in_school_constraints, num_teachers);
+   }
+   families.emplace_back("create_class_sovrapposition_constraints",
+                         &LP_Provider::create_class_sovrapposition_constraints, num_classes);
+   families.emplace_back("create_num_lessons_constraints",
+                         &LP_Provider::create_num_lessons_constraints, num_requirements);
+   if (options.contiguity == ModelOptions::BlockStartContiguity) {
+      families.emplace_back("create_block_start_constraints",
+                            &LP_Provider::create_block_start_constraints, num_requirements);
+   } else if (not options.lazy_rows) {
+      families.emplace_back("prevent_non_consecutive_hours",
+                            &LP_Provider::prevent_non_consecutive_hours, num_requirements);
+   }
+   families.emplace_back("create_cons_var_constraints", &LP_Provider::create_cons_var_constraints, num_requirements);
+   families.emplace_back("create_day_weight_constraints", &LP_Provider::create_day_weight_constraints, num_classes);
+   if (options.day_weight == ModelOptions::KSumDayWeight) {
+      families.emplace_back("create_day_weight_k_sum_constraints",
+                            &LP_Provider::create_day_weight_k_sum_constraints, num_classes);
+   } else {
+      families.emplace_back("create_day_weight_sorted_constraints",
+                            &LP_Provider::create_day_weight_sorted_constraints, num_classes);
+   }
+   return families;
+}
+
+void LP_Provider::emit_constraints(ConstraintSink &sink) const {
+   for (const RowFamily &family: row_families()) {
+      (this->*family.generator)(sink, 0, family.num_entities);
+   }
+}
+
+std::vector<int> LP_Provider::branching_priorities() const {
+   std::vector<int> priorities(_variables.num_var(), 0);
+   for (VarID var_idx = 0; var_idx != _variables.num_01_var(); ++var_idx) {
+      switch (_variables.get_family(var_idx)) {
+         case Variables::Requirement: {
+            // the lessons decide everything else. Requirements with many lessons are the hardest to place
+            const Input::Requirement &requirement = _input.get_requirements()[_variables.get_variable(
+                  var_idx).holder_id];
+            priorities[var_idx] = 100 + int(requirement.num_lessons());
+            break;
+         }
+         case Variables::RequirementConsHour: {
+            priorities[var_idx] = 50;
+            break;
+         }
+         default: {
+            break;  // implied by the lessons
+         }
+      }
+   }
+   return priorities;
+}
+
+void LP_Provider::stream_constraints(ConstraintSink &sink) const {
+   if (_storage == InMemory) {
+      _constraints.replay(sink);
+   } else {
+      emit_constraints(sink);
+   }
+}
+
+void LP_Provider::write_lp(std::ostream &os) const {
+   LP_FormatWriter writer(os, _variables);
+   writer.write_objective(_objective.direction, _objective.lin_vec);
+   stream_constraints(writer);
+   writer.finish();
+}
+
+void LP_Provider::write_mps(std::ostream &os) const {
+   write_free_mps(os, WriterColumns(_variables), _objective.direction, _objective.lin_vec,
+                  [this](ConstraintSink &sink) { stream_constraints(sink); });
 }
 
 void LP_Provider::initialize_sorted_subsets() {
@@ -93,194 +256,396 @@ void LP_Provider::initialize_sorted_subsets() {
 }
 
 
-size_t LP_Provider::guess_num_constraints() const {
-   size_t reserve_counter = 0;
-   reserve_counter += 2 * _input.num_teachers() * Input::total_num_hours_in_week;
-   for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
-      size_t num_costraints_teacher_is_in_school = 2 * Input::NUM_HOURS_PER_DAY[day_idx];
-      for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day_idx]; ++hour) {
-         num_costraints_teacher_is_in_school += (hour + 1) * (Input::NUM_HOURS_PER_DAY[day_idx] - hour);
-      }
-      reserve_counter += _input.num_teachers() * num_costraints_teacher_is_in_school;
-   }
-   reserve_counter += _input.num_classes() * Input::total_num_hours_in_week;
-   reserve_counter += _input.num_requirements();
-   reserve_counter += _input.num_requirements() * (Input::total_num_hours_in_week - Input::NUM_DAYS_PER_WEEK);
-   reserve_counter += _input.num_requirements();
-   reserve_counter += _input.num_classes() * Input::NUM_DAYS_PER_WEEK;
-   for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
-      for (const auto &sorted_subset: _sorted_subsets[Input::NUM_HOURS_PER_DAY[day_idx] + 1]) {
-         reserve_counter += _input.num_classes() * sorted_subset.size();
-      }
-   }
-   return reserve_counter;
-}
-
-void LP_Provider::create_teacher_available_constraints() {
-   const auto &teacher_is_in_school_var = _variables.get_teacher_is_in_school_var();
-   for (Input::ID teacher_id = 0; teacher_id != _input.num_teachers(); ++teacher_id) {
+void LP_Provider::create_teacher_available_constraints(ConstraintSink &sink, unsigned int first,
+                                                       unsigned int last) const {
+   for (unsigned int teacher_id = first; teacher_id != last; ++teacher_id) {
       const Input::Teacher &teacher = _input.get_teachers()[teacher_id];
       for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
          for (unsigned int hour_idx = 0; hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
-            _constraints.emplace_back(Leq, teacher.is_available(day_idx, hour_idx) ? 1.0 : 0.0);
-            _constraints.back().lhs.emplace_back(teacher_is_in_school_var[teacher_id][day_idx][hour_idx], 1.0);
+            sink.begin_row(Leq, teacher.is_available(day_idx, hour_idx) ? 1.0 : 0.0);
+            sink.add_entry(_variables.teacher_is_in_school_var(teacher_id, day_idx, hour_idx), 1.0);
+            sink.end_row();
          }
       }
    }
 }
 
-void LP_Provider::create_teacher_has_lesson_constraints() {
-   const auto &requirement_var_per_teacher = _variables.get_requirement_var_per_teacher();
-   const auto &teacher_has_lesson_var = _variables.get_teacher_has_lesson_var();
-   for (Input::ID teacher_id = 0; teacher_id != _input.num_teachers(); ++teacher_id) {
-      for (unsigned int day_idx = 0; day_idx != requirement_var_per_teacher[teacher_id].size(); ++day_idx) {
-         for (unsigned int hour_idx = 0;
-              hour_idx != requirement_var_per_teacher[teacher_id][day_idx].size(); ++hour_idx) {
-            _constraints.emplace_back(Eq, 0.0);
-            _constraints.back().lhs.reserve(requirement_var_per_teacher[teacher_id][day_idx][hour_idx].size() + 1);
-            for (VarID entry: requirement_var_per_teacher[teacher_id][day_idx][hour_idx]) {
-               _constraints.back().lhs.emplace_back(entry, 1.0);
+void LP_Provider::create_teacher_has_lesson_constraints(ConstraintSink &sink, unsigned int first,
+                                                        unsigned int last) const {
+   for (unsigned int teacher_id = first; teacher_id != last; ++teacher_id) {
+      const Input::Teacher &teacher = _input.get_teachers()[teacher_id];
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+         for (unsigned int hour_idx = 0; hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
+            sink.begin_row(Eq, 0.0);
+            for (unsigned int req_idx: teacher.requirements) {
+               VarID lesson = _variables.requirement_var(req_idx, day_idx, hour_idx);
+               if (lesson != InvalidVarID) {
+                  sink.add_entry(lesson, 1.0);
+               }
             }
-            _constraints.back().lhs.emplace_back(teacher_has_lesson_var[teacher_id][day_idx][hour_idx], -1.0);
+            sink.add_entry(_variables.teacher_has_lesson_var(teacher_id, day_idx, hour_idx), -1.0);
+            sink.end_row();
          }
       }
    }
 }
 
-void LP_Provider::create_teacher_is_in_school_constraints() {
-   const auto &teacher_is_in_school_var = _variables.get_teacher_is_in_school_var();
-   const auto &teacher_has_lesson_var = _variables.get_teacher_has_lesson_var();
-   for (Input::ID teacher_id = 0; teacher_id != _input.num_teachers(); ++teacher_id) {
+void LP_Provider::create_teacher_is_in_school_constraints(ConstraintSink &sink, unsigned int first,
+                                                          unsigned int last) const {
+   for (unsigned int teacher_id = first; teacher_id != last; ++teacher_id) {
       for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
          for (unsigned int hour_idx = 0; hour_idx < Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
             for (unsigned int earlier_hour_idx = 0; earlier_hour_idx <= hour_idx; ++earlier_hour_idx) {
                for (unsigned int later_hour_idx = hour_idx;
                     later_hour_idx < Input::NUM_HOURS_PER_DAY[day_idx]; ++later_hour_idx) {
                   // if teacher has class in earlier_hour_idx and later_hour_idx, then he's in school at hour_idx
-                  _constraints.emplace_back(Geq, -1.0);
-                  _constraints.back().lhs.reserve(3);
-                  _constraints.back().lhs.emplace_back(teacher_is_in_school_var[teacher_id][day_idx][hour_idx], 1.0);
-                  _constraints.back().lhs.emplace_back(teacher_has_lesson_var[teacher_id][day_idx][earlier_hour_idx],
-                                                       -1.0);
-                  _constraints.back().lhs.emplace_back(teacher_has_lesson_var[teacher_id][day_idx][later_hour_idx],
-                                                       -1.0);
+                  sink.begin_row(Geq, -1.0);
+                  sink.add_entry(_variables.teacher_is_in_school_var(teacher_id, day_idx, hour_idx), 1.0);
+                  sink.add_entry(_variables.teacher_has_lesson_var(teacher_id, day_idx, earlier_hour_idx), -1.0);
+                  sink.add_entry(_variables.teacher_has_lesson_var(teacher_id, day_idx, later_hour_idx), -1.0);
+                  sink.end_row();
                }
             }
-            // not in school if the teacher has no lessons in time interval [0,hour_idx]
-            _constraints.emplace_back(Leq, 0.0);
-            _constraints.back().lhs.reserve(hour_idx + 2);
-            _constraints.back().lhs.emplace_back(teacher_is_in_school_var[teacher_id][day_idx][hour_idx], 1.0);
-            for (unsigned int earlier_hour_idx = 0; earlier_hour_idx <= hour_idx; ++earlier_hour_idx) {
-               _constraints.back().lhs.emplace_back(teacher_has_lesson_var[teacher_id][day_idx][earlier_hour_idx],
-                                                    -1.0);
+            create_teacher_not_in_school_rows(sink, teacher_id, day_idx, hour_idx);
+         }
+      }
+   }
+}
+
+void LP_Provider::create_teacher_not_in_school_constraints(ConstraintSink &sink, unsigned int first,
+                                                           unsigned int last) const {
+   for (unsigned int teacher_id = first; teacher_id != last; ++teacher_id) {
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+         for (unsigned int hour_idx = 0; hour_idx < Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
+            create_teacher_not_in_school_rows(sink, teacher_id, day_idx, hour_idx);
+         }
+      }
+   }
+}
+
+void LP_Provider::create_teacher_not_in_school_rows(ConstraintSink &sink, unsigned int teacher_id,
+                                                    unsigned int day_idx, unsigned int hour_idx) const {
+   // not in school if the teacher has no lessons in time interval [0,hour_idx]
+   sink.begin_row(Leq, 0.0);
+   sink.add_entry(_variables.teacher_is_in_school_var(teacher_id, day_idx, hour_idx), 1.0);
+   for (unsigned int earlier_hour_idx = 0; earlier_hour_idx <= hour_idx; ++earlier_hour_idx) {
+      sink.add_entry(_variables.teacher_has_lesson_var(teacher_id, day_idx, earlier_hour_idx), -1.0);
+   }
+   sink.end_row();
+   // not in school if the teacher has no lessons in time interval [hour_idx,NUM_HOURS_PER_DAY[day_idx])
+   sink.begin_row(Leq, 0.0);
+   sink.add_entry(_variables.teacher_is_in_school_var(teacher_id, day_idx, hour_idx), 1.0);
+   for (unsigned int later_hour_idx = hour_idx;
+        later_hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++later_hour_idx) {
+      sink.add_entry(_variables.teacher_has_lesson_var(teacher_id, day_idx, later_hour_idx), -1.0);
+   }
+   sink.end_row();
+}
+
+void LP_Provider::create_teacher_is_in_school_compact_constraints(ConstraintSink &sink, unsigned int first,
+                                                                  unsigned int last) const {
+   // begun[h] >= has[k] for every k <= h and not_over[h] >= has[k] for every k >= h, through a chain of rows.
+   // Then in[h] >= begun[h] + not_over[h] - 1 is 1 between the first and the last lesson. Nothing bounds in, begun
+   // and not_over from above: the penalties in the objective keep them at their lowest
+   for (unsigned int teacher_id = first; teacher_id != last; ++teacher_id) {
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+         // the variables of the hours of a day are consecutive
+         VarID has_lesson = _variables.teacher_has_lesson_var(teacher_id, day_idx, 0);
+         VarID begun = _variables.teacher_lessons_begun_var(teacher_id, day_idx, 0);
+         VarID not_over = _variables.teacher_lessons_not_over_var(teacher_id, day_idx, 0);
+         unsigned int num_hours = Input::NUM_HOURS_PER_DAY[day_idx];
+         for (unsigned int hour_idx = 0; hour_idx != num_hours; ++hour_idx) {
+            sink.begin_row(Geq, 0.0);
+            sink.add_entry(begun + hour_idx, 1.0);
+            sink.add_entry(has_lesson + hour_idx, -1.0);
+            sink.end_row();
+            if (hour_idx != 0) {
+               sink.begin_row(Geq, 0.0);
+               sink.add_entry(begun + hour_idx, 1.0);
+               sink.add_entry(begun + hour_idx - 1, -1.0);
+               sink.end_row();
             }
-            // not in school if the teacher has no lessons in time interval [hour_idx,NUM_HOURS_PER_DAY[day_idx])
-            _constraints.emplace_back(Leq, 0.0);
-            _constraints.back().lhs.reserve(Input::NUM_HOURS_PER_DAY[day_idx] - hour_idx + 1);
-            _constraints.back().lhs.emplace_back(teacher_is_in_school_var[teacher_id][day_idx][hour_idx], 1.0);
-            for (unsigned int later_hour_idx = hour_idx;
-                 later_hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++later_hour_idx) {
-               _constraints.back().lhs.emplace_back(teacher_has_lesson_var[teacher_id][day_idx][later_hour_idx], -1.0);
+            sink.begin_row(Geq, 0.0);
+            sink.add_entry(not_over + hour_idx, 1.0);
+            sink.add_entry(has_lesson + hour_idx, -1.0);
+            sink.end_row();
+            if (hour_idx + 1 != num_hours) {
+               sink.begin_row(Geq, 0.0);
+               sink.add_entry(not_over + hour_idx, 1.0);
+               sink.add_entry(not_over + hour_idx + 1, -1.0);
+               sink.end_row();
             }
+            sink.begin_row(Geq, -1.0);
+            sink.add_entry(_variables.teacher_is_in_school_var(teacher_id, day_idx, hour_idx), 1.0);
+            sink.add_entry(begun + hour_idx, -1.0);
+            sink.add_entry(not_over + hour_idx, -1.0);
+            sink.end_row();
          }
       }
    }
 }
-void LP_Provider::create_class_sovrapposition_constraints() {
-   const auto &requirement_var_per_class = _variables.get_requirement_var_per_class();
-   for (Input::ID class_id = 0; class_id != _input.num_classes(); ++class_id) {
+
+void LP_Provider::create_class_sovrapposition_constraints(ConstraintSink &sink, unsigned int first,
+                                                          unsigned int last) const {
+   for (unsigned int class_id = first; class_id != last; ++class_id) {
       const Input::Class &class_object = _input.get_classes()[class_id];
       for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
-         for (unsigned int hour_idx = 0; hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
-            _constraints.emplace_back(Eq, hour_idx < class_object.num_hours_per_day[day_idx] ? 1.0 : 0.0);
-            _constraints.back().lhs.reserve(requirement_var_per_class[class_id][day_idx][hour_idx].size());
-            for (VarID entry: requirement_var_per_class[class_id][day_idx][hour_idx]) {
-               _constraints.back().lhs.emplace_back(entry);
+         // after the last hour of the class there are no lessons, nor variables for them
+         for (unsigned int hour_idx = 0; hour_idx < class_object.num_hours_per_day[day_idx]; ++hour_idx) {
+            sink.begin_row(Eq, 1.0);
+            for (unsigned int req_idx: class_object.requirements) {
+               VarID lesson = _variables.requirement_var(req_idx, day_idx, hour_idx);
+               if (lesson != InvalidVarID) {
+                  sink.add_entry(lesson, 1.0);
+               }
             }
+            sink.end_row();
          }
       }
    }
 }
 
-void LP_Provider::create_num_lessons_constraints() {
-   const auto &requirement_var = _variables.get_requirement_var();
-   for (Input::ID req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+void LP_Provider::create_num_lessons_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const {
+   for (unsigned int req_idx = first; req_idx != last; ++req_idx) {
       const Input::Requirement &requirement = _input.get_requirements()[req_idx];
-      _constraints.emplace_back(Eq, requirement.num_lessons());
-      _constraints.back().lhs.reserve(Input::total_num_hours_in_week);
-      for (const auto &day: requirement_var[req_idx]) {
-         for (VarID hour: day) {
-            _constraints.back().lhs.emplace_back(hour);
+      sink.begin_row(Eq, requirement.num_lessons());
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+         for (unsigned int hour_idx = 0; hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
+            VarID lesson = _variables.requirement_var(req_idx, day_idx, hour_idx);
+            if (lesson != InvalidVarID) {
+               sink.add_entry(lesson, 1.0);
+            }
          }
       }
+      sink.end_row();
    }
 }
-void LP_Provider::prevent_non_consecutive_hours() {
-   const auto &requirement_var = _variables.get_requirement_var();
-   for (Input::ID req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+
+void LP_Provider::prevent_non_consecutive_hours(ConstraintSink &sink, unsigned int first, unsigned int last) const {
+   for (unsigned int req_idx = first; req_idx != last; ++req_idx) {
       for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
          for (unsigned int first_hour_idx = 0; first_hour_idx < Input::NUM_HOURS_PER_DAY[day_idx]; ++first_hour_idx) {
             for (unsigned int second_hour_idx = first_hour_idx + 2;
                  second_hour_idx < Input::NUM_HOURS_PER_DAY[day_idx]; ++second_hour_idx) {
-               _constraints.emplace_back(Leq, 1.0);
-               _constraints.back().lhs.reserve(2);
-               _constraints.back().lhs.emplace_back(requirement_var[req_idx][day_idx][first_hour_idx], 1.0);
-               _constraints.back().lhs.emplace_back(requirement_var[req_idx][day_idx][second_hour_idx], 1.0);
+               VarID first_lesson = _variables.requirement_var(req_idx, day_idx, first_hour_idx);
+               VarID second_lesson = _variables.requirement_var(req_idx, day_idx, second_hour_idx);
+               if (first_lesson == InvalidVarID or second_lesson == InvalidVarID) {
+                  continue;
+               }
+               sink.begin_row(Leq, 1.0);
+               sink.add_entry(first_lesson, 1.0);
+               sink.add_entry(second_lesson, 1.0);
+               sink.end_row();
             }
          }
       }
    }
 }
 
-void LP_Provider::create_cons_var_constraints() {
-   const auto &requirement_cons_var_from_hour = _variables.get_requirement_cons_var_from_hour();
-   for (Input::ID req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
-      _constraints.emplace_back(Eq, _input.get_requirements()[req_idx].num_days_with_cons_hours);
-      _constraints.back().lhs.reserve(Input::total_num_hours_in_week - Input::NUM_DAYS_PER_WEEK);
-      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
-         for (unsigned int hour_idx = 0; hour_idx + 1 < Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
-            _constraints.back().lhs.emplace_back(requirement_cons_var_from_hour[req_idx][day_idx][hour_idx]);
+size_t LP_Provider::separate_lazy_rows(const std::vector<double> &values, double tolerance,
+                                       ConstraintSink &sink) const {
+   const ModelOptions &options = _variables.get_options();
+   if (not options.lazy_rows) {
+      return 0;
+   }
+   size_t num_rows = 0;
+   if (options.in_school == ModelOptions::PairwiseInSchool) {
+      // the most violated row of every hour pairs it with the largest lesson value at or before it and the
+      // largest at or after it
+      std::array<unsigned int, WeekShape::NUM_SLOTS> latest{};  // the hour with the largest value at or after each
+      for (unsigned int teacher_id = 0; teacher_id != _input.num_teachers(); ++teacher_id) {
+         for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+            unsigned int num_hours = Input::NUM_HOURS_PER_DAY[day_idx];
+            // the variables of the hours of a day are consecutive
+            VarID has_lesson = _variables.teacher_has_lesson_var(teacher_id, day_idx, 0);
+            for (unsigned int hour_idx = num_hours; hour_idx-- != 0;) {
+               latest[hour_idx] = hour_idx + 1 == num_hours or values[has_lesson + hour_idx] >=
+                                                                 values[has_lesson + latest[hour_idx + 1]]
+                                  ? hour_idx : latest[hour_idx + 1];
+            }
+            unsigned int earliest = 0;
+            for (unsigned int hour_idx = 0; hour_idx != num_hours; ++hour_idx) {
+               if (values[has_lesson + hour_idx] > values[has_lesson + earliest]) {
+                  earliest = hour_idx;
+               }
+               VarID in_school = _variables.teacher_is_in_school_var(teacher_id, day_idx, hour_idx);
+               unsigned int later = latest[hour_idx];
+               if (values[has_lesson + earliest] + values[has_lesson + later] - 1.0 - values[in_school] <=
+                   tolerance) {
+                  continue;
+               }
+               // the row of create_teacher_is_in_school_constraints
+               sink.begin_row(Geq, -1.0);
+               sink.add_entry(in_school, 1.0);
+               if (earliest == later) {
+                  sink.add_entry(has_lesson + earliest, -2.0);
+               } else {
+                  sink.add_entry(has_lesson + earliest, -1.0);
+                  sink.add_entry(has_lesson + later, -1.0);
+               }
+               sink.end_row();
+               ++num_rows;
+            }
          }
       }
    }
+   if (options.contiguity == ModelOptions::PairwiseContiguity) {
+      // the most violated row of every hour pairs it with the largest lesson value two or more hours before it
+      for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+         for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+            VarID earlier_lesson = InvalidVarID;
+            for (unsigned int hour_idx = 2; hour_idx < Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
+               VarID candidate = _variables.requirement_var(req_idx, day_idx, hour_idx - 2);
+               if (candidate != InvalidVarID and
+                   (earlier_lesson == InvalidVarID or values[candidate] > values[earlier_lesson])) {
+                  earlier_lesson = candidate;
+               }
+               VarID lesson = _variables.requirement_var(req_idx, day_idx, hour_idx);
+               if (earlier_lesson == InvalidVarID or lesson == InvalidVarID or
+                   values[earlier_lesson] + values[lesson] - 1.0 <= tolerance) {
+                  continue;
+               }
+               // the row of prevent_non_consecutive_hours
+               sink.begin_row(Leq, 1.0);
+               sink.add_entry(earlier_lesson, 1.0);
+               sink.add_entry(lesson, 1.0);
+               sink.end_row();
+               ++num_rows;
+            }
+         }
+      }
+   }
+   return num_rows;
 }
-void LP_Provider::create_day_weight_constraints() {
-   const auto &day_weight_for_class = _variables.get_day_weight_for_class();
-   const auto &requirement_var_per_class = _variables.get_requirement_var_per_class();
-   size_t reserve_counter = 0;
-   for (Input::ID class_id = 0; class_id != _input.num_classes(); ++class_id) {
+
+void LP_Provider::create_block_start_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const {
+   // a lesson at hour h needs the block to start at h-1 or at h, and there is at most one block. Two lessons that
+   // are not adjacent would need two blocks, and so would any fractional mass spread over them
+   for (unsigned int req_idx = first; req_idx != last; ++req_idx) {
       for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
-         _constraints.emplace_back(Eq, 0.0);
-         reserve_counter = 1;
+         if (Input::NUM_HOURS_PER_DAY[day_idx] < 3) {
+            continue;  // no block start variables
+         }
+         // a block can start at any hour but the last one
+         unsigned int num_starts = Input::NUM_HOURS_PER_DAY[day_idx] - 1;
          for (unsigned int hour_idx = 0; hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
-            reserve_counter += requirement_var_per_class[class_id][day_idx][hour_idx].size();
+            VarID lesson = _variables.requirement_var(req_idx, day_idx, hour_idx);
+            if (lesson == InvalidVarID) {
+               continue;
+            }
+            sink.begin_row(Leq, 0.0);
+            sink.add_entry(lesson, 1.0);
+            if (hour_idx != 0) {
+               sink.add_entry(_variables.requirement_block_start_var(req_idx, day_idx, hour_idx - 1), -1.0);
+            }
+            if (hour_idx != num_starts) {
+               sink.add_entry(_variables.requirement_block_start_var(req_idx, day_idx, hour_idx), -1.0);
+            }
+            sink.end_row();
+         }
+         sink.begin_row(Leq, 1.0);
+         for (unsigned int hour_idx = 0; hour_idx != num_starts; ++hour_idx) {
+            sink.add_entry(_variables.requirement_block_start_var(req_idx, day_idx, hour_idx), 1.0);
+         }
+         sink.end_row();
+      }
+   }
+}
+
+void LP_Provider::create_cons_var_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const {
+   for (unsigned int req_idx = first; req_idx != last; ++req_idx) {
+      if (_input.get_requirements()[req_idx].num_days_with_cons_hours == 0) {
+         continue;  // the requirement has no cons variables
+      }
+      sink.begin_row(Eq, _input.get_requirements()[req_idx].num_days_with_cons_hours);
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+         for (unsigned int hour_idx = 0; hour_idx + 1 < Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
+            VarID pair = _variables.requirement_cons_var_from_hour(req_idx, day_idx, hour_idx);
+            if (pair != InvalidVarID) {
+               sink.add_entry(pair, 1.0);
+            }
+         }
+      }
+      sink.end_row();
+      // a cons variable can be 1 only if the requirement has lesson at both hours
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+         for (unsigned int hour_idx = 0; hour_idx + 1 < Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
+            VarID pair = _variables.requirement_cons_var_from_hour(req_idx, day_idx, hour_idx);
+            if (pair == InvalidVarID) {
+               continue;  // both lessons have a variable whenever the pair has one
+            }
+            for (unsigned int lesson_hour_idx = hour_idx; lesson_hour_idx <= hour_idx + 1; ++lesson_hour_idx) {
+               sink.begin_row(Leq, 0.0);
+               sink.add_entry(pair, 1.0);
+               sink.add_entry(_variables.requirement_var(req_idx, day_idx, lesson_hour_idx), -1.0);
+               sink.end_row();
+            }
          }
-         _constraints.back().lhs.reserve(reserve_counter);
-         _constraints.back().lhs.emplace_back(day_weight_for_class[class_id][day_idx], 1.0);
+      }
+   }
+}
+
+void LP_Provider::create_day_weight_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const {
+   for (unsigned int class_id = first; class_id != last; ++class_id) {
+      const Input::Class &class_object = _input.get_classes()[class_id];
+      for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+         sink.begin_row(Eq, 0.0);
+         sink.add_entry(_variables.day_weight_for_class(class_id, day_idx), 1.0);
          for (unsigned int hour_idx = 0; hour_idx != Input::NUM_HOURS_PER_DAY[day_idx]; ++hour_idx) {
-            for (VarID entry: requirement_var_per_class[class_id][day_idx][hour_idx]) {
-               Input::ID req_id = _variables.get_variable(entry).holder_id;
-               _constraints.back().lhs.emplace_back(entry, -_input.get_requirements()[req_id].average_lesson_weight);
+            for (unsigned int req_idx: class_object.requirements) {
+               VarID lesson = _variables.requirement_var(req_idx, day_idx, hour_idx);
+               if (lesson != InvalidVarID) {
+                  sink.add_entry(lesson, -_input.get_requirements()[req_idx].average_lesson_weight);
+               }
             }
          }
+         sink.end_row();
       }
    }
 }
-void LP_Provider::create_day_weight_sorted_constraints() {
-   const auto &day_weight_for_class_sorted = _variables.get_day_weight_for_class_sorted();
-   // sets day_weight_for_class_sorted
-   for (Input::ID class_id = 0; class_id != _input.num_classes(); ++class_id) {
+
+void LP_Provider::create_day_weight_sorted_constraints(ConstraintSink &sink, unsigned int first,
+                                                       unsigned int last) const {
+   // sets day_weight_for_class_sorted: the first k sorted weights sum to at least the weights of any k days
+   for (unsigned int class_id = first; class_id != last; ++class_id) {
       for (unsigned int sorted_day_idx = 0; sorted_day_idx != Input::NUM_DAYS_PER_WEEK; ++sorted_day_idx) {
          for (const auto &subset: _sorted_subsets[sorted_day_idx + 1]) {
-            _constraints.emplace_back(Geq, 0.0);
-            _constraints.back().lhs.reserve(2 * (sorted_day_idx + 1));
+            sink.begin_row(Geq, 0.0);
             for (unsigned int day_idx = 0; day_idx <= sorted_day_idx; ++day_idx) {
-               _constraints.back().lhs.emplace_back(day_weight_for_class_sorted[class_id][day_idx], 1.0);
+               sink.add_entry(_variables.day_weight_for_class_sorted(class_id, day_idx), 1.0);
             }
             for (VarID day_idx : subset) {
-               _constraints.back().lhs.emplace_back(day_weight_for_class_sorted[class_id][day_idx], -1.0);
+               sink.add_entry(_variables.day_weight_for_class(class_id, day_idx), -1.0);
             }
+            sink.end_row();
          }
       }
    }
-}
\ No newline at end of file
+}
+
+void LP_Provider::create_day_weight_k_sum_constraints(ConstraintSink &sink, unsigned int first,
+                                                      unsigned int last) const {
+   // the sum of the m largest of the weights w_d is the minimum over t of m * t + sum_d max(0, w_d - t), so the first
+   // k+1 sorted weights are at least that sum if (k+1) * t_k + sum_d u_kd is below them, with u_kd >= w_d - t_k.
+   // The weights are non-negative, and so is the best t_k
+   for (unsigned int class_id = first; class_id != last; ++class_id) {
+      for (unsigned int sorted_day_idx = 0; sorted_day_idx != Input::NUM_DAYS_PER_WEEK; ++sorted_day_idx) {
+         sink.begin_row(Geq, 0.0);
+         for (unsigned int day_idx = 0; day_idx <= sorted_day_idx; ++day_idx) {
+            sink.add_entry(_variables.day_weight_for_class_sorted(class_id, day_idx), 1.0);
+         }
+         sink.add_entry(_variables.day_weight_threshold_var(class_id, sorted_day_idx), -double(sorted_day_idx + 1));
+         for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+            sink.add_entry(_variables.day_weight_excess_var(class_id, sorted_day_idx, day_idx), -1.0);
+         }
+         sink.end_row();
+         for (unsigned int day_idx = 0; day_idx != Input::NUM_DAYS_PER_WEEK; ++day_idx) {
+            sink.begin_row(Geq, 0.0);
+            sink.add_entry(_variables.day_weight_excess_var(class_id, sorted_day_idx, day_idx), 1.0);
+            sink.add_entry(_variables.day_weight_threshold_var(class_id, sorted_day_idx), 1.0);
+            sink.add_entry(_variables.day_weight_for_class(class_id, day_idx), -1.0);
+            sink.end_row();
+         }
+      }
+   }
+}
@@ -4,22 +4,24 @@
 #include <vector>
 #include "Input.h"
 #include "Variables.h"
-
-struct VarIdxCoeffPair {
-   Variables::VarID var_idx;
-   double coeff;
-
-   explicit VarIdxCoeffPair(Variables::VarID var_idx_, double coeff_ = 1.0) : var_idx{var_idx_}, coeff{coeff_} {}
-};
+#include "Constraint_Matrix.h"
 
 class LP_Provider {
 public:
    typedef Variables::VarID VarID;
+   static constexpr VarID InvalidVarID = Variables::InvalidVarID;
    enum Direction {
       Min, Max, Feasible
    };
-   enum Relation {
-      Leq, Eq, Geq
+   typedef ConstraintSink::Relation Relation;
+   static constexpr Relation Leq = ConstraintSink::Leq;
+   static constexpr Relation Eq = ConstraintSink::Eq;
+   static constexpr Relation Geq = ConstraintSink::Geq;
+
+   // InMemory stores the constraints in a ConstraintMatrix. Streaming never stores them: they are generated again
+   // every time they are needed, for example when the model is written to a file
+   enum Storage {
+      InMemory, Streaming
    };
 
    struct Objective {
@@ -29,19 +31,24 @@ public:
       explicit Objective(Direction direction_) : direction{direction_} {}
    };
 
-   struct Constraint {
-      std::vector<VarIdxCoeffPair> lhs;
-      int rhs;
-      Relation rel;
+   // read-only view of a row stored in the constraint matrix
+   typedef ConstraintMatrix::RowView Constraint;
 
-      explicit Constraint(Relation rel_ = Eq, int rhs_ = 0) : rhs{rhs_}, rel{rel_} {}
+   // the rows of a family in the constraint matrix, named after its generator
+   struct FamilyRows {
+      const char *name;
+      size_t first_row;
+      size_t num_rows;
    };
 
-   LP_Provider(const Input &input_, const Variables &variables_, Direction objective_dir_);
+   // with InMemory storage the constraints are built on @p num_threads_ threads, with the same rows in the same
+   // order as on one
+   LP_Provider(const Input &input_, const Variables &variables_, Direction objective_dir_,
+               Storage storage_ = InMemory, unsigned int num_threads_ = 1);
 
    [[nodiscard]] const Variables &get_variables() const { return _variables; }
 
-   [[nodiscard]] const Variables::Variable &get_variable(size_t var_idx) const {
+   [[nodiscard]] Variables::Variable get_variable(size_t var_idx) const {
       return _variables.get_variable(var_idx);
    }
 
@@ -49,37 +56,99 @@ public:
 
    [[nodiscard]] Direction get_objective_direction() const { return _objective.direction; }
 
-   [[nodiscard]] size_t num_constraints() const { return _constraints.size(); }
+   [[nodiscard]] size_t num_constraints() const { return _constraints.num_rows(); }
+
+   [[nodiscard]] size_t num_nonzeros() const { return _constraints.num_nonzeros(); }
+
+   [[nodiscard]] const ConstraintMatrix &get_constraints() const { return _constraints; }
+
+   [[nodiscard]] Constraint get_constraint(size_t constr_idx) const;
+
+   [[nodiscard]] Storage get_storage() const { return _storage; }
+
+   // the families of the stored rows, in order. Empty in Streaming mode
+   [[nodiscard]] const std::vector<FamilyRows> &get_family_rows() const { return _family_rows; }
+
+   // generates all the constraints, in order, into @p sink
+   void emit_constraints(ConstraintSink &sink) const;
+
+   // sends the constraints to @p sink, from the matrix if they are stored and from the generators otherwise
+   void stream_constraints(ConstraintSink &sink) const;
 
-   [[nodiscard]] const std::vector<Constraint> &get_constraints() const { return _constraints; }
+   // the rows left out by ModelOptions::lazy_rows that @p values, one for each variable, violate by more than
+   // @p tolerance, into @p sink: for every hour of a teacher and of a requirement the most violated one, found in
+   // O(H) per day. Returns their number
+   size_t separate_lazy_rows(const std::vector<double> &values, double tolerance, ConstraintSink &sink) const;
 
-   [[nodiscard]] const Constraint &get_constraint(size_t constr_idx) const;
+   // branching priority of every variable for BB_Solver: lessons first, then cons hours, then the implied variables
+   [[nodiscard]] std::vector<int> branching_priorities() const;
+
+   // writes the model in CPLEX-LP format
+   void write_lp(std::ostream &os) const;
+
+   // writes the model in free-MPS format
+   void write_mps(std::ostream &os) const;
 
 private:
-   void create_objective();
+   // A family of constraints writes, in order, the rows of the entities (teachers, classes or requirements) in
+   // [first, last), and the entities are independent of each other
+   typedef void (LP_Provider::*RowGenerator)(ConstraintSink &sink, unsigned int first, unsigned int last) const;
 
-   void create_constraints();
+   struct RowFamily {
+      const char *name;  // of the generator, for the trace
+      RowGenerator generator;
+      unsigned int num_entities;
 
-   [[nodiscard]] size_t guess_num_constraints() const;
+      RowFamily(const char *name_, RowGenerator generator_, unsigned int num_entities_) :
+            name{name_}, generator{generator_}, num_entities{num_entities_} {}
+   };
 
-   void create_teacher_available_constraints();
-   void create_teacher_has_lesson_constraints();
-   void create_teacher_is_in_school_constraints();
-   void create_class_sovrapposition_constraints();
-   void create_num_lessons_constraints();
-   void prevent_non_consecutive_hours();
-   void create_cons_var_constraints();
-   void create_day_weight_constraints();
-   void create_day_weight_sorted_constraints();
+   // the row families of the chosen formulations, in the order of the rows
+   [[nodiscard]] std::vector<RowFamily> row_families() const;
+
+   void create_objective();
+
+   // counts the rows and nonzeros first, so that the matrix is allocated exactly once
+   void create_constraints();
 
-   // all the possible subsets of [0, Input::NUM_DAYS_IN_WEEK) of cardinality @p cardinality
+   // builds chunks of entities of every family concurrently, each in its own matrix, and appends the matrices in the
+   // order of the chunks
+   void create_constraints_parallel();
+
+   void create_teacher_available_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   void create_teacher_has_lesson_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   void create_teacher_is_in_school_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   // the rows of create_teacher_is_in_school_constraints that keep a teacher out of school before the first lesson
+   // and after the last, alone: the others are lazy with ModelOptions::lazy_rows
+   void create_teacher_not_in_school_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   void create_teacher_not_in_school_rows(ConstraintSink &sink, unsigned int teacher_id, unsigned int day_idx,
+                                          unsigned int hour_idx) const;
+   // the CompactInSchool alternative to create_teacher_is_in_school_constraints
+   void create_teacher_is_in_school_compact_constraints(ConstraintSink &sink, unsigned int first,
+                                                        unsigned int last) const;
+   void create_class_sovrapposition_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   void create_num_lessons_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   void prevent_non_consecutive_hours(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   // the BlockStartContiguity alternative to prevent_non_consecutive_hours
+   void create_block_start_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   void create_cons_var_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   void create_day_weight_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   void create_day_weight_sorted_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+   // the KSumDayWeight alternative to create_day_weight_sorted_constraints
+   void create_day_weight_k_sum_constraints(ConstraintSink &sink, unsigned int first, unsigned int last) const;
+
+   // all the possible subsets of [0, Input::NUM_DAYS_IN_WEEK) of cardinality @p cardinality. Only needed by
+   // SubsetsDayWeight
    void initialize_sorted_subsets();
 
    std::vector<std::vector<std::vector<unsigned int>>> _sorted_subsets;
    const Input &_input;
    const Variables &_variables;
    Objective _objective;
-   std::vector<Constraint> _constraints;
+   Storage _storage;
+   unsigned int _num_threads;
+   ConstraintMatrix _constraints;  // empty in Streaming mode
+   std::vector<FamilyRows> _family_rows;
 };
 
 
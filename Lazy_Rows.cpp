@@ -0,0 +1,32 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include "Lazy_Rows.h"
+
+size_t LazyRows::separate(const std::vector<double> &values, double tolerance, ConstraintMatrix &rows) const {
+   if (_presolve == nullptr) {
+      return _provider.separate_lazy_rows(values, tolerance, rows);
+   }
+   std::vector<double> original_values = _presolve->postsolve(values);
+   ConstraintMatrix original_rows;
+   size_t num_rows = _provider.separate_lazy_rows(original_values, tolerance, original_rows);
+   for (size_t row_idx = 0; row_idx != num_rows; ++row_idx) {
+      ConstraintMatrix::RowView row = original_rows.row(row_idx);
+      double rhs = row.rhs;
+      for (VarIdxCoeffPair entry: row.lhs) {
+         if (_presolve->reduced_column(entry.var_idx) == Presolve::Removed) {
+            rhs -= entry.coeff * original_values[entry.var_idx];
+         }
+      }
+      rows.begin_row(row.rel, rhs);
+      for (VarIdxCoeffPair entry: row.lhs) {
+         Presolve::VarID col = _presolve->reduced_column(entry.var_idx);
+         if (col != Presolve::Removed) {
+            rows.add_entry(col, entry.coeff);
+         }
+      }
+      rows.end_row();
+   }
+   return num_rows;
+}
@@ -0,0 +1,27 @@
+#ifndef SCHEDULE_HIGHSCHOOL_LAZY_ROWS_H
+#define SCHEDULE_HIGHSCHOOL_LAZY_ROWS_H
+
+#include <vector>
+#include "BB_Solver.h"
+#include "LP_Provider.h"
+#include "Presolve.h"
+
+// The rows that ModelOptions::lazy_rows leaves out of the model of an LP_Provider, for BB_Solver to add where a
+// solution violates them. With a Presolve the solver sees the reduced model: its solutions are mapped back to the
+// original columns to be separated, and the rows are mapped to the reduced columns, the fixed ones moved to the rhs.
+// This is sound because presolve only fixes the columns of the lazy rows from the rows that are left: each of them
+// is also in a row of the model
+class LazyRows : public RowSeparator {
+public:
+   explicit LazyRows(const LP_Provider &provider_, const Presolve *presolve_ = nullptr) : _provider{provider_},
+                                                                                         _presolve{presolve_} {}
+
+   size_t separate(const std::vector<double> &values, double tolerance, ConstraintMatrix &rows) const override;
+
+private:
+   const LP_Provider &_provider;
+   const Presolve *_presolve;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_LAZY_ROWS_H
@@ -0,0 +1,83 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <cmath>
+#include "MIP_Model.h"
+#include "Trace.h"
+
+MIP_Model::MIP_Model(const LP_Provider &provider) : direction{provider.get_objective_direction()},
+                                                    objective_offset{0.0} {
+   TRACE_ROWS_SCOPE("MIP_Model", constraints);
+   const Variables &variables = provider.get_variables();
+   objective.assign(variables.num_var(), 0.0);
+   lower.assign(variables.num_var(), 0.0);
+   upper.assign(variables.num_var(), std::numeric_limits<double>::infinity());
+   column_type.assign(variables.num_var(), Continuous);
+   for (VarID col = 0; col != variables.num_01_var(); ++col) {
+      upper[col] = 1.0;
+      column_type[col] = Binary;
+   }
+   if (direction != LP_Provider::Feasible) {
+      for (const VarIdxCoeffPair &entry: provider.get_objective().lin_vec) {
+         objective[entry.var_idx] += entry.coeff;
+      }
+   }
+   CountingSink counter;
+   provider.stream_constraints(counter);
+   constraints.reserve(counter.num_rows(), counter.num_nonzeros());
+   provider.stream_constraints(constraints);
+}
+
+MIP_Model::VarID MIP_Model::add_column(ColumnType type, double obj, double lb, double ub) {
+   objective.push_back(obj);
+   lower.push_back(lb);
+   upper.push_back(ub);
+   column_type.push_back(type);
+   return num_columns() - 1;
+}
+
+double MIP_Model::evaluate(const std::vector<double> &values) const {
+   double value = objective_offset;
+   for (VarID col = 0; col != num_columns(); ++col) {
+      value += objective[col] * values[col];
+   }
+   return value;
+}
+
+bool MIP_Model::is_feasible(const std::vector<double> &values, double tolerance, std::string *reason) const {
+   if (values.size() != num_columns()) {
+      if (reason != nullptr) {
+         *reason = "wrong number of values";
+      }
+      return false;
+   }
+   for (VarID col = 0; col != num_columns(); ++col) {
+      if (values[col] < lower[col] - tolerance or values[col] > upper[col] + tolerance or
+          (is_binary(col) and std::abs(values[col] - std::round(values[col])) > tolerance)) {
+         if (reason != nullptr) {
+            *reason = "column " + std::to_string(col) + " has value " + std::to_string(values[col]);
+         }
+         return false;
+      }
+   }
+   for (size_t row_idx = 0; row_idx != num_rows(); ++row_idx) {
+      ConstraintMatrix::RowView row = constraints.row(row_idx);
+      double activity = 0.0;
+      for (VarIdxCoeffPair entry: row.lhs) {
+         activity += entry.coeff * values[entry.var_idx];
+      }
+      double scaled_tolerance = tolerance * (1.0 + std::abs(row.rhs));
+      bool violated = (row.rel == ConstraintSink::Leq and activity > row.rhs + scaled_tolerance) or
+                      (row.rel == ConstraintSink::Geq and activity < row.rhs - scaled_tolerance) or
+                      (row.rel == ConstraintSink::Eq and std::abs(activity - row.rhs) > scaled_tolerance);
+      if (violated) {
+         if (reason != nullptr) {
+            *reason = "row " + std::to_string(row_idx) + " has activity " + std::to_string(activity) + " and rhs " +
+                      std::to_string(row.rhs);
+         }
+         return false;
+      }
+   }
+   return true;
+}
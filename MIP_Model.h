@@ -0,0 +1,49 @@
+#ifndef SCHEDULE_HIGHSCHOOL_MIP_MODEL_H
+#define SCHEDULE_HIGHSCHOOL_MIP_MODEL_H
+
+#include <string>
+#include <vector>
+#include "Constraint_Matrix.h"
+#include "LP_Provider.h"
+
+// Self-contained mixed 0-1 model, as seen by the solvers: dense objective, column bounds and types, and the rows
+struct MIP_Model {
+   typedef Variables::VarID VarID;
+
+   enum ColumnType : unsigned char {
+      Continuous, Binary
+   };
+
+   LP_Provider::Direction direction;
+   std::vector<double> objective;  // one coefficient for each column
+   double objective_offset;
+   std::vector<double> lower;
+   std::vector<double> upper;
+   std::vector<ColumnType> column_type;
+   ConstraintMatrix constraints;
+
+   explicit MIP_Model(LP_Provider::Direction direction_ = LP_Provider::Min) : direction{direction_},
+                                                                             objective_offset{0.0} {}
+
+   // columns [0, num_01_var()) of the provider are binaries, the others are continuous and non-negative
+   explicit MIP_Model(const LP_Provider &provider);
+
+   [[nodiscard]] size_t num_columns() const { return objective.size(); }
+
+   [[nodiscard]] size_t num_rows() const { return constraints.num_rows(); }
+
+   [[nodiscard]] bool is_binary(VarID col) const { return column_type[col] == Binary; }
+
+   // appends a column and returns its index
+   VarID add_column(ColumnType type, double obj, double lb, double ub);
+
+   // objective value of @p values, offset included
+   [[nodiscard]] double evaluate(const std::vector<double> &values) const;
+
+   // checks bounds, integrality and rows within @p tolerance. If not feasible and @p reason is given, describes why
+   [[nodiscard]] bool is_feasible(const std::vector<double> &values, double tolerance = 1e-6,
+                                  std::string *reason = nullptr) const;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_MIP_MODEL_H
@@ -0,0 +1,39 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Mapped_File.h"
+
+MappedFile::MappedFile(const std::string &path_) : _data{nullptr}, _size{0}, _is_open{false} {
+   int fd = ::open(path_.c_str(), O_RDONLY);
+   if (fd < 0) {
+      return;
+   }
+   struct stat file_stat{};
+   if (::fstat(fd, &file_stat) == 0 and S_ISREG(file_stat.st_mode)) {
+      _size = file_stat.st_size;
+      if (_size == 0) {
+         _is_open = true;  // mmap refuses empty mappings, and there is nothing to read anyway
+      } else {
+         void *address = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (address != MAP_FAILED) {
+            ::madvise(address, _size, MADV_SEQUENTIAL);
+            _data = static_cast<const char *>(address);
+            _is_open = true;
+         } else {
+            _size = 0;
+         }
+      }
+   }
+   ::close(fd);  // the mapping stays valid without the descriptor
+}
+
+MappedFile::~MappedFile() {
+   if (_data != nullptr) {
+      ::munmap(const_cast<char *>(_data), _size);
+   }
+}
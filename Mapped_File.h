@@ -0,0 +1,34 @@
+#ifndef SCHEDULE_HIGHSCHOOL_MAPPED_FILE_H
+#define SCHEDULE_HIGHSCHOOL_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// A read-only view of a whole file, mapped in memory: its content is never copied. Like std::ifstream, a file that
+// cannot be opened gives an object that is not open
+class MappedFile {
+public:
+   explicit MappedFile(const std::string &path_);
+
+   MappedFile(const MappedFile &) = delete;
+
+   MappedFile &operator=(const MappedFile &) = delete;
+
+   ~MappedFile();
+
+   [[nodiscard]] bool is_open() const { return _is_open; }
+
+   [[nodiscard]] const char *begin() const { return _data; }
+
+   [[nodiscard]] const char *end() const { return _data + _size; }
+
+   [[nodiscard]] size_t size() const { return _size; }
+
+private:
+   const char *_data;
+   size_t _size;
+   bool _is_open;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_MAPPED_FILE_H
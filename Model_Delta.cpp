@@ -0,0 +1,312 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <cstring>
+#include <stdexcept>
+#include "Model_Delta.h"
+#include "Trace.h"
+
+void ChangeSet::apply(MIP_Model &model) const {
+   if (model.num_columns() != num_columns or model.num_rows() != num_rows) {
+      throw std::logic_error("The change set is for a model with " + std::to_string(num_columns) + " columns and " +
+                             std::to_string(num_rows) + " rows");
+   }
+   for (const CostChange &change: cost_changes) {
+      model.objective[change.column] = change.cost;
+   }
+   for (const BoundChange &change: bound_changes) {
+      model.lower[change.column] = change.lower;
+      model.upper[change.column] = change.upper;
+   }
+   for (const RhsChange &change: rhs_changes) {
+      model.constraints.set_rhs(change.row, change.rhs);
+   }
+   for (const NewColumn &column: new_columns) {
+      model.add_column(column.type, column.cost, column.lower, column.upper);
+   }
+   model.constraints.append(new_rows);
+   for (size_t row: removed_rows) {
+      model.constraints.clear_row(row);
+   }
+}
+
+ModelDelta::ModelDelta(const Input &input_, const LP_Provider &provider_)
+      : _input{input_}, _variables{provider_.get_variables()}, _provider{provider_},
+        _num_columns{_variables.num_var()}, _num_rows{provider_.num_constraints()},
+        _num_provider_rows{provider_.num_constraints()}, _teacher_requirements(input_.num_teachers()) {
+   TRACE_SCOPE("ModelDelta::ModelDelta");
+   if (_provider.get_storage() != LP_Provider::InMemory) {
+      throw std::logic_error("ModelDelta needs the rows of the model in memory");
+   }
+   _teacher_available_begin = family_first_row("create_teacher_available_constraints");
+   _teacher_has_lesson_begin = family_first_row("create_teacher_has_lesson_constraints");
+   _day_weight_begin = family_first_row("create_day_weight_constraints");
+   _class_hours_begin = family_first_row("create_class_sovrapposition_constraints");
+   size_t num_lessons_begin = family_first_row("create_num_lessons_constraints");
+   size_t cons_row = family_first_row("create_cons_var_constraints");
+
+   size_t class_row = 0;
+   for (const Input::Class &school_class: _input.get_classes()) {
+      _class_first_row.push_back(class_row);
+      for (unsigned int hours: school_class.num_hours_per_day) {
+         class_row += hours;
+      }
+   }
+   _penalties.reserve(_input.num_teachers());
+   for (const Input::Teacher &teacher: _input.get_teachers()) {
+      _penalties.push_back(teacher.penalties);
+   }
+   _requirements.reserve(_input.num_requirements());
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      const Input::Requirement &requirement = _input.get_requirements()[req_idx];
+      RequirementState state{unsigned(_input.convert_from_teacher_id(requirement.teacher_id())),
+                             unsigned(_input.convert_from_class_id(requirement.class_id())),
+                             requirement.average_lesson_weight, num_lessons_begin + req_idx, NO_ROW,
+                             WeekGrid<VarID>(Variables::InvalidVarID), false};
+      // as create_cons_var_constraints: the count of the pairs, then two rows for every pair
+      if (requirement.num_days_with_cons_hours != 0) {
+         state.cons_row = cons_row;
+         cons_row += 1 + 2 * _variables.get_pair_slots(req_idx).count();
+      }
+      for (WeekMask slots = _variables.get_lesson_slots(req_idx); not slots.empty();) {
+         unsigned int slot = slots.pop_lowest();
+         unsigned int day = WeekShape::day_of(slot);
+         state.lessons[slot] = _variables.requirement_var(req_idx, day, slot - WeekShape::DAY_BEGIN[day]);
+      }
+      _teacher_requirements[state.teacher_idx].push_back(req_idx);
+      _requirements.push_back(state);
+   }
+}
+
+ChangeSet ModelDelta::update_teacher_penalties(unsigned int teacher_idx, const WeekGrid<int> &penalties) {
+   TRACE_SCOPE("ModelDelta::update_teacher_penalties");
+   const Input::Teacher &teacher = _input.get_teachers().at(teacher_idx);
+   // checks the penalties, and marks the unavailable hours
+   Input::Teacher updated(teacher.id / Input::MAX_ID, teacher.name, penalties);
+   ChangeSet changes(_num_columns, _num_rows);
+   PendingEntries pending;
+   for (unsigned int slot = 0; slot != WeekShape::NUM_SLOTS; ++slot) {
+      int old_penalty = _penalties[teacher_idx][slot];
+      int new_penalty = updated.penalties[slot];
+      if (old_penalty == new_penalty) {
+         continue;
+      }
+      unsigned int day = WeekShape::day_of(slot);
+      unsigned int hour = slot - WeekShape::DAY_BEGIN[day];
+      bool available = new_penalty != Input::Teacher::InvalidPenality;
+      // as create_objective: no cost at the hours at which the teacher is unavailable
+      changes.cost_changes.push_back(ChangeSet::CostChange{_variables.teacher_is_in_school_var(teacher_idx, day, hour),
+                                                           available ? double(new_penalty) : 0.0});
+      if (available == (old_penalty != Input::Teacher::InvalidPenality)) {
+         continue;
+      }
+      set_rhs(changes, _teacher_available_begin + size_t(teacher_idx) * WeekShape::NUM_SLOTS + slot,
+              available ? 1.0 : 0.0);
+      for (unsigned int req_idx: _teacher_requirements[teacher_idx]) {
+         RequirementState &state = _requirements[req_idx];
+         if (state.removed or hour >= _input.get_classes()[state.class_idx].num_hours_per_day[day]) {
+            continue;
+         }
+         if (state.lessons[slot] != Variables::InvalidVarID) {
+            changes.bound_changes.push_back(ChangeSet::BoundChange{state.lessons[slot], 0.0, available ? 1.0 : 0.0});
+         } else if (available) {
+            add_lesson(changes, pending, req_idx, slot);
+         }
+      }
+   }
+   replace_rows(changes, pending);
+   _penalties[teacher_idx] = updated.penalties;
+   return changes;
+}
+
+ChangeSet ModelDelta::add_requirement(unsigned int teacher_idx, unsigned int class_idx, std::string_view lessons_code,
+                                      unsigned int num_days_with_cons_hours) {
+   TRACE_SCOPE("ModelDelta::add_requirement");
+   const Input::Teacher &teacher = _input.get_teachers().at(teacher_idx);
+   const Input::Class &school_class = _input.get_classes().at(class_idx);
+   Input::Requirement requirement(teacher.id / Input::MAX_ID, school_class.id, lessons_code,
+                                  num_days_with_cons_hours);
+   ChangeSet changes(_num_columns, _num_rows);
+   unsigned int req_idx = _requirements.size();
+   _requirements.push_back(RequirementState{teacher_idx, class_idx, requirement.average_lesson_weight, NO_ROW,
+                                            NO_ROW, WeekGrid<VarID>(Variables::InvalidVarID), false});
+   _teacher_requirements[teacher_idx].push_back(req_idx);
+   PendingEntries pending;
+   std::vector<VarIdxCoeffPair> lessons;
+   for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+      for (unsigned int hour = 0; hour != school_class.num_hours_per_day[day]; ++hour) {
+         unsigned int slot = WeekShape::slot(day, hour);
+         if (_penalties[teacher_idx][slot] != Input::Teacher::InvalidPenality) {
+            add_lesson(changes, pending, req_idx, slot);
+            lessons.emplace_back(_requirements[req_idx].lessons[slot], 1.0);
+         }
+      }
+   }
+   replace_rows(changes, pending);
+   RequirementState &state = _requirements[req_idx];
+   state.num_lessons_row = add_row(changes, ConstraintSink::Eq, requirement.num_lessons(), lessons);
+
+   if (num_days_with_cons_hours != 0) {
+      // as create_cons_var_constraints, on the pairs of adjacent hours that both have a lesson
+      std::vector<VarIdxCoeffPair> pairs;
+      for (unsigned int slot = 0; slot + 1 < WeekShape::NUM_SLOTS; ++slot) {
+         if (state.lessons[slot] == Variables::InvalidVarID or state.lessons[slot + 1] == Variables::InvalidVarID or
+             WeekShape::day_of(slot) != WeekShape::day_of(slot + 1)) {
+            continue;
+         }
+         VarID pair = add_column(changes, MIP_Model::Binary, 0.0, 0.0, 1.0);
+         pairs.emplace_back(pair, 1.0);
+         for (VarID lesson: {state.lessons[slot], state.lessons[slot + 1]}) {
+            add_row(changes, ConstraintSink::Leq, 0.0, {VarIdxCoeffPair(pair, 1.0), VarIdxCoeffPair(lesson, -1.0)});
+         }
+      }
+      state.cons_row = add_row(changes, ConstraintSink::Eq, num_days_with_cons_hours, pairs);
+   }
+   return changes;
+}
+
+ChangeSet ModelDelta::remove_requirement(unsigned int req_idx) {
+   TRACE_SCOPE("ModelDelta::remove_requirement");
+   RequirementState &state = _requirements.at(req_idx);
+   if (state.removed) {
+      throw std::logic_error("The requirement " + std::to_string(req_idx) + " is already removed");
+   }
+   ChangeSet changes(_num_columns, _num_rows);
+   for (unsigned int slot = 0; slot != WeekShape::NUM_SLOTS; ++slot) {
+      if (state.lessons[slot] != Variables::InvalidVarID) {
+         changes.bound_changes.push_back(ChangeSet::BoundChange{state.lessons[slot], 0.0, 0.0});
+      }
+   }
+   // the pairs of consecutive hours follow the lessons to 0, and so must their count
+   set_rhs(changes, state.num_lessons_row, 0.0);
+   if (state.cons_row != NO_ROW) {
+      set_rhs(changes, state.cons_row, 0.0);
+   }
+   state.removed = true;
+   return changes;
+}
+
+size_t ModelDelta::family_first_row(const char *name) const {
+   for (const LP_Provider::FamilyRows &family: _provider.get_family_rows()) {
+      if (std::strcmp(family.name, name) == 0) {
+         return family.first_row;
+      }
+   }
+   // a family without rows, which no entity needs
+   return NO_ROW;
+}
+
+size_t ModelDelta::current_row(size_t row) const {
+   for (auto moved = _moved_rows.find(row); moved != _moved_rows.end(); moved = _moved_rows.find(row)) {
+      row = moved->second;
+   }
+   return row;
+}
+
+ConstraintMatrix::RowView ModelDelta::row_view(size_t row) const {
+   if (row >= _num_provider_rows) {
+      return _added_rows.row(row - _num_provider_rows);
+   }
+   ConstraintMatrix::RowView view = _provider.get_constraint(row);
+   auto rhs = _provider_rhs.find(row);
+   if (rhs != _provider_rhs.end()) {
+      view.rhs = rhs->second;
+   }
+   return view;
+}
+
+size_t ModelDelta::class_hour_row(unsigned int class_idx, unsigned int day, unsigned int hour) const {
+   // as create_class_sovrapposition_constraints: the hours of the class, day by day
+   size_t row = _class_hours_begin + _class_first_row[class_idx] + hour;
+   for (unsigned int previous_day = 0; previous_day != day; ++previous_day) {
+      row += _input.get_classes()[class_idx].num_hours_per_day[previous_day];
+   }
+   return row;
+}
+
+ModelDelta::VarID ModelDelta::add_column(ChangeSet &changes, MIP_Model::ColumnType type, double cost, double lower,
+                                         double upper) {
+   changes.new_columns.push_back(ChangeSet::NewColumn{type, cost, lower, upper});
+   return _num_columns++;
+}
+
+size_t ModelDelta::add_row(ChangeSet &changes, ConstraintSink::Relation rel, double rhs,
+                           const std::vector<VarIdxCoeffPair> &entries) {
+   for (ConstraintMatrix *rows: {&changes.new_rows, &_added_rows}) {
+      rows->begin_row(rel, rhs);
+      for (const VarIdxCoeffPair &entry: entries) {
+         rows->add_entry(entry.var_idx, entry.coeff);
+      }
+      rows->end_row();
+   }
+   return _num_rows++;
+}
+
+void ModelDelta::set_rhs(ChangeSet &changes, size_t row, double rhs) {
+   row = current_row(row);
+   if (row >= changes.num_rows) {
+      changes.new_rows.set_rhs(row - changes.num_rows, rhs);
+   } else {
+      changes.rhs_changes.push_back(ChangeSet::RhsChange{row, rhs});
+   }
+   if (row >= _num_provider_rows) {
+      _added_rows.set_rhs(row - _num_provider_rows, rhs);
+   } else {
+      _provider_rhs[row] = rhs;
+   }
+}
+
+void ModelDelta::add_lesson(ChangeSet &changes, PendingEntries &pending, unsigned int req_idx, unsigned int slot) {
+   RequirementState &state = _requirements[req_idx];
+   unsigned int day = WeekShape::day_of(slot);
+   unsigned int hour = slot - WeekShape::DAY_BEGIN[day];
+   VarID lesson = add_column(changes, MIP_Model::Binary, 0.0, 0.0, 1.0);
+   state.lessons[slot] = lesson;
+   pending[current_row(class_hour_row(state.class_idx, day, hour))].emplace_back(lesson, 1.0);
+   pending[current_row(_teacher_has_lesson_begin + size_t(state.teacher_idx) * WeekShape::NUM_SLOTS + slot)]
+         .emplace_back(lesson, 1.0);
+   pending[current_row(_day_weight_begin + size_t(state.class_idx) * WeekShape::NUM_DAYS + day)]
+         .emplace_back(lesson, -state.lesson_weight);
+   if (state.num_lessons_row != NO_ROW) {
+      pending[current_row(state.num_lessons_row)].emplace_back(lesson, 1.0);
+   }
+   // as prevent_non_consecutive_hours
+   for (unsigned int other_hour = 0; other_hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++other_hour) {
+      VarID other = state.lessons(day, other_hour);
+      if (other != Variables::InvalidVarID and (other_hour + 2 <= hour or hour + 2 <= other_hour)) {
+         add_row(changes, ConstraintSink::Leq, 1.0, {VarIdxCoeffPair(lesson, 1.0), VarIdxCoeffPair(other, 1.0)});
+      }
+   }
+   if (state.cons_row == NO_ROW) {
+      return;
+   }
+   // as create_cons_var_constraints, the pairs with the adjacent hours of the day that have a lesson; hour - 1
+   // wraps past the day at hour 0
+   for (unsigned int other_hour: {hour - 1, hour + 1}) {
+      if (other_hour >= WeekShape::NUM_HOURS_PER_DAY[day] or
+          state.lessons(day, other_hour) == Variables::InvalidVarID) {
+         continue;
+      }
+      VarID pair = add_column(changes, MIP_Model::Binary, 0.0, 0.0, 1.0);
+      for (VarID paired: {lesson, state.lessons(day, other_hour)}) {
+         add_row(changes, ConstraintSink::Leq, 0.0, {VarIdxCoeffPair(pair, 1.0), VarIdxCoeffPair(paired, -1.0)});
+      }
+      pending[current_row(state.cons_row)].emplace_back(pair, 1.0);
+   }
+}
+
+void ModelDelta::replace_rows(ChangeSet &changes, const PendingEntries &pending) {
+   for (const auto &[row, new_entries]: pending) {
+      ConstraintMatrix::RowView view = row_view(row);
+      std::vector<VarIdxCoeffPair> entries;
+      entries.reserve(view.lhs.size() + new_entries.size());
+      for (const VarIdxCoeffPair &entry: view.lhs) {
+         entries.push_back(entry);
+      }
+      entries.insert(entries.end(), new_entries.begin(), new_entries.end());
+      size_t replacement = add_row(changes, view.rel, view.rhs, entries);
+      changes.removed_rows.push_back(row);
+      _moved_rows[row] = replacement;
+   }
+}
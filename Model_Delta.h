@@ -0,0 +1,153 @@
+#ifndef SCHEDULE_HIGHSCHOOL_MODEL_DELTA_H
+#define SCHEDULE_HIGHSCHOOL_MODEL_DELTA_H
+
+#include <map>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Constraint_Matrix.h"
+#include "Input.h"
+#include "LP_Provider.h"
+#include "MIP_Model.h"
+
+// The changes that an edit of the input makes to a MIP_Model built from an LP_Provider, to be applied to the model
+// instead of building it again. Rows are never edited in place: a row that needs new columns is removed (its
+// coefficients set to zero, which presolve drops) and added again at the end with them. A change set applies to the
+// model with exactly num_columns columns and num_rows rows, so the change sets of a ModelDelta apply in order
+struct ChangeSet {
+   typedef MIP_Model::VarID VarID;
+
+   struct CostChange {
+      VarID column;
+      double cost;
+   };
+
+   struct BoundChange {
+      VarID column;
+      double lower;
+      double upper;
+   };
+
+   struct RhsChange {
+      size_t row;
+      double rhs;
+   };
+
+   struct NewColumn {
+      MIP_Model::ColumnType type;
+      double cost;
+      double lower;
+      double upper;
+   };
+
+   size_t num_columns;  // of the model before the changes
+   size_t num_rows;
+   std::vector<CostChange> cost_changes;
+   std::vector<BoundChange> bound_changes;
+   std::vector<RhsChange> rhs_changes;
+   std::vector<size_t> removed_rows;
+   std::vector<NewColumn> new_columns;  // from num_columns on
+   ConstraintMatrix new_rows;  // from num_rows on, with the new columns too
+
+   ChangeSet(size_t num_columns_, size_t num_rows_) : num_columns{num_columns_}, num_rows{num_rows_} {}
+
+   // Throws std::logic_error if @p model does not have num_columns columns and num_rows rows
+   void apply(MIP_Model &model) const;
+};
+
+// Edits of the input of an LP_Provider, as ChangeSets of its model, in time proportional to the edit. The provider
+// must store its rows (InMemory): they are indexed once, here, and read when they need new columns. Input,
+// Variables and the provider are not changed; the lessons of the requirements added here are new columns, which
+// lesson_column() finds. The contiguity of their lessons is kept by the pairwise rows of prevent_non_consecutive_hours
+// in every formulation
+class ModelDelta {
+public:
+   typedef MIP_Model::VarID VarID;
+
+   ModelDelta(const Input &input_, const LP_Provider &provider_);
+
+   // gives teacher @p teacher_idx the penalties @p penalties, as in the input: a negative one for an hour at which
+   // the teacher is unavailable. The objective of the in-school columns and the availability rows change; the
+   // lessons at the hours that become unavailable are fixed to 0, and those at the hours that become available are
+   // freed, or added if the model has none. Throws std::logic_error if the penalties are not valid
+   ChangeSet update_teacher_penalties(unsigned int teacher_idx, const WeekGrid<int> &penalties);
+
+   // adds a requirement of teacher @p teacher_idx in class @p class_idx (positions in Input), with lessons and
+   // days with consecutive hours as in the input. Its position is the next one of num_requirements(). The hours of
+   // the class are not changed: remove_requirement() usually makes room for it first
+   ChangeSet add_requirement(unsigned int teacher_idx, unsigned int class_idx, std::string_view lessons_code,
+                             unsigned int num_days_with_cons_hours);
+
+   // fixes the lessons of @p req_idx to 0 and its rows to no lessons. Throws std::logic_error if it is already removed
+   ChangeSet remove_requirement(unsigned int req_idx);
+
+   // the requirements of the input, then those added here
+   [[nodiscard]] unsigned int num_requirements() const { return _requirements.size(); }
+
+   // the lesson column of @p req_idx at that hour, InvalidVarID if it has none
+   [[nodiscard]] VarID lesson_column(unsigned int req_idx, unsigned int day, unsigned int hour) const {
+      return _requirements[req_idx].lessons(day, hour);
+   }
+
+private:
+   static constexpr size_t NO_ROW = std::numeric_limits<size_t>::max();
+
+   struct RequirementState {
+      unsigned int teacher_idx;
+      unsigned int class_idx;
+      double lesson_weight;
+      size_t num_lessons_row;
+      size_t cons_row;  // NO_ROW if it wants no consecutive hours
+      WeekGrid<VarID> lessons;
+      bool removed;
+   };
+
+   // the entries to add to existing rows, by their current position; ordered, so that the rows are replaced in the
+   // same order on every run
+   typedef std::map<size_t, std::vector<VarIdxCoeffPair>> PendingEntries;
+
+   [[nodiscard]] size_t family_first_row(const char *name) const;
+
+   // where @p row is now, after the replacements
+   [[nodiscard]] size_t current_row(size_t row) const;
+
+   [[nodiscard]] ConstraintMatrix::RowView row_view(size_t row) const;
+
+   [[nodiscard]] size_t class_hour_row(unsigned int class_idx, unsigned int day, unsigned int hour) const;
+
+   VarID add_column(ChangeSet &changes, MIP_Model::ColumnType type, double cost, double lower, double upper);
+
+   size_t add_row(ChangeSet &changes, ConstraintSink::Relation rel, double rhs,
+                  const std::vector<VarIdxCoeffPair> &entries);
+
+   void set_rhs(ChangeSet &changes, size_t row, double rhs);
+
+   // a lesson column of @p req_idx at @p slot, with its entries in the rows of the class, the teacher and the
+   // requirement, the contiguity rows with its other lessons of the day, and the pairs of consecutive hours with
+   // them if the requirement already has its row of days with consecutive hours
+   void add_lesson(ChangeSet &changes, PendingEntries &pending, unsigned int req_idx, unsigned int slot);
+
+   // replaces every row of @p pending with a copy that has the new entries too
+   void replace_rows(ChangeSet &changes, const PendingEntries &pending);
+
+   const Input &_input;
+   const Variables &_variables;
+   const LP_Provider &_provider;
+   size_t _num_columns;
+   size_t _num_rows;
+   size_t _num_provider_rows;
+   ConstraintMatrix _added_rows;  // the rows after those of the provider
+   std::unordered_map<size_t, size_t> _moved_rows;  // replaced row -> its replacement
+   std::unordered_map<size_t, double> _provider_rhs;  // the rhs changed in the rows of the provider
+   std::vector<RequirementState> _requirements;
+   std::vector<std::vector<unsigned int>> _teacher_requirements;
+   std::vector<WeekGrid<int>> _penalties;  // Teacher::InvalidPenality where unavailable
+   size_t _teacher_available_begin;
+   size_t _teacher_has_lesson_begin;
+   size_t _day_weight_begin;
+   size_t _class_hours_begin;
+   std::vector<size_t> _class_first_row;  // from _class_hours_begin
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_MODEL_DELTA_H
@@ -0,0 +1,38 @@
+#ifndef SCHEDULE_HIGHSCHOOL_MODEL_OPTIONS_H
+#define SCHEDULE_HIGHSCHOOL_MODEL_OPTIONS_H
+
+// The choice between equivalent formulations of parts of the model. They are given to Variables, which creates the
+// variables that a formulation needs, and LP_Provider reads them from there
+struct ModelOptions {
+   // how teacher_is_in_school is bound to teacher_has_lesson
+   enum InSchoolFormulation {
+      PairwiseInSchool,  // one row for every pair of lesson hours around an hour: O(H^3) rows per teacher and day
+      CompactInSchool  // continuous "lessons begun" and "lessons not over" variables: O(H) rows per teacher and day
+   };
+
+   // how the sorted day weights of a class are bound to the day weights
+   enum DayWeightFormulation {
+      SubsetsDayWeight,  // one row for every subset of the days: O(2^D) rows per class
+      KSumDayWeight  // the dual of "sum of the k largest": O(D^2) continuous variables and rows per class
+   };
+
+   // how the lessons of a requirement on a day are kept in one block of at most two hours
+   enum ContiguityFormulation {
+      PairwiseContiguity,  // one row for every pair of hours that are not adjacent: O(H^2) rows per requirement and day
+      BlockStartContiguity  // continuous "block starts here" variables: O(H) rows per requirement and day, and a
+                            // tighter relaxation, since they imply every pairwise row
+   };
+
+   InSchoolFormulation in_school;
+   DayWeightFormulation day_weight;
+   ContiguityFormulation contiguity;
+   // leaves out of the model the O(H^3) rows of PairwiseInSchool and the rows of PairwiseContiguity, which are
+   // mostly slack at the optimum: the solver adds them where a solution violates them (see Lazy_Rows.h)
+   bool lazy_rows;
+
+   ModelOptions() : in_school{PairwiseInSchool}, day_weight{SubsetsDayWeight}, contiguity{PairwiseContiguity},
+                    lazy_rows{false} {}
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_MODEL_OPTIONS_H
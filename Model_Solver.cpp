@@ -0,0 +1,57 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include "Model_Solver.h"
+
+namespace {
+   // of the check of a solution against the rows of the model
+   constexpr double CHECK_TOLERANCE = 1e-6;
+}
+
+ModelSolver::ModelSolver(const LP_Provider &provider_, const MIP_Model &model_, bool use_presolve,
+                         BB_Solver::Options options)
+      : _provider{provider_}, _model{model_}, _presolve{use_presolve ? std::make_unique<Presolve>(model_) : nullptr},
+        _lazy_rows(provider_, _presolve.get()) {
+   if (is_infeasible()) {
+      return;
+   }
+   options.branching_priority = _provider.branching_priorities();
+   if (_presolve) {
+      options.branching_priority = _presolve->reduce_columns(options.branching_priority);
+   }
+   options.separator = _provider.get_variables().get_options().lazy_rows ? &_lazy_rows : nullptr;
+   _solver = std::make_unique<BB_Solver>(_presolve ? _presolve->get_model() : _model, std::move(options));
+}
+
+bool ModelSolver::set_start(const std::vector<double> &values) {
+   if (not _solver) {
+      return false;
+   }
+   return _solver->set_incumbent(_presolve ? _presolve->reduce(values) : values);
+}
+
+BB_Solver::Result ModelSolver::solve() {
+   if (not _solver) {
+      BB_Solver::Result result;
+      result.status = BB_Solver::Infeasible;
+      return result;
+   }
+   BB_Solver::Result result = _solver->solve();
+   if (result.has_solution() and _presolve) {
+      result.values = _presolve->postsolve(result.values);
+   }
+   return result;
+}
+
+bool ModelSolver::check(const std::vector<double> &values, std::string &reason) const {
+   if (not _model.is_feasible(values, CHECK_TOLERANCE, &reason)) {
+      return false;
+   }
+   CountingSink violated_rows;
+   if (_provider.separate_lazy_rows(values, CHECK_TOLERANCE, violated_rows) != 0) {
+      reason = std::to_string(violated_rows.num_rows()) + " lazy rows are violated";
+      return false;
+   }
+   return true;
+}
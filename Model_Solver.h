@@ -0,0 +1,47 @@
+#ifndef SCHEDULE_HIGHSCHOOL_MODEL_SOLVER_H
+#define SCHEDULE_HIGHSCHOOL_MODEL_SOLVER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "BB_Solver.h"
+#include "LP_Provider.h"
+#include "Lazy_Rows.h"
+#include "MIP_Model.h"
+#include "Presolve.h"
+
+// The steps from the model of an LP_Provider to its solution, as the program takes them, for the program, the parts
+// of SchoolComponents and tools/Batch_Solve: the presolve, unless it is disabled, the rows left out by
+// ModelOptions::lazy_rows as the RowSeparator of the solver, branch-and-bound with the branching priorities of the
+// provider, and the postsolve of the values back to the columns of the model
+class ModelSolver {
+public:
+   // @p model_ is built from @p provider_, and may have more terms in its objective, as those of
+   // Schedule::add_disruption. The branching priorities and the separator of @p options are set here
+   ModelSolver(const LP_Provider &provider_, const MIP_Model &model_, bool use_presolve, BB_Solver::Options options);
+
+   // nullptr without presolve
+   [[nodiscard]] const Presolve *get_presolve() const { return _presolve.get(); }
+
+   // the presolve proved that the model has no solution
+   [[nodiscard]] bool is_infeasible() const { return _presolve and _presolve->is_infeasible(); }
+
+   // starting solution, in the columns of the model. Returns false (and ignores it) if it is not feasible
+   bool set_start(const std::vector<double> &values);
+
+   // the values of the result are in the columns of the model
+   BB_Solver::Result solve();
+
+   // whether @p values satisfy the model and the rows left out of it; if not, the reason is in @p reason
+   [[nodiscard]] bool check(const std::vector<double> &values, std::string &reason) const;
+
+private:
+   const LP_Provider &_provider;
+   const MIP_Model &_model;
+   std::unique_ptr<Presolve> _presolve;
+   LazyRows _lazy_rows;
+   std::unique_ptr<BB_Solver> _solver;  // nullptr if the presolve found the model infeasible
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_MODEL_SOLVER_H
@@ -0,0 +1,486 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include "Model_Writer.h"
+
+namespace {
+   // the LP format limits the length of a line, so long rows are wrapped
+   constexpr size_t TERMS_PER_LINE = 8;
+
+   const char *relation_symbol(ConstraintSink::Relation rel) {
+      switch (rel) {
+         case ConstraintSink::Leq: {
+            return " <= ";
+         }
+         case ConstraintSink::Eq: {
+            return " = ";
+         }
+         default: {
+            return " >= ";
+         }
+      }
+   }
+
+   char mps_row_type(ConstraintSink::Relation rel) {
+      switch (rel) {
+         case ConstraintSink::Leq: {
+            return 'L';
+         }
+         case ConstraintSink::Eq: {
+            return 'E';
+         }
+         default: {
+            return 'G';
+         }
+      }
+   }
+
+   void write_row_name(BufferedWriter &out, size_t row_idx) {
+      out.put('R');
+      out.write_integer(row_idx);
+   }
+
+   void write_bound(BufferedWriter &out, double bound) {
+      if (std::isinf(bound)) {
+         out.write(bound < 0 ? "-inf" : "+inf");
+      } else {
+         out.write_number(bound);
+      }
+   }
+
+   // first MPS pass: the ROWS section, and the number of entries of every column
+   class MPS_RowsSink : public ConstraintSink {
+   public:
+      MPS_RowsSink(BufferedWriter &out_, std::vector<size_t> &column_count_)
+            : _out{out_}, _column_count{column_count_}, _num_rows{0} {}
+
+      void begin_row(Relation rel, double) override {
+         _out.put(' ');
+         _out.put(mps_row_type(rel));
+         _out.put(' ');
+         write_row_name(_out, _num_rows++);
+         _out.put('\n');
+      }
+
+      void add_entry(Variables::VarID var_idx, double) override { ++_column_count[var_idx]; }
+
+      void end_row() override {}
+
+   private:
+      BufferedWriter &_out;
+      std::vector<size_t> &_column_count;
+      size_t _num_rows;
+   };
+
+   // second MPS pass: collects the entries of the columns in [_first_column, _last_column)
+   class MPS_ColumnBlockSink : public ConstraintSink {
+   public:
+      MPS_ColumnBlockSink(Variables::VarID first_column_, Variables::VarID last_column_,
+                          std::vector<size_t> &next_free_, std::vector<size_t> &rows_,
+                          std::vector<double> &coeffs_)
+            : _first_column{first_column_}, _last_column{last_column_}, _next_free{next_free_}, _rows{rows_},
+              _coeffs{coeffs_}, _current_row{0}, _num_rows{0} {}
+
+      void begin_row(Relation, double) override { _current_row = _num_rows++; }
+
+      void add_entry(Variables::VarID var_idx, double coeff) override {
+         if (var_idx >= _first_column and var_idx < _last_column) {
+            size_t pos = _next_free[var_idx - _first_column]++;
+            _rows[pos] = _current_row;
+            _coeffs[pos] = coeff;
+         }
+      }
+
+      void end_row() override {}
+
+   private:
+      Variables::VarID _first_column;
+      Variables::VarID _last_column;
+      std::vector<size_t> &_next_free;
+      std::vector<size_t> &_rows;
+      std::vector<double> &_coeffs;
+      size_t _current_row;
+      size_t _num_rows;
+   };
+
+   // third MPS pass: the RHS section
+   class MPS_RhsSink : public ConstraintSink {
+   public:
+      explicit MPS_RhsSink(BufferedWriter &out_) : _out{out_}, _num_rows{0} {}
+
+      void begin_row(Relation, double rhs) override {
+         if (rhs != 0.0) {
+            _out.write(" rhs ", 5);
+            write_row_name(_out, _num_rows);
+            _out.put(' ');
+            _out.write_number(rhs);
+            _out.put('\n');
+         }
+         ++_num_rows;
+      }
+
+      void add_entry(Variables::VarID, double) override {}
+
+      void end_row() override {}
+
+   private:
+      BufferedWriter &_out;
+      size_t _num_rows;
+   };
+}
+
+BufferedWriter::BufferedWriter(std::ostream &os_, size_t capacity_) : _os{os_}, _buffer(capacity_), _size{0} {
+   if (capacity_ < 64) {
+      throw std::logic_error("BufferedWriter needs a buffer of at least 64 bytes");
+   }
+}
+
+void BufferedWriter::write(const char *data, size_t length) {
+   if (_size + length > _buffer.size()) {
+      flush();
+      if (length > _buffer.size()) {
+         _os.write(data, length);
+         return;
+      }
+   }
+   std::memcpy(_buffer.data() + _size, data, length);
+   _size += length;
+}
+
+void BufferedWriter::write_number(double number) {
+   char text[32];
+   auto result = std::to_chars(text, text + sizeof(text), number);
+   write(text, result.ptr - text);
+}
+
+void BufferedWriter::write_integer(size_t number) {
+   char text[24];
+   auto result = std::to_chars(text, text + sizeof(text), number);
+   write(text, result.ptr - text);
+}
+
+void BufferedWriter::flush() {
+   if (_size != 0) {
+      _os.write(_buffer.data(), _size);
+      _size = 0;
+   }
+}
+
+WriterColumns::WriterColumns(const Variables &variables_, const MIP_Model &model_, const std::vector<VarID> &names_)
+      : _variables{variables_}, _model{&model_}, _names{&names_} {
+   if (_names->size() != _model->num_columns()) {
+      throw std::logic_error("Every column of the model needs a name");
+   }
+}
+
+size_t WriterColumns::num_columns() const {
+   return _model == nullptr ? _variables.num_var() : _model->num_columns();
+}
+
+bool WriterColumns::is_binary(VarID col) const {
+   return _model == nullptr ? col < _variables.num_01_var() : _model->is_binary(col);
+}
+
+double WriterColumns::lower(VarID col) const {
+   return _model == nullptr ? 0.0 : _model->lower[col];
+}
+
+double WriterColumns::upper(VarID col) const {
+   if (_model == nullptr) {
+      return is_binary(col) ? 1.0 : std::numeric_limits<double>::infinity();
+   }
+   return _model->upper[col];
+}
+
+bool WriterColumns::has_explicit_bounds(VarID col) const {
+   return lower(col) != 0.0 or upper(col) != (is_binary(col) ? 1.0 : std::numeric_limits<double>::infinity());
+}
+
+void WriterColumns::write_name(BufferedWriter &out, VarID col) const {
+   char name[Variables::MAX_VAR_NAME_LENGTH + 1];
+   out.write(name, _variables.format_var_name(_names == nullptr ? col : (*_names)[col], name));
+}
+
+LP_FormatWriter::LP_FormatWriter(std::ostream &os_, const Variables &variables_)
+      : LP_FormatWriter(os_, WriterColumns(variables_)) {}
+
+LP_FormatWriter::LP_FormatWriter(std::ostream &os_, const WriterColumns &columns_)
+      : _columns{columns_}, _out(os_), _num_rows{0}, _terms_in_line{0}, _row_is_empty{true}, _row_rel{Eq},
+        _row_rhs{0.0} {}
+
+void LP_FormatWriter::write_objective(LP_Provider::Direction direction,
+                                      const std::vector<VarIdxCoeffPair> &objective) {
+   _out.write("\\ Schedule_HighSchool model\n");
+   _out.write(direction == LP_Provider::Max ? "Maximize\n obj:" : "Minimize\n obj:");
+   _terms_in_line = 0;
+   if (direction != LP_Provider::Feasible) {
+      for (const VarIdxCoeffPair &entry: objective) {
+         if (entry.coeff != 0.0) {
+            write_term(entry.var_idx, entry.coeff);
+         }
+      }
+   }
+   _out.write("\nSubject To\n");
+}
+
+void LP_FormatWriter::begin_row(Relation rel, double rhs) {
+   _out.write(" c", 2);
+   _out.write_integer(_num_rows++);
+   _out.put(':');
+   _terms_in_line = 0;
+   _row_is_empty = true;
+   _row_rel = rel;
+   _row_rhs = rhs;
+}
+
+void LP_FormatWriter::add_entry(Variables::VarID var_idx, double coeff) {
+   write_term(var_idx, coeff);
+   _row_is_empty = false;
+}
+
+void LP_FormatWriter::end_row() {
+   if (_row_is_empty) {
+      // the format does not allow empty rows
+      write_term(0, 0.0);
+   }
+   _out.write(relation_symbol(_row_rel));
+   _out.write_number(_row_rhs);
+   _out.put('\n');
+}
+
+void LP_FormatWriter::finish() {
+   bool has_bounds_section = false;
+   size_t num_binaries = 0;
+   for (Variables::VarID col = 0; col != _columns.num_columns(); ++col) {
+      num_binaries += _columns.is_binary(col);
+      if (not _columns.has_explicit_bounds(col)) {
+         continue;
+      }
+      if (not has_bounds_section) {
+         _out.write("Bounds\n");
+         has_bounds_section = true;
+      }
+      _out.put(' ');
+      if (std::isinf(_columns.lower(col)) and std::isinf(_columns.upper(col))) {
+         write_name(col);
+         _out.write(" free\n");
+         continue;
+      }
+      write_bound(_out, _columns.lower(col));
+      _out.write(" <= ");
+      write_name(col);
+      _out.write(" <= ");
+      write_bound(_out, _columns.upper(col));
+      _out.put('\n');
+   }
+   if (num_binaries != 0) {
+      _out.write("Binaries\n");
+      _terms_in_line = 0;
+      for (Variables::VarID col = 0; col != _columns.num_columns(); ++col) {
+         if (_columns.is_binary(col)) {
+            wrap_line();
+            _out.put(' ');
+            write_name(col);
+         }
+      }
+      _out.put('\n');
+   }
+   _out.write("End\n");
+   _out.flush();
+}
+
+void LP_FormatWriter::write_term(Variables::VarID var_idx, double coeff) {
+   wrap_line();
+   if (coeff < 0) {
+      _out.write(" - ", 3);
+      coeff = -coeff;
+   } else {
+      _out.write(" + ", 3);
+   }
+   if (coeff != 1.0) {
+      _out.write_number(coeff);
+      _out.put(' ');
+   }
+   write_name(var_idx);
+}
+
+void LP_FormatWriter::write_name(Variables::VarID var_idx) {
+   _columns.write_name(_out, var_idx);
+}
+
+void LP_FormatWriter::wrap_line() {
+   if (_terms_in_line == TERMS_PER_LINE) {
+      _out.write("\n   ", 4);
+      _terms_in_line = 0;
+   }
+   ++_terms_in_line;
+}
+
+void write_free_mps(std::ostream &os, const WriterColumns &columns, LP_Provider::Direction direction,
+                    const std::vector<VarIdxCoeffPair> &objective,
+                    const std::function<void(ConstraintSink &)> &generate_rows, size_t max_entries_in_memory,
+                    double objective_offset) {
+   BufferedWriter out(os);
+   out.write("NAME Schedule_HighSchool\n");
+   if (direction == LP_Provider::Max) {
+      out.write("OBJSENSE\n    MAX\n");
+   }
+   out.write("ROWS\n N obj\n");
+   size_t num_columns = columns.num_columns();
+   std::vector<size_t> column_count(num_columns, 0);
+   {
+      MPS_RowsSink rows_sink(out, column_count);
+      generate_rows(rows_sink);
+   }
+
+   std::vector<double> objective_coeff(num_columns, 0.0);
+   if (direction != LP_Provider::Feasible) {
+      for (const VarIdxCoeffPair &entry: objective) {
+         objective_coeff[entry.var_idx] += entry.coeff;
+      }
+   }
+
+   out.write("COLUMNS\n");
+   // the binaries are enclosed in markers, a pair for every run of consecutive ones
+   bool in_marker = false;
+   std::vector<size_t> next_free, block_rows, block_coeffs_begin;
+   std::vector<double> block_coeffs;
+   for (Variables::VarID first_column = 0; first_column != num_columns;) {
+      // the block is made of as many columns as fit in the memory budget, and at least one
+      Variables::VarID last_column = first_column;
+      size_t num_entries = 0;
+      do {
+         num_entries += column_count[last_column++];
+      } while (last_column != num_columns and num_entries + column_count[last_column] <= max_entries_in_memory);
+
+      block_coeffs_begin.assign(last_column - first_column + 1, 0);
+      for (Variables::VarID column = first_column; column != last_column; ++column) {
+         block_coeffs_begin[column - first_column + 1] =
+               block_coeffs_begin[column - first_column] + column_count[column];
+      }
+      next_free.assign(block_coeffs_begin.begin(), block_coeffs_begin.end() - 1);
+      block_rows.resize(num_entries);
+      block_coeffs.resize(num_entries);
+      {
+         MPS_ColumnBlockSink block_sink(first_column, last_column, next_free, block_rows, block_coeffs);
+         generate_rows(block_sink);
+      }
+
+      for (Variables::VarID column = first_column; column != last_column; ++column) {
+         if (columns.is_binary(column) != in_marker) {
+            out.write(in_marker ? " MARKER 'MARKER' 'INTEND'\n" : " MARKER 'MARKER' 'INTORG'\n");
+            in_marker = not in_marker;
+         }
+         // a column without entries is still declared, so that the bounds can refer to it
+         if (objective_coeff[column] != 0.0 or column_count[column] == 0) {
+            out.put(' ');
+            columns.write_name(out, column);
+            out.write(" obj ", 5);
+            out.write_number(objective_coeff[column]);
+            out.put('\n');
+         }
+         size_t block_end = block_coeffs_begin[column - first_column + 1];
+         for (size_t pos = block_coeffs_begin[column - first_column]; pos != block_end;) {
+            // MPS does not allow a column twice in the same row, so repeated entries are summed
+            double coeff = block_coeffs[pos];
+            size_t row_idx = block_rows[pos];
+            for (++pos; pos != block_end and block_rows[pos] == row_idx; ++pos) {
+               coeff += block_coeffs[pos];
+            }
+            out.put(' ');
+            columns.write_name(out, column);
+            out.put(' ');
+            write_row_name(out, row_idx);
+            out.put(' ');
+            out.write_number(coeff);
+            out.put('\n');
+         }
+      }
+      first_column = last_column;
+   }
+   if (in_marker) {
+      out.write(" MARKER 'MARKER' 'INTEND'\n");
+   }
+
+   out.write("RHS\n");
+   if (objective_offset != 0.0 and direction != LP_Provider::Feasible) {
+      // by convention the rhs of the objective is minus its constant
+      out.write(" rhs obj ");
+      out.write_number(-objective_offset);
+      out.put('\n');
+   }
+   {
+      MPS_RhsSink rhs_sink(out);
+      generate_rows(rhs_sink);
+   }
+
+   out.write("BOUNDS\n");
+   for (Variables::VarID column = 0; column != num_columns; ++column) {
+      if (not columns.has_explicit_bounds(column)) {
+         if (columns.is_binary(column)) {
+            out.write(" BV bnd ", 8);
+            columns.write_name(out, column);
+            out.put('\n');
+         }
+         continue;
+      }
+      double lower = columns.lower(column);
+      double upper = columns.upper(column);
+      if (std::isinf(lower) and std::isinf(upper)) {
+         out.write(" FR bnd ", 8);
+         columns.write_name(out, column);
+         out.put('\n');
+         continue;
+      }
+      if (lower != 0.0) {
+         out.write(std::isinf(lower) ? " MI bnd " : " LO bnd ", 8);
+         columns.write_name(out, column);
+         if (not std::isinf(lower)) {
+            out.put(' ');
+            out.write_number(lower);
+         }
+         out.put('\n');
+      }
+      if (not std::isinf(upper)) {
+         out.write(" UP bnd ", 8);
+         columns.write_name(out, column);
+         out.put(' ');
+         out.write_number(upper);
+         out.put('\n');
+      }
+   }
+   out.write("ENDATA\n");
+   out.flush();
+}
+
+namespace {
+   std::vector<VarIdxCoeffPair> sparse_objective(const MIP_Model &model) {
+      std::vector<VarIdxCoeffPair> objective;
+      for (Variables::VarID col = 0; col != model.num_columns(); ++col) {
+         if (model.objective[col] != 0.0) {
+            objective.emplace_back(col, model.objective[col]);
+         }
+      }
+      return objective;
+   }
+}
+
+void write_lp(std::ostream &os, const MIP_Model &model, const WriterColumns &columns) {
+   LP_FormatWriter writer(os, columns);
+   if (model.objective_offset != 0.0) {
+      os << "\\ objective offset " << model.objective_offset << '\n';
+   }
+   writer.write_objective(model.direction, sparse_objective(model));
+   model.constraints.replay(writer);
+   writer.finish();
+}
+
+void write_mps(std::ostream &os, const MIP_Model &model, const WriterColumns &columns) {
+   write_free_mps(os, columns, model.direction, sparse_objective(model),
+                  [&model](ConstraintSink &sink) { model.constraints.replay(sink); },
+                  model.constraints.num_nonzeros() + 1, model.objective_offset);
+}
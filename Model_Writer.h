@@ -0,0 +1,130 @@
+#ifndef SCHEDULE_HIGHSCHOOL_MODEL_WRITER_H
+#define SCHEDULE_HIGHSCHOOL_MODEL_WRITER_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Variables.h"
+#include "Constraint_Matrix.h"
+#include "LP_Provider.h"
+#include "MIP_Model.h"
+
+// Collects the output in a large buffer and hands it to the stream in big sequential writes
+class BufferedWriter {
+public:
+   static constexpr size_t DEFAULT_CAPACITY = 1u << 20u;
+
+   explicit BufferedWriter(std::ostream &os_, size_t capacity_ = DEFAULT_CAPACITY);
+
+   ~BufferedWriter() { flush(); }
+
+   BufferedWriter(const BufferedWriter &) = delete;
+
+   BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+   void put(char c) {
+      if (_size == _buffer.size()) {
+         flush();
+      }
+      _buffer[_size++] = c;
+   }
+
+   void write(const char *data, size_t length);
+
+   void write(const std::string &text) { write(text.data(), text.length()); }
+
+   // shortest representation that reads back to the same double
+   void write_number(double number);
+
+   void write_integer(size_t number);
+
+   void flush();
+
+private:
+   std::ostream &_os;
+   std::vector<char> _buffer;
+   size_t _size;
+};
+
+// The columns as the writers see them. On their own, the variables are the columns: binaries first, then continuous
+// non-negative ones. With a model, for example a presolved one, column j is named after variable @p names_[j] and
+// takes its bounds and type from the model
+class WriterColumns {
+public:
+   typedef Variables::VarID VarID;
+
+   explicit WriterColumns(const Variables &variables_) : _variables{variables_}, _model{nullptr}, _names{nullptr} {}
+
+   WriterColumns(const Variables &variables_, const MIP_Model &model_, const std::vector<VarID> &names_);
+
+   [[nodiscard]] size_t num_columns() const;
+
+   [[nodiscard]] bool is_binary(VarID col) const;
+
+   [[nodiscard]] double lower(VarID col) const;
+
+   [[nodiscard]] double upper(VarID col) const;
+
+   // the bounds differ from the default ones of the type: [0, 1] for a binary, [0, inf) otherwise
+   [[nodiscard]] bool has_explicit_bounds(VarID col) const;
+
+   void write_name(BufferedWriter &out, VarID col) const;
+
+private:
+   const Variables &_variables;
+   const MIP_Model *_model;
+   const std::vector<VarID> *_names;
+};
+
+// Writes the model in CPLEX-LP format. The rows are written as soon as they are received, so the writer can be used
+// directly as the sink of LP_Provider::emit_constraints and never holds more than the current row
+class LP_FormatWriter : public ConstraintSink {
+public:
+   LP_FormatWriter(std::ostream &os_, const Variables &variables_);
+
+   LP_FormatWriter(std::ostream &os_, const WriterColumns &columns_);
+
+   // writes everything that comes before the constraints. Must be called before the first row
+   void write_objective(LP_Provider::Direction direction, const std::vector<VarIdxCoeffPair> &objective);
+
+   void begin_row(Relation rel, double rhs) override;
+
+   void add_entry(Variables::VarID var_idx, double coeff) override;
+
+   void end_row() override;
+
+   // writes the bounds and the column types, and flushes the stream
+   void finish();
+
+private:
+   void write_term(Variables::VarID var_idx, double coeff);
+
+   void write_name(Variables::VarID var_idx);
+
+   void wrap_line();
+
+   WriterColumns _columns;
+   BufferedWriter _out;
+   size_t _num_rows;
+   size_t _terms_in_line;
+   bool _row_is_empty;
+   Relation _row_rel;
+   double _row_rhs;
+};
+
+// Writes the model in free-MPS format. MPS is column-major, so the constraints are generated more than once by
+// @p generate_rows: once for the row names, once for every block of columns whose entries fit in
+// @p max_entries_in_memory, and once for the rhs. The memory used is one counter per column plus one block of entries
+void write_free_mps(std::ostream &os, const WriterColumns &columns, LP_Provider::Direction direction,
+                    const std::vector<VarIdxCoeffPair> &objective,
+                    const std::function<void(ConstraintSink &)> &generate_rows,
+                    size_t max_entries_in_memory = size_t(1u) << 22u, double objective_offset = 0.0);
+
+// the whole of @p model, with the columns named by @p columns
+void write_lp(std::ostream &os, const MIP_Model &model, const WriterColumns &columns);
+
+void write_mps(std::ostream &os, const MIP_Model &model, const WriterColumns &columns);
+
+
+#endif //SCHEDULE_HIGHSCHOOL_MODEL_WRITER_H
@@ -0,0 +1,343 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include "Neighborhood_Search.h"
+#include "Presolve.h"
+#include "Trace.h"
+
+namespace {
+   constexpr double OBJECTIVE_TOLERANCE = 1e-6;
+   // after every neighborhood the weight of its type moves this far towards 1 if it improved, towards 0 otherwise
+   constexpr double WEIGHT_REACTION = 0.2;
+   // every type is still drawn now and then, since it may improve again on a later schedule
+   constexpr double MIN_TYPE_WEIGHT = 0.05;
+   constexpr double NEIGHBORHOOD_GROWTH = 1.2;
+   constexpr double MIN_NEIGHBORHOOD_LESSONS = 10.0;
+}
+
+NeighborhoodSearch::NeighborhoodSearch(const Input &input_, const Variables &variables_, const MIP_Model &model_,
+                                       Options options_)
+      : _input{input_}, _variables{variables_}, _model{model_}, _options{std::move(options_)},
+        _random(_options.seed), _class_teachers(_input.num_classes()), _teacher_classes(_input.num_teachers()),
+        _neighborhood_lessons{double(_options.neighborhood_lessons)}, _schedule(_input), _objective{0.0} {
+   // a teacher has at most one requirement in a class
+   for (const Input::Requirement &requirement: _input.get_requirements()) {
+      unsigned int class_idx = _input.convert_from_class_id(requirement.class_id());
+      unsigned int teacher_idx = _input.convert_from_teacher_id(requirement.teacher_id());
+      _class_teachers[class_idx].push_back(teacher_idx);
+      _teacher_classes[teacher_idx].push_back(class_idx);
+   }
+   _type_weights.fill(1.0);
+}
+
+NeighborhoodSearch::Result NeighborhoodSearch::run(const Schedule &start) {
+   TRACE_SCOPE("NeighborhoodSearch::run");
+   auto start_time = std::chrono::steady_clock::now();
+   auto elapsed = [&start_time] {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+   };
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+            _schedule.set_lesson(class_idx, day, hour, start.get_lesson(class_idx, day, hour));
+         }
+      }
+   }
+   std::vector<double> values = _schedule.get_values(_variables);
+   if (not _model.is_feasible(values)) {
+      throw std::logic_error("The start of the neighborhood search does not satisfy the model");
+   }
+   _objective = _model.evaluate(values);
+   const size_t num_lessons = _schedule.num_lessons();
+
+   Result result;
+   std::vector<Neighborhood> neighborhoods;
+   std::vector<Solution> solutions;
+   std::vector<size_t> order;
+   bool optimal = false;
+   while (not optimal and elapsed() < _options.time_limit) {
+      double time_limit = std::min(_options.solver_options.time_limit, _options.time_limit - elapsed());
+      // the neighborhoods of the round, each at hours that the others do not free
+      neighborhoods.clear();
+      std::vector<WeekMask> used(_input.num_classes());
+      for (unsigned int worker = 0; worker != std::max(1u, _options.num_threads); ++worker) {
+         std::discrete_distribution<unsigned int> pick_type(_type_weights.begin(), _type_weights.end());
+         Neighborhood neighborhood = build_neighborhood(NeighborhoodType(pick_type(_random)), used);
+         if (neighborhood.num_lessons == 0) {
+            continue;
+         }
+         for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+            used[class_idx] |= neighborhood.free_slots[class_idx];
+         }
+         neighborhoods.push_back(std::move(neighborhood));
+      }
+      if (neighborhoods.empty()) {
+         break;  // the input has no lessons
+      }
+
+      values = _schedule.get_values(_variables);
+      solutions.assign(neighborhoods.size(), Solution());
+      std::atomic<size_t> next_neighborhood{0};
+      auto solve_neighborhoods = [&]() {
+         for (size_t pos = next_neighborhood++; pos < neighborhoods.size(); pos = next_neighborhood++) {
+            solutions[pos] = solve(neighborhoods[pos], values, time_limit);
+         }
+      };
+      std::vector<std::thread> threads;
+      for (size_t worker = 1; worker < neighborhoods.size(); ++worker) {
+         threads.emplace_back(solve_neighborhoods);
+      }
+      solve_neighborhoods();
+      for (std::thread &thread: threads) {
+         thread.join();
+      }
+
+      // the largest improvements first: the others are merged only if they still improve
+      order.resize(neighborhoods.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(), [&solutions](size_t first, size_t second) {
+         return solutions[first].objective < solutions[second].objective;
+      });
+      // the solutions improve on the schedule of the start of the round, which the merges before them may have
+      // improved too: merge evaluates each one on the current schedule
+      double round_objective = _objective;
+      bool any_solved = false;
+      bool all_optimal = true;
+      for (size_t pos: order) {
+         const Neighborhood &neighborhood = neighborhoods[pos];
+         const Solution &solution = solutions[pos];
+         if (solution.is_fixed) {
+            // neither a success nor a failure of its type and size; of every lesson, the schedule is the only one
+            optimal = optimal or neighborhood.num_lessons == num_lessons;
+            continue;
+         }
+         bool improved = not solution.lessons.empty() and solution.objective < round_objective - OBJECTIVE_TOLERANCE and
+                         merge(neighborhood, solution);
+         if (improved) {
+            ++result.improvements[neighborhood.type];
+         }
+         double &weight = _type_weights[neighborhood.type];
+         weight = std::max(MIN_TYPE_WEIGHT, (1 - WEIGHT_REACTION) * weight + (improved ? WEIGHT_REACTION : 0.0));
+         any_solved = true;
+         all_optimal = all_optimal and solution.status == BB_Solver::Optimal;
+         // a neighborhood of every lesson is the whole model
+         optimal = optimal or (solution.status == BB_Solver::Optimal and neighborhood.num_lessons == num_lessons);
+      }
+      if (any_solved) {
+         _neighborhood_lessons = all_optimal
+                                 ? std::min(_neighborhood_lessons * NEIGHBORHOOD_GROWTH, double(num_lessons))
+                                 : std::max(_neighborhood_lessons / NEIGHBORHOOD_GROWTH, MIN_NEIGHBORHOOD_LESSONS);
+      }
+      ++result.num_rounds;
+      result.num_neighborhoods += neighborhoods.size();
+   }
+   result.objective = _objective;
+   result.seconds = elapsed();
+   return result;
+}
+
+const char *NeighborhoodSearch::type_name(NeighborhoodType type) {
+   switch (type) {
+      case Day:
+         return "day";
+      case Teachers:
+         return "teachers";
+      case Classes:
+         return "classes";
+      default:
+         return "unknown";
+   }
+}
+
+NeighborhoodSearch::Neighborhood NeighborhoodSearch::build_neighborhood(NeighborhoodType type,
+                                                                        const std::vector<WeekMask> &used) {
+   Neighborhood neighborhood{type, {}, std::vector<WeekMask>(_input.num_classes()), 0};
+   if (_input.num_requirements() == 0) {
+      return neighborhood;
+   }
+   // from a random requirement, its teacher or its class, then those linked to them in random order
+   const Input::Requirement &first = _input.get_requirements()[_random() % _input.num_requirements()];
+   std::vector<unsigned int> queue;
+   std::vector<bool> queued;
+   if (type == Teachers) {
+      queued.assign(_input.num_teachers(), false);
+      queue.push_back(_input.convert_from_teacher_id(first.teacher_id()));
+   } else {
+      queued.assign(_input.num_classes(), false);
+      queue.push_back(_input.convert_from_class_id(first.class_id()));
+   }
+   queued[queue.front()] = true;
+   unsigned int day = _random() % WeekShape::NUM_DAYS;
+   for (size_t pos = 0; pos != queue.size() and neighborhood.num_lessons < _neighborhood_lessons; ++pos) {
+      size_t num_queued = queue.size();
+      if (type == Teachers) {
+         unsigned int teacher_idx = queue[pos];
+         add_teacher(neighborhood, teacher_idx, used);
+         // the teachers who share a class with it
+         for (unsigned int class_idx: _teacher_classes[teacher_idx]) {
+            for (unsigned int other_teacher: _class_teachers[class_idx]) {
+               if (not queued[other_teacher]) {
+                  queued[other_teacher] = true;
+                  queue.push_back(other_teacher);
+               }
+            }
+         }
+      } else {
+         unsigned int class_idx = queue[pos];
+         WeekMask hours = class_hours(class_idx) & ~used[class_idx];
+         add_class(neighborhood, class_idx, type == Day ? hours & WeekMask::day_hours(day) : hours);
+         // the classes that share a teacher with it
+         for (unsigned int teacher_idx: _class_teachers[class_idx]) {
+            for (unsigned int other_class: _teacher_classes[teacher_idx]) {
+               if (not queued[other_class]) {
+                  queued[other_class] = true;
+                  queue.push_back(other_class);
+               }
+            }
+         }
+      }
+      std::shuffle(queue.begin() + num_queued, queue.end(), _random);
+   }
+   return neighborhood;
+}
+
+void NeighborhoodSearch::add_class(Neighborhood &neighborhood, unsigned int class_idx, WeekMask hours) const {
+   if (hours.empty()) {
+      return;
+   }
+   neighborhood.free_slots[class_idx] |= hours;
+   neighborhood.num_lessons += hours.count();
+   const std::vector<unsigned int> &requirements = _input.get_classes()[class_idx].requirements;
+   neighborhood.requirements.insert(neighborhood.requirements.end(), requirements.begin(), requirements.end());
+}
+
+void NeighborhoodSearch::add_teacher(Neighborhood &neighborhood, unsigned int teacher_idx,
+                                     const std::vector<WeekMask> &used) const {
+   for (unsigned int req_idx: _input.get_teachers()[teacher_idx].requirements) {
+      unsigned int class_idx = _input.convert_from_class_id(_input.get_requirements()[req_idx].class_id());
+      WeekMask lessons;
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+            if (_schedule.get_lesson(class_idx, day, hour) == req_idx) {
+               lessons.set(WeekShape::slot(day, hour));
+            }
+         }
+      }
+      lessons &= ~used[class_idx];
+      if (lessons.empty()) {
+         continue;
+      }
+      neighborhood.free_slots[class_idx] |= lessons;
+      neighborhood.num_lessons += lessons.count();
+      neighborhood.requirements.push_back(req_idx);
+   }
+}
+
+NeighborhoodSearch::Solution NeighborhoodSearch::solve(const Neighborhood &neighborhood,
+                                                       const std::vector<double> &values, double time_limit) const {
+   TRACE_SCOPE("NeighborhoodSearch::solve");
+   MIP_Model restricted = _model;
+   std::vector<bool> is_free(_input.num_requirements(), false);
+   for (unsigned int req_idx: neighborhood.requirements) {
+      is_free[req_idx] = true;
+   }
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      unsigned int class_idx = _input.convert_from_class_id(_input.get_requirements()[req_idx].class_id());
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+            Variables::VarID lesson = _variables.requirement_var(req_idx, day, hour);
+            if (lesson == Variables::InvalidVarID or
+                (is_free[req_idx] and neighborhood.free_slots[class_idx].test(WeekShape::slot(day, hour)))) {
+               continue;
+            }
+            restricted.lower[lesson] = values[lesson];
+            restricted.upper[lesson] = values[lesson];
+         }
+      }
+   }
+
+   Solution solution;
+   Presolve presolve(restricted);
+   if (presolve.is_infeasible()) {
+      return solution;
+   }
+   if (presolve.get_model().num_columns() == 0) {
+      solution.is_fixed = true;
+      return solution;
+   }
+   BB_Solver::Options options = _options.solver_options;
+   options.time_limit = time_limit;
+   options.num_threads = 1;
+   if (not options.branching_priority.empty()) {
+      options.branching_priority = presolve.reduce_columns(options.branching_priority);
+   }
+   BB_Solver solver(presolve.get_model(), options);
+   // the schedule satisfies the restricted model: the solver can only improve on it
+   solver.set_incumbent(presolve.reduce(values));
+   BB_Solver::Result result = solver.solve();
+   solution.status = result.status;
+   solution.objective = result.objective;
+   if (not result.has_solution()) {
+      return solution;
+   }
+   Schedule schedule(_input, _variables, presolve.postsolve(result.values));
+   solution.lessons.assign(_input.num_classes(), WeekGrid<unsigned int>(Schedule::NoLesson));
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      WeekMask free_slots = neighborhood.free_slots[class_idx];
+      while (not free_slots.empty()) {
+         unsigned int slot = free_slots.pop_lowest();
+         unsigned int day = WeekShape::day_of(slot);
+         solution.lessons[class_idx][slot] = schedule.get_lesson(class_idx, day, slot - WeekShape::DAY_BEGIN[day]);
+      }
+   }
+   return solution;
+}
+
+bool NeighborhoodSearch::merge(const Neighborhood &neighborhood, const Solution &solution) {
+   // the lessons of the schedule at the free hours, to put back if the merged schedule is not better
+   std::vector<unsigned int> replaced;
+   auto exchange_lessons = [&](bool restore) {
+      size_t pos = 0;
+      for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+         WeekMask free_slots = neighborhood.free_slots[class_idx];
+         while (not free_slots.empty()) {
+            unsigned int slot = free_slots.pop_lowest();
+            unsigned int day = WeekShape::day_of(slot);
+            unsigned int hour = slot - WeekShape::DAY_BEGIN[day];
+            if (restore) {
+               _schedule.set_lesson(class_idx, day, hour, replaced[pos++]);
+            } else {
+               replaced.push_back(_schedule.get_lesson(class_idx, day, hour));
+               _schedule.set_lesson(class_idx, day, hour, solution.lessons[class_idx][slot]);
+            }
+         }
+      }
+   };
+   exchange_lessons(false);
+   std::vector<double> values = _schedule.get_values(_variables);
+   double objective = _model.evaluate(values);
+   if (objective < _objective - OBJECTIVE_TOLERANCE and _model.is_feasible(values)) {
+      _objective = objective;
+      return true;
+   }
+   exchange_lessons(true);
+   return false;
+}
+
+WeekMask NeighborhoodSearch::class_hours(unsigned int class_idx) const {
+   const Input::Class &school_class = _input.get_classes()[class_idx];
+   WeekMask hours;
+   for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+      for (unsigned int hour = 0; hour != school_class.num_hours_per_day[day]; ++hour) {
+         hours.set(WeekShape::slot(day, hour));
+      }
+   }
+   return hours;
+}
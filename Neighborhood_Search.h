@@ -0,0 +1,119 @@
+#ifndef SCHEDULE_HIGHSCHOOL_NEIGHBORHOOD_SEARCH_H
+#define SCHEDULE_HIGHSCHOOL_NEIGHBORHOOD_SEARCH_H
+
+#include <array>
+#include <limits>
+#include <random>
+#include <vector>
+#include "BB_Solver.h"
+#include "Input.h"
+#include "MIP_Model.h"
+#include "Schedule.h"
+#include "Variables.h"
+
+// Large neighborhood search over the model of LP_Provider, for schools whose whole model the solver cannot close in
+// time. From a schedule that satisfies the model it frees the lessons of a neighborhood, fixes every other lesson
+// column to the schedule and solves the restricted model, which presolve makes small; a better schedule replaces
+// the incumbent. A neighborhood is one day of a group of classes, a cluster of teachers who share classes, or a group
+// of classes that share teachers, grown from a random class or teacher up to a number of lessons.
+// Every round solves a neighborhood on each of num_threads workers, with no lesson in common, and merges those that
+// improve, one after the other, while the schedule still satisfies the model: two neighborhoods may share a teacher
+// or a requirement. The type of every neighborhood is drawn with weights that follow how often each type improved in
+// the last rounds. The number of lessons grows while the neighborhoods are solved to optimality, and shrinks when
+// they reach their time limit
+class NeighborhoodSearch {
+public:
+   enum NeighborhoodType : unsigned int {
+      Day, Teachers, Classes, NUM_NEIGHBORHOOD_TYPES
+   };
+
+   struct Options {
+      double time_limit;  // in seconds, of the whole search
+      unsigned int num_threads;  // neighborhoods solved at the same time
+      unsigned int neighborhood_lessons;  // the free lessons of the first neighborhoods
+      unsigned int seed;
+      // of every neighborhood, on one thread: its time limit is that of one neighborhood. The branching priorities
+      // are of the columns of the whole model
+      BB_Solver::Options solver_options;
+
+      Options() : time_limit{60.0}, num_threads{1}, neighborhood_lessons{20}, seed{1} {
+         solver_options.time_limit = 5.0;
+      }
+   };
+
+   struct Result {
+      double objective;  // of the best schedule, in the model
+      size_t num_rounds;
+      size_t num_neighborhoods;
+      std::array<size_t, NUM_NEIGHBORHOOD_TYPES> improvements;  // by type, merged into the schedule
+      double seconds;
+
+      Result() : objective{0.0}, num_rounds{0}, num_neighborhoods{0}, improvements{}, seconds{0.0} {}
+   };
+
+   // @p model is the model of @p variables with all its rows, none left to a RowSeparator
+   NeighborhoodSearch(const Input &input_, const Variables &variables_, const MIP_Model &model_,
+                      Options options_ = Options());
+
+   // searches from @p start until the time limit. Throws std::logic_error if @p start does not satisfy the model
+   Result run(const Schedule &start);
+
+   // the best schedule of run()
+   [[nodiscard]] const Schedule &get_schedule() const { return _schedule; }
+
+   [[nodiscard]] static const char *type_name(NeighborhoodType type);
+
+private:
+   struct Neighborhood {
+      NeighborhoodType type;
+      std::vector<unsigned int> requirements;  // whose lessons are free, at the free hours of their class
+      std::vector<WeekMask> free_slots;  // by class
+      unsigned int num_lessons;
+   };
+
+   // the lessons that the restricted model of a neighborhood gives to its free hours
+   struct Solution {
+      BB_Solver::Status status;
+      double objective;
+      std::vector<WeekGrid<unsigned int>> lessons;  // by class, at the free hours; empty without a solution
+      bool is_fixed;  // the presolve fixed every column: the neighborhood cannot change the schedule
+
+      Solution() : status{BB_Solver::Infeasible}, objective{std::numeric_limits<double>::infinity()},
+                   is_fixed{false} {}
+   };
+
+   // a neighborhood of @p type of about _neighborhood_lessons lessons, at the hours in none of @p used
+   Neighborhood build_neighborhood(NeighborhoodType type, const std::vector<WeekMask> &used);
+
+   // adds the hours of @p class_idx in @p hours, and the requirements of the class, to @p neighborhood
+   void add_class(Neighborhood &neighborhood, unsigned int class_idx, WeekMask hours) const;
+
+   // adds the lessons of the requirements of @p teacher_idx in the schedule, at the hours in none of @p used, to
+   // @p neighborhood
+   void add_teacher(Neighborhood &neighborhood, unsigned int teacher_idx, const std::vector<WeekMask> &used) const;
+
+   // the restricted model of @p neighborhood, solved from the schedule
+   [[nodiscard]] Solution solve(const Neighborhood &neighborhood, const std::vector<double> &values,
+                                double time_limit) const;
+
+   // writes @p solution into the schedule if the schedule then satisfies the model and is better. Returns whether it
+   // did
+   bool merge(const Neighborhood &neighborhood, const Solution &solution);
+
+   [[nodiscard]] WeekMask class_hours(unsigned int class_idx) const;
+
+   const Input &_input;
+   const Variables &_variables;
+   const MIP_Model &_model;
+   Options _options;
+   std::mt19937 _random;
+   std::vector<std::vector<unsigned int>> _class_teachers;
+   std::vector<std::vector<unsigned int>> _teacher_classes;
+   std::array<double, NUM_NEIGHBORHOOD_TYPES> _type_weights;
+   double _neighborhood_lessons;
+   Schedule _schedule;
+   double _objective;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_NEIGHBORHOOD_SEARCH_H
@@ -0,0 +1,116 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include "Occupancy.h"
+
+Occupancy::Occupancy(const Input &input_) : _input{input_}, _teacher_busy(_input.num_teachers()),
+                                            _teacher_clashes(_input.num_teachers(), DayArray<unsigned int>{}),
+                                            _class_busy(_input.num_classes()),
+                                            _requirement_lessons(_input.num_requirements()) {
+   _teacher_of.reserve(_input.num_requirements());
+   _class_of.reserve(_input.num_requirements());
+   for (const Input::Requirement &requirement: _input.get_requirements()) {
+      _teacher_of.push_back(_input.convert_from_teacher_id(requirement.teacher_id()));
+      _class_of.push_back(_input.convert_from_class_id(requirement.class_id()));
+   }
+   _teacher_available.resize(_input.num_teachers());
+   for (unsigned int teacher_idx = 0; teacher_idx != _input.num_teachers(); ++teacher_idx) {
+      for (unsigned int slot = 0; slot != WeekShape::NUM_SLOTS; ++slot) {
+         if (_input.get_teachers()[teacher_idx].penalties[slot] != Input::Teacher::InvalidPenality) {
+            _teacher_available[teacher_idx].set(slot);
+         }
+      }
+   }
+   _class_hours.resize(_input.num_classes());
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != _input.get_classes()[class_idx].num_hours_per_day[day]; ++hour) {
+            _class_hours[class_idx].set(WeekShape::slot(day, hour));
+         }
+      }
+   }
+}
+
+Occupancy::Occupancy(const Input &input_, const Schedule &schedule) : Occupancy(input_) {
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+            unsigned int req_idx = schedule.get_lesson(class_idx, day, hour);
+            if (req_idx != Schedule::NoLesson) {
+               add_lesson(req_idx, WeekShape::slot(day, hour));
+            }
+         }
+      }
+   }
+}
+
+void Occupancy::clear() {
+   std::fill(_teacher_busy.begin(), _teacher_busy.end(), WeekMask());
+   std::fill(_teacher_clashes.begin(), _teacher_clashes.end(), DayArray<unsigned int>{});
+   std::fill(_class_busy.begin(), _class_busy.end(), WeekMask());
+   std::fill(_requirement_lessons.begin(), _requirement_lessons.end(), WeekMask());
+}
+
+void Occupancy::add_lesson(unsigned int req_idx, unsigned int slot) {
+   unsigned int teacher_idx = _teacher_of[req_idx];
+   if (_teacher_busy[teacher_idx].test(slot)) {
+      ++_teacher_clashes[teacher_idx][WeekShape::day_of(slot)];
+   }
+   _teacher_busy[teacher_idx].set(slot);
+   _class_busy[_class_of[req_idx]].set(slot);
+   _requirement_lessons[req_idx].set(slot);
+}
+
+void Occupancy::remove_lesson(unsigned int req_idx, unsigned int slot) {
+   _requirement_lessons[req_idx].reset(slot);
+   _class_busy[_class_of[req_idx]].reset(slot);
+   unsigned int teacher_idx = _teacher_of[req_idx];
+   unsigned int &clashes = _teacher_clashes[teacher_idx][WeekShape::day_of(slot)];
+   if (clashes != 0) {
+      // the hour stays busy if another lesson of the teacher is there
+      for (unsigned int other_req: _input.get_teachers()[teacher_idx].requirements) {
+         if (_requirement_lessons[other_req].test(slot)) {
+            --clashes;
+            return;
+         }
+      }
+   }
+   _teacher_busy[teacher_idx].reset(slot);
+}
+
+WeekMask Occupancy::free_slots(unsigned int req_idx) const {
+   unsigned int teacher_idx = _teacher_of[req_idx];
+   unsigned int class_idx = _class_of[req_idx];
+   return _class_hours[class_idx] & ~_class_busy[class_idx] & _teacher_available[teacher_idx] &
+          ~_teacher_busy[teacher_idx];
+}
+
+void Occupancy::conflict_masks(Span<const unsigned int> requirements, Span<WeekMask> conflicts) const {
+   for (size_t pos = 0; pos != requirements.size(); ++pos) {
+      unsigned int teacher_idx = _teacher_of[requirements[pos]];
+      conflicts[pos] = _teacher_busy[teacher_idx] | ~_teacher_available[teacher_idx];
+   }
+}
+
+unsigned int Occupancy::teacher_gaps(unsigned int teacher_idx) const {
+   WeekMask busy = _teacher_busy[teacher_idx];
+   return (busy.day_spans() & ~busy).count();
+}
+
+unsigned int Occupancy::split_pairs(unsigned int req_idx, unsigned int day) const {
+   // all the pairs, but those of adjacent hours
+   WeekMask lessons = _requirement_lessons[req_idx] & WeekMask::day_hours(day);
+   unsigned int num_lessons = lessons.count();
+   return num_lessons * (num_lessons - 1) / 2 - lessons.pair_starts().count();
+}
+
+unsigned int Occupancy::pair_days(unsigned int req_idx) const {
+   WeekMask pair_starts = _requirement_lessons[req_idx].pair_starts();
+   unsigned int num_days = 0;
+   for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+      num_days += (pair_starts & WeekMask::day_hours(day)).empty() ? 0 : 1;
+   }
+   return num_days;
+}
@@ -0,0 +1,85 @@
+#ifndef SCHEDULE_HIGHSCHOOL_OCCUPANCY_H
+#define SCHEDULE_HIGHSCHOOL_OCCUPANCY_H
+
+#include <vector>
+#include "Input.h"
+#include "Schedule.h"
+
+// The busy hours of every teacher, class and requirement, as one WeekMask each, so that the questions of the
+// heuristics ("is the teacher busy at this hour", "where can this requirement go", "does it already have a lesson
+// today") are a few operations on a word. A teacher may be given two lessons at the same hour, as a local search
+// does on its way to a schedule: the lessons beyond the first are counted as clashes. A class has at most one lesson
+// at every hour
+class Occupancy {
+public:
+   // nothing busy
+   explicit Occupancy(const Input &input_);
+
+   // the lessons of @p schedule
+   Occupancy(const Input &input_, const Schedule &schedule);
+
+   // the teacher and the class of a requirement, by position in Input
+   [[nodiscard]] unsigned int teacher_of(unsigned int req_idx) const { return _teacher_of[req_idx]; }
+
+   [[nodiscard]] unsigned int class_of(unsigned int req_idx) const { return _class_of[req_idx]; }
+
+   // frees every hour
+   void clear();
+
+   void add_lesson(unsigned int req_idx, unsigned int slot);
+
+   void remove_lesson(unsigned int req_idx, unsigned int slot);
+
+   [[nodiscard]] WeekMask teacher_busy(unsigned int teacher_idx) const { return _teacher_busy[teacher_idx]; }
+
+   [[nodiscard]] WeekMask class_busy(unsigned int class_idx) const { return _class_busy[class_idx]; }
+
+   [[nodiscard]] WeekMask requirement_lessons(unsigned int req_idx) const { return _requirement_lessons[req_idx]; }
+
+   [[nodiscard]] WeekMask teacher_available(unsigned int teacher_idx) const {
+      return _teacher_available[teacher_idx];
+   }
+
+   [[nodiscard]] WeekMask class_hours(unsigned int class_idx) const { return _class_hours[class_idx]; }
+
+   // the lessons of the teacher on @p day beyond the first one at each hour
+   [[nodiscard]] unsigned int teacher_clashes(unsigned int teacher_idx, unsigned int day) const {
+      return _teacher_clashes[teacher_idx][day];
+   }
+
+   [[nodiscard]] bool has_lesson_on(unsigned int req_idx, unsigned int day) const {
+      return not(_requirement_lessons[req_idx] & WeekMask::day_hours(day)).empty();
+   }
+
+   // the hours of the class at which the requirement can have a lesson without a conflict: the class and the teacher
+   // are free, and the teacher is available
+   [[nodiscard]] WeekMask free_slots(unsigned int req_idx) const;
+
+   // for each requirement in @p requirements, the hours at which a lesson would be a conflict for its teacher, busy
+   // or unavailable, into @p conflicts of the same size
+   void conflict_masks(Span<const unsigned int> requirements, Span<WeekMask> conflicts) const;
+
+   // the hours that the teacher spends in school without a lesson, between the first and the last lesson of a day
+   [[nodiscard]] unsigned int teacher_gaps(unsigned int teacher_idx) const;
+
+   // the number of pairs of lessons of the requirement on @p day that are not adjacent hours
+   [[nodiscard]] unsigned int split_pairs(unsigned int req_idx, unsigned int day) const;
+
+   // the number of days on which the requirement has lessons at two consecutive hours
+   [[nodiscard]] unsigned int pair_days(unsigned int req_idx) const;
+
+private:
+   const Input &_input;
+   std::vector<unsigned int> _teacher_of;
+   std::vector<unsigned int> _class_of;
+   std::vector<WeekMask> _teacher_available;
+   std::vector<WeekMask> _class_hours;
+
+   std::vector<WeekMask> _teacher_busy;
+   std::vector<DayArray<unsigned int>> _teacher_clashes;
+   std::vector<WeekMask> _class_busy;
+   std::vector<WeekMask> _requirement_lessons;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_OCCUPANCY_H
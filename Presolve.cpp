@@ -0,0 +1,419 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include "Presolve.h"
+#include "Trace.h"
+
+namespace {
+   constexpr double TOLERANCE = 1e-9;
+   // the row passes stop earlier if nothing changes
+   constexpr size_t MAX_PASSES = 50;
+   constexpr double INF = std::numeric_limits<double>::infinity();
+
+   // the activity of a row over the bounds: finite part plus the number of infinite terms on each side
+   struct Activity {
+      double min;
+      double max;
+      size_t num_min_infinite;
+      size_t num_max_infinite;
+
+      [[nodiscard]] double lowest() const { return num_min_infinite == 0 ? min : -INF; }
+
+      [[nodiscard]] double highest() const { return num_max_infinite == 0 ? max : INF; }
+   };
+
+   uint64_t hash_combine(uint64_t seed, uint64_t value) {
+      return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6u) + (seed >> 2u));
+   }
+
+   uint64_t double_bits(double value) {
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      return bits;
+   }
+}
+
+Presolve::Presolve(const MIP_Model &original_)
+      : _original{original_},
+        _sense{_original.direction == LP_Provider::Min ? 1.0 : _original.direction == LP_Provider::Max ? -1.0 : 0.0},
+        _lower{_original.lower}, _upper{_original.upper}, _infeasible{false}, _reduced(_original.direction) {
+   TRACE_SCOPE("Presolve");
+   _rows.resize(_original.num_rows());
+   for (size_t row_idx = 0; row_idx != _original.num_rows(); ++row_idx) {
+      ConstraintMatrix::RowView view = _original.constraints.row(row_idx);
+      Row &row = _rows[row_idx];
+      row.entries.reserve(view.lhs.size());
+      for (const VarIdxCoeffPair &entry: view.lhs) {
+         row.entries.push_back(entry);
+      }
+      row.rhs = view.rhs;
+      row.rel = view.rel;
+      row.removed = false;
+      // repeated columns are summed
+      std::sort(row.entries.begin(), row.entries.end(), [](const VarIdxCoeffPair &first,
+                                                           const VarIdxCoeffPair &second) {
+         return first.var_idx < second.var_idx;
+      });
+      size_t num_entries = 0;
+      for (const VarIdxCoeffPair &entry: row.entries) {
+         if (num_entries != 0 and row.entries[num_entries - 1].var_idx == entry.var_idx) {
+            row.entries[num_entries - 1].coeff += entry.coeff;
+         } else {
+            row.entries[num_entries++] = entry;
+         }
+      }
+      _report.removed_nonzeros += row.entries.size() - num_entries;
+      row.entries.erase(row.entries.begin() + num_entries, row.entries.end());
+   }
+   for (VarID col = 0; col != _original.num_columns() and not _infeasible; ++col) {
+      _infeasible = not tighten_bounds(col, _lower[col], _upper[col]);
+   }
+
+   bool changed = not _infeasible;
+   while (changed and _report.num_passes != MAX_PASSES) {
+      ++_report.num_passes;
+      changed = false;
+      for (Row &row: _rows) {
+         if (not row.removed and reduce_row(row)) {
+            changed = true;
+         }
+         if (_infeasible) {
+            return;
+         }
+      }
+      if (fix_empty_columns()) {
+         changed = true;
+      }
+      // parallel rows are looked for only once the cheaper reductions are exhausted
+      if (not changed and merge_duplicate_rows()) {
+         changed = true;
+      }
+      if (_infeasible) {
+         return;
+      }
+   }
+   build_reduced_model();
+}
+
+bool Presolve::tighten_bounds(VarID col, double lb, double ub) {
+   lb = std::max(lb, _lower[col]);
+   ub = std::min(ub, _upper[col]);
+   if (_original.is_binary(col)) {
+      lb = std::ceil(lb - TOLERANCE);
+      ub = std::floor(ub + TOLERANCE);
+   }
+   if (lb > ub + TOLERANCE) {
+      return false;
+   }
+   if (lb > ub) {
+      ub = lb;
+   }
+   if (lb == ub and _lower[col] != _upper[col]) {
+      ++_report.fixed_columns;
+   }
+   _lower[col] = lb;
+   _upper[col] = ub;
+   return true;
+}
+
+bool Presolve::reduce_row(Row &row) {
+   bool changed = false;
+   // fixed columns move to the rhs
+   size_t num_entries = 0;
+   for (const VarIdxCoeffPair &entry: row.entries) {
+      if (_lower[entry.var_idx] == _upper[entry.var_idx]) {
+         row.rhs -= entry.coeff * _lower[entry.var_idx];
+      } else if (entry.coeff != 0.0) {
+         row.entries[num_entries++] = entry;
+      }
+   }
+   if (num_entries != row.entries.size()) {
+      _report.removed_nonzeros += row.entries.size() - num_entries;
+      row.entries.erase(row.entries.begin() + num_entries, row.entries.end());
+      changed = true;
+   }
+
+   Activity activity{0.0, 0.0, 0, 0};
+   for (const VarIdxCoeffPair &entry: row.entries) {
+      double at_lower = entry.coeff * _lower[entry.var_idx];
+      double at_upper = entry.coeff * _upper[entry.var_idx];
+      double low = std::min(at_lower, at_upper);
+      double high = std::max(at_lower, at_upper);
+      if (std::isinf(low)) {
+         ++activity.num_min_infinite;
+      } else {
+         activity.min += low;
+      }
+      if (std::isinf(high)) {
+         ++activity.num_max_infinite;
+      } else {
+         activity.max += high;
+      }
+   }
+   double slack = TOLERANCE * std::max(1.0, std::abs(row.rhs));
+   bool has_upper = row.rel != ConstraintSink::Geq;
+   bool has_lower = row.rel != ConstraintSink::Leq;
+   if ((has_upper and activity.lowest() > row.rhs + slack) or (has_lower and activity.highest() < row.rhs - slack)) {
+      _infeasible = true;
+      return changed;
+   }
+   if ((not has_upper or activity.highest() <= row.rhs + slack) and
+       (not has_lower or activity.lowest() >= row.rhs - slack)) {
+      row.removed = true;
+      _report.removed_nonzeros += row.entries.size();
+      ++_report.redundant_rows;
+      return true;
+   }
+
+   if (row.entries.size() == 1) {
+      const VarIdxCoeffPair &entry = row.entries.front();
+      double bound = row.rhs / entry.coeff;
+      // dividing by a negative coefficient turns <= into >=
+      bool bounds_from_above = has_upper == (entry.coeff > 0.0);
+      bool bounds_from_below = has_lower == (entry.coeff > 0.0);
+      if (row.rel == ConstraintSink::Eq) {
+         bounds_from_above = bounds_from_below = true;
+      }
+      if (not tighten_bounds(entry.var_idx, bounds_from_below ? bound : -INF, bounds_from_above ? bound : INF)) {
+         _infeasible = true;
+         return changed;
+      }
+      row.removed = true;
+      _report.removed_nonzeros += 1;
+      ++_report.singleton_rows;
+      return true;
+   }
+
+   // forcing: the row is satisfiable only with the activity at its minimum (or maximum), so every column is fixed at
+   // the bound that gives it
+   bool at_min = has_upper and activity.num_min_infinite == 0 and activity.min >= row.rhs - slack;
+   bool at_max = has_lower and activity.num_max_infinite == 0 and activity.max <= row.rhs + slack;
+   if (at_min or at_max) {
+      for (const VarIdxCoeffPair &entry: row.entries) {
+         double value = (entry.coeff > 0.0) == at_min ? _lower[entry.var_idx] : _upper[entry.var_idx];
+         if (not tighten_bounds(entry.var_idx, value, value)) {
+            _infeasible = true;
+            return changed;
+         }
+      }
+      row.removed = true;
+      _report.removed_nonzeros += row.entries.size();
+      ++_report.forcing_rows;
+      return true;
+   }
+   return changed;
+}
+
+bool Presolve::fix_empty_columns() {
+   std::vector<bool> in_some_row(_original.num_columns(), false);
+   for (const Row &row: _rows) {
+      if (not row.removed) {
+         for (const VarIdxCoeffPair &entry: row.entries) {
+            in_some_row[entry.var_idx] = true;
+         }
+      }
+   }
+   bool changed = false;
+   for (VarID col = 0; col != _original.num_columns(); ++col) {
+      if (in_some_row[col] or _lower[col] == _upper[col]) {
+         continue;
+      }
+      double cost = _sense * _original.objective[col];
+      double value;
+      if (cost > 0.0 or (cost == 0.0 and not std::isinf(_lower[col]))) {
+         value = _lower[col];
+      } else if (cost < 0.0 or not std::isinf(_upper[col])) {
+         value = _upper[col];
+      } else {
+         value = 0.0;
+      }
+      if (std::isinf(value)) {
+         // unbounded: left to the solver to say so
+         continue;
+      }
+      tighten_bounds(col, value, value);
+      ++_report.empty_columns;
+      changed = true;
+   }
+   return changed;
+}
+
+bool Presolve::merge_duplicate_rows() {
+   // rows are compared after scaling them so that their first coefficient is 1; a negative scale swaps <= and >=,
+   // and every row becomes the interval [low, high] of its scaled activity
+   struct ScaledRow {
+      double scale;
+      double low;
+      double high;
+   };
+   std::vector<ScaledRow> scaled(_rows.size());
+   std::unordered_map<uint64_t, std::vector<size_t>> rows_by_hash;
+   bool changed = false;
+   for (size_t row_idx = 0; row_idx != _rows.size(); ++row_idx) {
+      Row &row = _rows[row_idx];
+      if (row.removed or row.entries.empty()) {
+         continue;
+      }
+      double scale = 1.0 / row.entries.front().coeff;
+      double scaled_rhs = row.rhs * scale;
+      ScaledRow &current = scaled[row_idx];
+      current.scale = scale;
+      current.low = row.rel == ConstraintSink::Leq ? -INF : scaled_rhs;
+      current.high = row.rel == ConstraintSink::Geq ? INF : scaled_rhs;
+      if (scale < 0.0) {
+         current.low = row.rel == ConstraintSink::Geq ? -INF : scaled_rhs;
+         current.high = row.rel == ConstraintSink::Leq ? INF : scaled_rhs;
+      }
+      uint64_t hash = row.entries.size();
+      for (const VarIdxCoeffPair &entry: row.entries) {
+         hash = hash_combine(hash, entry.var_idx);
+         hash = hash_combine(hash, double_bits(entry.coeff * scale));
+      }
+
+      std::vector<size_t> &candidates = rows_by_hash[hash];
+      auto same_lhs = [&](size_t other_idx) {
+         const Row &other = _rows[other_idx];
+         if (other.entries.size() != row.entries.size()) {
+            return false;
+         }
+         for (size_t pos = 0; pos != row.entries.size(); ++pos) {
+            if (other.entries[pos].var_idx != row.entries[pos].var_idx or
+                other.entries[pos].coeff * scaled[other_idx].scale != row.entries[pos].coeff * scale) {
+               return false;
+            }
+         }
+         return true;
+      };
+      auto match = std::find_if(candidates.begin(), candidates.end(), same_lhs);
+      if (match == candidates.end()) {
+         candidates.push_back(row_idx);
+         continue;
+      }
+
+      // the kept row takes the intersection of the two intervals, when it can still be a single row
+      Row &kept = _rows[*match];
+      ScaledRow &kept_scaled = scaled[*match];
+      double low = std::max(kept_scaled.low, current.low);
+      double high = std::min(kept_scaled.high, current.high);
+      if (low > high + TOLERANCE * std::max(1.0, std::abs(high))) {
+         _infeasible = true;
+         return changed;
+      }
+      ConstraintSink::Relation rel;
+      double scaled_rhs_kept;
+      if (std::isinf(low)) {
+         rel = ConstraintSink::Leq;
+         scaled_rhs_kept = high;
+      } else if (std::isinf(high)) {
+         rel = ConstraintSink::Geq;
+         scaled_rhs_kept = low;
+      } else if (high - low <= TOLERANCE * std::max(1.0, std::abs(high))) {
+         rel = ConstraintSink::Eq;
+         scaled_rhs_kept = low;
+      } else {
+         // a range: both rows are needed
+         candidates.push_back(row_idx);
+         continue;
+      }
+      kept_scaled.low = low;
+      kept_scaled.high = high;
+      kept.rhs = scaled_rhs_kept / kept_scaled.scale;
+      kept.rel = rel;
+      if (kept_scaled.scale < 0.0 and rel != ConstraintSink::Eq) {
+         kept.rel = rel == ConstraintSink::Leq ? ConstraintSink::Geq : ConstraintSink::Leq;
+      }
+      row.removed = true;
+      _report.removed_nonzeros += row.entries.size();
+      ++_report.duplicate_rows;
+      changed = true;
+   }
+   return changed;
+}
+
+void Presolve::build_reduced_model() {
+   _reduced_column.assign(_original.num_columns(), Removed);
+   _original_column.clear();
+   _reduced.objective_offset = _original.objective_offset;
+   for (VarID col = 0; col != _original.num_columns(); ++col) {
+      if (_lower[col] == _upper[col]) {
+         _reduced.objective_offset += _original.objective[col] * _lower[col];
+         continue;
+      }
+      _reduced_column[col] = _reduced.add_column(_original.column_type[col], _original.objective[col], _lower[col],
+                                                 _upper[col]);
+      _original_column.push_back(col);
+   }
+
+   // the last pass may have fixed columns after their rows were reduced, if it hit MAX_PASSES
+   size_t num_rows = 0;
+   size_t num_nonzeros = 0;
+   for (Row &row: _rows) {
+      if (row.removed) {
+         continue;
+      }
+      size_t num_entries = 0;
+      for (const VarIdxCoeffPair &entry: row.entries) {
+         if (_reduced_column[entry.var_idx] == Removed) {
+            row.rhs -= entry.coeff * _lower[entry.var_idx];
+         } else {
+            row.entries[num_entries++] = entry;
+         }
+      }
+      _report.removed_nonzeros += row.entries.size() - num_entries;
+      row.entries.erase(row.entries.begin() + num_entries, row.entries.end());
+      ++num_rows;
+      num_nonzeros += num_entries;
+   }
+   _reduced.constraints.reserve(num_rows, num_nonzeros);
+   for (const Row &row: _rows) {
+      if (row.removed) {
+         continue;
+      }
+      _reduced.constraints.begin_row(row.rel, row.rhs);
+      for (const VarIdxCoeffPair &entry: row.entries) {
+         _reduced.constraints.add_entry(_reduced_column[entry.var_idx], entry.coeff);
+      }
+      _reduced.constraints.end_row();
+   }
+   _rows.clear();
+   _rows.shrink_to_fit();
+}
+
+std::vector<double> Presolve::postsolve(const std::vector<double> &values) const {
+   TRACE_SCOPE("Presolve::postsolve");
+   if (values.size() != _original_column.size()) {
+      throw std::logic_error("The solution does not match the columns of the presolved model");
+   }
+   std::vector<double> original_values(_lower);
+   for (VarID col = 0; col != _original_column.size(); ++col) {
+      original_values[_original_column[col]] = values[col];
+   }
+   return original_values;
+}
+
+std::vector<double> Presolve::reduce(const std::vector<double> &values) const {
+   if (values.size() != _reduced_column.size()) {
+      throw std::logic_error("The solution does not match the columns of the original model");
+   }
+   return reduce_columns(values);
+}
+
+void Presolve::print_report(std::ostream &os) const {
+   if (_infeasible) {
+      os << "Presolve: the model is infeasible" << std::endl;
+      return;
+   }
+   os << "Presolve: " << _reduced.num_rows() << " rows (" << _original.num_rows() - _reduced.num_rows()
+      << " removed), " << _reduced.num_columns() << " columns (" << _original.num_columns() - _reduced.num_columns()
+      << " removed), " << _reduced.constraints.num_nonzeros() << " nonzeros (" << _report.removed_nonzeros
+      << " removed) after " << _report.num_passes << " passes\n"
+      << "   singleton rows " << _report.singleton_rows << ", forcing rows " << _report.forcing_rows
+      << ", redundant rows " << _report.redundant_rows << ", duplicate rows " << _report.duplicate_rows
+      << ", fixed columns " << _report.fixed_columns << " (" << _report.empty_columns << " without rows)"
+      << std::endl;
+}
@@ -0,0 +1,109 @@
+#ifndef SCHEDULE_HIGHSCHOOL_PRESOLVE_H
+#define SCHEDULE_HIGHSCHOOL_PRESOLVE_H
+
+#include <limits>
+#include <ostream>
+#include <vector>
+#include "MIP_Model.h"
+
+// Reduces a MIP_Model before it reaches a solver or a writer: columns whose value is forced are fixed and removed,
+// rows that only bound one column become bounds, rows that can never be violated are dropped, and parallel rows are
+// merged. The reduced model keeps the surviving columns in their original order, and postsolve() maps a solution
+// of it back to the columns of the original model
+class Presolve {
+public:
+   typedef Variables::VarID VarID;
+
+   static constexpr VarID Removed = std::numeric_limits<VarID>::max();
+
+   // how much each reduction removed
+   struct Report {
+      size_t singleton_rows;  // turned into bounds
+      size_t forcing_rows;  // satisfiable only with all their columns at one bound, which fixes them
+      size_t redundant_rows;  // never violated within the bounds, empty rows included
+      size_t duplicate_rows;  // parallel to another row, and merged into it
+      size_t fixed_columns;
+      size_t empty_columns;  // no rows left: fixed at the bound that is best for the objective. Among fixed_columns
+      size_t removed_nonzeros;
+      size_t num_passes;
+
+      Report() : singleton_rows{0}, forcing_rows{0}, redundant_rows{0}, duplicate_rows{0}, fixed_columns{0},
+                 empty_columns{0}, removed_nonzeros{0}, num_passes{0} {}
+
+      [[nodiscard]] size_t removed_rows() const {
+         return singleton_rows + forcing_rows + redundant_rows + duplicate_rows;
+      }
+   };
+
+   explicit Presolve(const MIP_Model &original_);
+
+   // the reductions proved that the model has no solution; the reduced model is then meaningless
+   [[nodiscard]] bool is_infeasible() const { return _infeasible; }
+
+   [[nodiscard]] const MIP_Model &get_model() const { return _reduced; }
+
+   [[nodiscard]] const Report &get_report() const { return _report; }
+
+   // the column of the original model behind column @p col of the reduced one
+   [[nodiscard]] VarID original_column(VarID col) const { return _original_column[col]; }
+
+   [[nodiscard]] const std::vector<VarID> &get_original_columns() const { return _original_column; }
+
+   // the column of the reduced model for column @p col of the original one, or Removed if it was fixed
+   [[nodiscard]] VarID reduced_column(VarID col) const { return _reduced_column[col]; }
+
+   // the solution of the original model that corresponds to @p values, a solution of the reduced model
+   [[nodiscard]] std::vector<double> postsolve(const std::vector<double> &values) const;
+
+   // the values of the reduced columns in @p values, a solution of the original model
+   [[nodiscard]] std::vector<double> reduce(const std::vector<double> &values) const;
+
+   // a vector indexed by the columns of the original model, restricted to the reduced ones
+   template<typename T>
+   [[nodiscard]] std::vector<T> reduce_columns(const std::vector<T> &by_original_column) const {
+      std::vector<T> by_column;
+      by_column.reserve(_original_column.size());
+      for (VarID col: _original_column) {
+         by_column.push_back(by_original_column[col]);
+      }
+      return by_column;
+   }
+
+   void print_report(std::ostream &os) const;
+
+private:
+   struct Row {
+      std::vector<VarIdxCoeffPair> entries;  // sorted by column, without repetitions
+      double rhs;
+      ConstraintSink::Relation rel;
+      bool removed;
+   };
+
+   // tightens the bounds of @p col to [lb, ub], rounded if it is binary. Returns false if they become empty
+   bool tighten_bounds(VarID col, double lb, double ub);
+
+   // applies the row reductions to @p row. Returns true if something changed
+   bool reduce_row(Row &row);
+
+   // fixes the columns that appear in no row. Returns true if something changed
+   bool fix_empty_columns();
+
+   // merges parallel rows. Returns true if a row was removed
+   bool merge_duplicate_rows();
+
+   void build_reduced_model();
+
+   const MIP_Model &_original;
+   double _sense;  // 1 for Min, -1 for Max, 0 for Feasible
+   std::vector<double> _lower;
+   std::vector<double> _upper;
+   std::vector<Row> _rows;
+   bool _infeasible;
+   Report _report;
+   MIP_Model _reduced;
+   std::vector<VarID> _original_column;
+   std::vector<VarID> _reduced_column;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_PRESOLVE_H
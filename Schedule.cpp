@@ -0,0 +1,303 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include "Schedule.h"
+
+namespace {
+   // the width of the first column of print_table(), with the hours
+   constexpr size_t HOUR_COLUMN_WIDTH = 8;
+
+   std::string_view trim(std::string_view text) {
+      size_t begin = text.find_first_not_of(' ');
+      if (begin == std::string_view::npos) {
+         return {};
+      }
+      return text.substr(begin, text.find_last_not_of(' ') + 1 - begin);
+   }
+}
+
+Schedule::Schedule(const Input &input_) : _input{input_},
+                                          _lessons(_input.num_classes(), WeekGrid<unsigned int>(NoLesson)) {}
+
+Schedule::Schedule(const Input &input_, const Variables &variables, const std::vector<double> &values)
+      : Schedule(input_) {
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      unsigned int class_idx = _input.convert_from_class_id(_input.get_requirements()[req_idx].class_id());
+      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
+            Variables::VarID lesson = variables.requirement_var(req_idx, day, hour);
+            if (lesson != Variables::InvalidVarID and values[lesson] > 0.5) {
+               _lessons[class_idx](day, hour) = req_idx;
+            }
+         }
+      }
+   }
+}
+
+Schedule::Schedule(const Input &input_, std::istream &is) : Schedule(input_) {
+   std::string line;
+   size_t line_number = 0;
+   auto error = [&line_number](const std::string &message) {
+      return std::logic_error("schedule line " + std::to_string(line_number) + ": " + message);
+   };
+   while (std::getline(is, line)) {
+      ++line_number;
+      if (trim(line).empty()) {
+         continue;
+      }
+      // the title, with the id of the class in parentheses at the end
+      size_t open = line.rfind('(');
+      size_t close = line.rfind(')');
+      if (open == std::string::npos or close == std::string::npos or close < open + 2) {
+         throw error("expected the title of a class, with its id in parentheses");
+      }
+      Input::ID class_id = 0;
+      for (size_t pos = open + 1; pos != close; ++pos) {
+         if (line[pos] < '0' or line[pos] > '9' or class_id >= Input::MAX_ID) {
+            throw error("the id of the class is not a number below " + std::to_string(Input::MAX_ID));
+         }
+         class_id = 10 * class_id + (line[pos] - '0');
+      }
+      Input::ID class_idx = _input.convert_from_class_id(class_id);
+
+      // the days, with the width of their columns
+      ++line_number;
+      if (not std::getline(is, line) or line.find("Day 1") != HOUR_COLUMN_WIDTH) {
+         throw error("expected the days of the week");
+      }
+      size_t width = line.find("Day 2") == std::string::npos ? line.size() : line.find("Day 2") - HOUR_COLUMN_WIDTH;
+
+      // the hours, up to an empty line
+      for (unsigned int hour = 0; std::getline(is, line) and not trim(line).empty(); ++hour) {
+         ++line_number;
+         if (line.compare(0, 5, "Hour ") != 0 or std::stoul(line.substr(5)) != hour + 1) {
+            throw error("expected hour " + std::to_string(hour + 1));
+         }
+         if (class_idx == Input::InvalidID) {
+            continue;
+         }
+         const Input::Class &school_class = _input.get_classes()[class_idx];
+         for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+            size_t begin = HOUR_COLUMN_WIDTH + day * width;
+            if (hour >= school_class.num_hours_per_day[day] or begin >= line.size()) {
+               continue;
+            }
+            std::string_view teacher_name = trim(std::string_view(line).substr(begin, width));
+            for (unsigned int req_idx: school_class.requirements) {
+               if (_input.find_teacher(_input.get_requirements()[req_idx].teacher_id())->name == teacher_name) {
+                  _lessons[class_idx](day, hour) = req_idx;
+                  break;
+               }
+            }
+         }
+      }
+      ++line_number;
+   }
+}
+
+std::vector<double> Schedule::get_values(const Variables &variables) const {
+   const ModelOptions &options = variables.get_options();
+   std::vector<double> values(variables.num_var(), 0.0);
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      const Input::Requirement &requirement = _input.get_requirements()[req_idx];
+      unsigned int class_idx = _input.convert_from_class_id(requirement.class_id());
+      unsigned int teacher_idx = _input.convert_from_teacher_id(requirement.teacher_id());
+      unsigned int num_pairs = 0;
+      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+         const unsigned int num_hours = Input::NUM_HOURS_PER_DAY[day];
+         unsigned int first_hour = num_hours;
+         for (unsigned int hour = 0; hour != num_hours; ++hour) {
+            if (_lessons[class_idx](day, hour) != req_idx) {
+               continue;
+            }
+            first_hour = std::min(first_hour, hour);
+            Variables::VarID lesson = variables.requirement_var(req_idx, day, hour);
+            if (lesson != Variables::InvalidVarID) {
+               values[lesson] = 1.0;
+            }
+            values[variables.teacher_has_lesson_var(teacher_idx, day, hour)] += 1.0;
+         }
+         if (first_hour == num_hours) {
+            continue;
+         }
+         // the pairs count the first days with two consecutive lessons, as many as the requirement wants
+         if (num_pairs != requirement.num_days_with_cons_hours and first_hour + 1 != num_hours and
+             _lessons[class_idx](day, first_hour + 1) == req_idx) {
+            Variables::VarID pair = variables.requirement_cons_var_from_hour(req_idx, day, first_hour);
+            if (pair != Variables::InvalidVarID) {
+               values[pair] = 1.0;
+               ++num_pairs;
+            }
+         }
+         if (options.contiguity == ModelOptions::BlockStartContiguity) {
+            // the block starts at the first lesson, or just before it on the last hour
+            Variables::VarID block_start = variables.requirement_block_start_var(
+                  req_idx, day, std::min(first_hour, num_hours - 2));
+            if (block_start != Variables::InvalidVarID) {
+               values[block_start] = 1.0;
+            }
+         }
+      }
+   }
+   for (unsigned int teacher_idx = 0; teacher_idx != _input.num_teachers(); ++teacher_idx) {
+      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+         const unsigned int num_hours = Input::NUM_HOURS_PER_DAY[day];
+         unsigned int first_hour = num_hours;
+         unsigned int last_hour = 0;
+         for (unsigned int hour = 0; hour != num_hours; ++hour) {
+            if (values[variables.teacher_has_lesson_var(teacher_idx, day, hour)] > 0.5) {
+               first_hour = std::min(first_hour, hour);
+               last_hour = hour;
+            }
+         }
+         for (unsigned int hour = 0; hour != num_hours; ++hour) {
+            bool begun = hour >= first_hour;
+            bool not_over = hour <= last_hour and first_hour != num_hours;
+            values[variables.teacher_is_in_school_var(teacher_idx, day, hour)] = begun and not_over ? 1.0 : 0.0;
+            if (options.in_school == ModelOptions::CompactInSchool) {
+               values[variables.teacher_lessons_begun_var(teacher_idx, day, hour)] = begun ? 1.0 : 0.0;
+               values[variables.teacher_lessons_not_over_var(teacher_idx, day, hour)] = not_over ? 1.0 : 0.0;
+            }
+         }
+      }
+   }
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      DayArray<double> weights{};
+      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
+            unsigned int req_idx = _lessons[class_idx](day, hour);
+            if (req_idx != NoLesson) {
+               weights[day] += _input.get_requirements()[req_idx].average_lesson_weight;
+            }
+         }
+         values[variables.day_weight_for_class(class_idx, day)] = weights[day];
+      }
+      DayArray<double> sorted_weights = weights;
+      std::sort(sorted_weights.begin(), sorted_weights.end(), std::greater<>());
+      for (unsigned int k = 0; k != Input::NUM_DAYS_PER_WEEK; ++k) {
+         values[variables.day_weight_for_class_sorted(class_idx, k)] = sorted_weights[k];
+         if (options.day_weight == ModelOptions::KSumDayWeight) {
+            // the k+1 largest weights are k+1 times the (k+1)-th one, plus what each day has above it
+            values[variables.day_weight_threshold_var(class_idx, k)] = sorted_weights[k];
+            for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+               values[variables.day_weight_excess_var(class_idx, k, day)] = std::max(weights[day] - sorted_weights[k],
+                                                                                     0.0);
+            }
+         }
+      }
+   }
+   return values;
+}
+
+size_t Schedule::num_lessons() const {
+   size_t num_lessons = 0;
+   for (const WeekGrid<unsigned int> &lessons: _lessons) {
+      num_lessons += std::count_if(lessons.begin(), lessons.end(), [](unsigned int req_idx) {
+         return req_idx != NoLesson;
+      });
+   }
+   return num_lessons;
+}
+
+size_t Schedule::num_moved_lessons(const Schedule &other) const {
+   size_t num_moved = 0;
+   for (unsigned int class_idx = 0; class_idx != _lessons.size(); ++class_idx) {
+      for (unsigned int slot = 0; slot != WeekShape::NUM_SLOTS; ++slot) {
+         unsigned int req_idx = _lessons[class_idx][slot];
+         if (req_idx != NoLesson and other._lessons[class_idx][slot] != req_idx) {
+            ++num_moved;
+         }
+      }
+   }
+   return num_moved;
+}
+
+void Schedule::add_disruption(MIP_Model &model, const Variables &variables, double weight) const {
+   for (unsigned int class_idx = 0; class_idx != _lessons.size(); ++class_idx) {
+      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
+            unsigned int req_idx = _lessons[class_idx](day, hour);
+            if (req_idx == NoLesson) {
+               continue;
+            }
+            model.objective_offset += weight;
+            Variables::VarID lesson = variables.requirement_var(req_idx, day, hour);
+            if (lesson != Variables::InvalidVarID) {
+               model.objective[lesson] -= weight;
+            }
+         }
+      }
+   }
+}
+
+void Schedule::print_classes(std::ostream &os) const {
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      const Input::Class &school_class = _input.get_classes()[class_idx];
+      std::vector<std::vector<std::string>> cells(Input::NUM_DAYS_PER_WEEK);
+      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
+            unsigned int req_idx = _lessons[class_idx](day, hour);
+            cells[day].emplace_back(req_idx == NoLesson ? "-" : _input.find_teacher(
+                  _input.get_requirements()[req_idx].teacher_id())->name);
+         }
+      }
+      print_table(os, school_class.name + " (" + std::to_string(school_class.id) + ")", cells);
+   }
+}
+
+void Schedule::print_teachers(std::ostream &os) const {
+   for (const Input::Teacher &teacher: _input.get_teachers()) {
+      std::vector<std::vector<std::string>> cells(Input::NUM_DAYS_PER_WEEK);
+      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+         cells[day].assign(Input::NUM_HOURS_PER_DAY[day], "-");
+         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
+            if (not teacher.is_available(day, hour)) {
+               cells[day][hour] = "x";
+            }
+         }
+      }
+      for (unsigned int req_idx: teacher.requirements) {
+         const Input::Requirement &requirement = _input.get_requirements()[req_idx];
+         unsigned int class_idx = _input.convert_from_class_id(requirement.class_id());
+         for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
+            for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
+               if (_lessons[class_idx](day, hour) == req_idx) {
+                  cells[day][hour] = _input.get_classes()[class_idx].name;
+               }
+            }
+         }
+      }
+      print_table(os, teacher.name + " (" + std::to_string(teacher.id / Input::MAX_ID) + ")", cells);
+   }
+}
+
+void Schedule::print_table(std::ostream &os, const std::string &title,
+                           const std::vector<std::vector<std::string>> &cells) {
+   size_t width = 6;
+   unsigned int max_hours = 0;
+   for (const auto &day_cells: cells) {
+      max_hours = std::max<unsigned int>(max_hours, day_cells.size());
+      for (const std::string &cell: day_cells) {
+         width = std::max(width, cell.length() + 2);
+      }
+   }
+   os << title << '\n' << std::setw(8) << "";
+   for (unsigned int day = 0; day != cells.size(); ++day) {
+      os << std::left << std::setw(width) << "Day " + std::to_string(day + 1);
+   }
+   os << '\n';
+   for (unsigned int hour = 0; hour != max_hours; ++hour) {
+      os << std::left << std::setw(8) << "Hour " + std::to_string(hour + 1);
+      for (const auto &day_cells: cells) {
+         os << std::left << std::setw(width) << (hour < day_cells.size() ? day_cells[hour] : "");
+      }
+      os << '\n';
+   }
+   os << std::right << '\n';
+}
@@ -0,0 +1,65 @@
+#ifndef SCHEDULE_HIGHSCHOOL_SCHEDULE_H
+#define SCHEDULE_HIGHSCHOOL_SCHEDULE_H
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "Input.h"
+#include "MIP_Model.h"
+#include "Variables.h"
+
+// The lessons of every class at every hour of the week, as positions in Input::get_requirements()
+class Schedule {
+public:
+   static constexpr unsigned int NoLesson = std::numeric_limits<unsigned int>::max();
+
+   explicit Schedule(const Input &input_);
+
+   // reads the lessons from the requirement variables of a solution of the model
+   Schedule(const Input &input_, const Variables &variables, const std::vector<double> &values);
+
+   // reads the lessons from the tables of print_classes(), which may come from an earlier version of the input: the
+   // classes are found by id, and the teachers by name among the requirements of the class. The lessons of the
+   // other classes and teachers, and those after the hours of a class, are left out. Throws std::logic_error if the
+   // text is not such tables
+   Schedule(const Input &input_, std::istream &is);
+
+   [[nodiscard]] unsigned int get_lesson(unsigned int class_idx, unsigned int day, unsigned int hour) const {
+      return _lessons[class_idx](day, hour);
+   }
+
+   void set_lesson(unsigned int class_idx, unsigned int day, unsigned int hour, unsigned int requirement_pos) {
+      _lessons[class_idx](day, hour) = requirement_pos;
+   }
+
+   // the solution of the model of @p variables with these lessons, every variable included: the others take the
+   // lowest values that the rows allow, as they would at an optimum. It satisfies the model only if the lessons do,
+   // so it can start BB_Solver
+   [[nodiscard]] std::vector<double> get_values(const Variables &variables) const;
+
+   [[nodiscard]] size_t num_lessons() const;
+
+   // the lessons of this schedule that @p other does not have at the same hour
+   [[nodiscard]] size_t num_moved_lessons(const Schedule &other) const;
+
+   // adds to the objective of @p model, built from @p variables, @p weight for every lesson of this schedule that a
+   // solution moves: -weight on its lesson column and weight in the offset, so that the lessons kept cost nothing.
+   // A lesson without a column, at an hour that the input no longer allows, always costs weight
+   void add_disruption(MIP_Model &model, const Variables &variables, double weight) const;
+
+   // one table per class, with the name of the teacher at every hour
+   void print_classes(std::ostream &os) const;
+
+   // one table per teacher, with the name of the class at every hour
+   void print_teachers(std::ostream &os) const;
+
+private:
+   static void print_table(std::ostream &os, const std::string &title,
+                           const std::vector<std::vector<std::string>> &cells);
+
+   const Input &_input;
+   std::vector<WeekGrid<unsigned int>> _lessons;  // _lessons[class](day, hour)
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_SCHEDULE_H
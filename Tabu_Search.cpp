@@ -0,0 +1,464 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include "Tabu_Search.h"
+#include "Trace.h"
+
+namespace {
+   constexpr unsigned int NUM_DAYS = WeekShape::NUM_DAYS;
+   // a violated hard constraint costs more than any move can gain in objective
+   constexpr double VIOLATION_COST = 1000.0;
+   constexpr double COST_TOLERANCE = 1e-9;
+   // longer Kempe chains move most of the school at once, and are not worth evaluating
+   constexpr size_t MAX_CHAIN_CLASSES = 64;
+   // random classes tried in search of one with a violation
+   constexpr unsigned int MAX_PICK_ATTEMPTS = 16;
+   constexpr size_t ITERATIONS_PER_CLOCK_CHECK = 64;
+}
+
+double TabuSearch::Cost::total() const {
+   return objective + VIOLATION_COST * double(violations);
+}
+
+bool TabuSearch::Cost::is_better_than(const Cost &other) const {
+   if (violations != other.violations) {
+      return violations < other.violations;
+   }
+   return objective < other.objective - COST_TOLERANCE;
+}
+
+TabuSearch::Cost &TabuSearch::Cost::operator+=(const Cost &other) {
+   objective += other.objective;
+   violations += other.violations;
+   return *this;
+}
+
+TabuSearch::Cost &TabuSearch::Cost::operator-=(const Cost &other) {
+   objective -= other.objective;
+   violations -= other.violations;
+   return *this;
+}
+
+TabuSearch::TabuSearch(const Input &input_, Options options_) : _input{input_}, _options{std::move(options_)},
+                                                                _random(_options.seed), _occupancy(_input),
+                                                                _iteration{0}, _disruption_weight{0.0} {
+   _class_slots.resize(_input.num_classes());
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      const Input::Class &school_class = _input.get_classes()[class_idx];
+      for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != school_class.num_hours_per_day[day]; ++hour) {
+            _class_slots[class_idx].push_back(WeekShape::slot(day, hour));
+         }
+      }
+   }
+}
+
+TabuSearch::Result TabuSearch::run() {
+   TRACE_SCOPE("TabuSearch::run");
+   auto start_time = std::chrono::steady_clock::now();
+   auto elapsed = [&start_time] {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+   };
+   build_greedy();
+   reset_costs();
+   _tabu_until.assign(_input.num_requirements(), WeekGrid<size_t>(0));
+   _best_lessons = _lessons;
+   _best_cost = _cost;
+
+   std::vector<Swap> best_move;
+   for (_iteration = 0; _iteration != _options.iteration_limit; ++_iteration) {
+      if (_iteration % ITERATIONS_PER_CLOCK_CHECK == 0 and elapsed() >= _options.time_limit) {
+         break;
+      }
+      // the best move that is not tabu, or that gives the best schedule yet. Ties are broken at random
+      double best_delta = std::numeric_limits<double>::infinity();
+      unsigned int num_ties = 0;
+      best_move.clear();
+      auto consider = [&](const std::vector<Swap> &swaps) {
+         Cost delta = evaluate(swaps);
+         Cost after = _cost;
+         after += delta;
+         if (is_tabu(swaps) and not after.is_better_than(_best_cost)) {
+            return;
+         }
+         if (delta.total() < best_delta - COST_TOLERANCE) {
+            best_delta = delta.total();
+            num_ties = 1;
+            best_move = swaps;
+         } else if (delta.total() < best_delta + COST_TOLERANCE and _random() % ++num_ties == 0) {
+            best_move = swaps;
+         }
+      };
+
+      unsigned int class_idx = pick_class();
+      const std::vector<unsigned int> &slots = _class_slots[class_idx];
+      const WeekGrid<unsigned int> &lessons = _lessons[class_idx];
+      for (size_t pos_a = 0; pos_a != slots.size(); ++pos_a) {
+         for (size_t pos_b = pos_a + 1; pos_b != slots.size(); ++pos_b) {
+            if (lessons[slots[pos_a]] != lessons[slots[pos_b]]) {
+               _move.assign(1, Swap{class_idx, slots[pos_a], slots[pos_b]});
+               consider(_move);
+            }
+         }
+      }
+      for (unsigned int chain_idx = 0; chain_idx != _options.num_chains and slots.size() > 1; ++chain_idx) {
+         unsigned int slot_a = slots[_random() % slots.size()];
+         unsigned int slot_b = slots[_random() % slots.size()];
+         // a chain of one class is a swap, already considered
+         if (lessons[slot_a] != lessons[slot_b] and build_chain(class_idx, slot_a, slot_b) and _chain.size() > 1) {
+            consider(_chain);
+         }
+      }
+
+      if (best_move.empty()) {
+         continue;  // every move is tabu
+      }
+      commit(best_move);
+      if (_cost.is_better_than(_best_cost)) {
+         _best_lessons = _lessons;
+         _best_cost = _cost;
+      }
+   }
+
+   // the cached costs add up many differences: the reported ones are computed again
+   _lessons = _best_lessons;
+   reset_costs();
+   Result result{};
+   result.objective = _cost.objective;
+   result.violations = _cost.violations;
+   result.iterations = _iteration;
+   result.seconds = elapsed();
+   return result;
+}
+
+void TabuSearch::set_previous(const Schedule &previous, double disruption_weight) {
+   _previous_lessons.assign(_input.num_requirements(), WeekMask());
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+            unsigned int req_idx = previous.get_lesson(class_idx, day, hour);
+            if (req_idx != Schedule::NoLesson) {
+               _previous_lessons[req_idx].set(WeekShape::slot(day, hour));
+            }
+         }
+      }
+   }
+   _disruption_weight = disruption_weight;
+}
+
+Schedule TabuSearch::get_best_schedule() const {
+   Schedule schedule(_input);
+   for (unsigned int class_idx = 0; class_idx != _best_lessons.size(); ++class_idx) {
+      for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+            schedule.set_lesson(class_idx, day, hour, _best_lessons[class_idx](day, hour));
+         }
+      }
+   }
+   return schedule;
+}
+
+void TabuSearch::build_greedy() {
+   _lessons.assign(_input.num_classes(), WeekGrid<unsigned int>(Schedule::NoLesson));
+   _occupancy.clear();
+   std::vector<unsigned int> lessons_left;
+   std::vector<WeekMask> conflicts;
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      const std::vector<unsigned int> &requirements = _input.get_classes()[class_idx].requirements;
+      lessons_left.clear();
+      for (unsigned int req_idx: requirements) {
+         lessons_left.push_back(_input.get_requirements()[req_idx].num_lessons());
+      }
+      // a lesson at one hour of the class changes no conflict at the others
+      conflicts.resize(requirements.size());
+      _occupancy.conflict_masks(Span<const unsigned int>(requirements.data(), requirements.size()),
+                                Span<WeekMask>(conflicts.data(), conflicts.size()));
+      if (not _previous_lessons.empty()) {
+         for (size_t pos = 0; pos != requirements.size(); ++pos) {
+            WeekMask kept = _previous_lessons[requirements[pos]] & _occupancy.class_hours(class_idx);
+            while (not kept.empty() and lessons_left[pos] != 0) {
+               unsigned int slot = kept.pop_lowest();
+               --lessons_left[pos];
+               _lessons[class_idx][slot] = requirements[pos];
+               _occupancy.add_lesson(requirements[pos], slot);
+            }
+         }
+      }
+      for (unsigned int slot: _class_slots[class_idx]) {
+         if (_lessons[class_idx][slot] != Schedule::NoLesson) {
+            continue;
+         }
+         // without a conflict if possible, then the most lessons left
+         size_t best_pos = requirements.size();
+         std::pair<bool, int> best_score;
+         for (size_t pos = 0; pos != requirements.size(); ++pos) {
+            if (lessons_left[pos] == 0) {
+               continue;
+            }
+            std::pair<bool, int> score(conflicts[pos].test(slot), -int(lessons_left[pos]));
+            if (best_pos == requirements.size() or score < best_score) {
+               best_pos = pos;
+               best_score = score;
+            }
+         }
+         if (best_pos == requirements.size()) {
+            break;  // Input checks that the lessons fill the hours of the class
+         }
+         --lessons_left[best_pos];
+         _lessons[class_idx][slot] = requirements[best_pos];
+         _occupancy.add_lesson(requirements[best_pos], slot);
+      }
+   }
+}
+
+void TabuSearch::reset_costs() {
+   _occupancy.clear();
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      for (unsigned int slot: _class_slots[class_idx]) {
+         _occupancy.add_lesson(_lessons[class_idx][slot], slot);
+      }
+   }
+   _cost = Cost();
+   _teacher_day_cost.resize(_input.num_teachers());
+   for (unsigned int teacher_idx = 0; teacher_idx != _input.num_teachers(); ++teacher_idx) {
+      for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+         _teacher_day_cost[teacher_idx][day] = teacher_day_cost(teacher_idx, day);
+         _cost += _teacher_day_cost[teacher_idx][day];
+      }
+   }
+   _class_cost.resize(_input.num_classes());
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      _class_cost[class_idx] = class_cost(class_idx);
+      _cost.objective += _class_cost[class_idx];
+   }
+   _requirement_violations.resize(_input.num_requirements());
+   _requirement_disruption.resize(_input.num_requirements());
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      _requirement_violations[req_idx] = requirement_violations(req_idx);
+      _cost.violations += _requirement_violations[req_idx];
+      _requirement_disruption[req_idx] = requirement_disruption(req_idx);
+      _cost.objective += _requirement_disruption[req_idx];
+   }
+}
+
+TabuSearch::Cost TabuSearch::teacher_day_cost(unsigned int teacher_idx, unsigned int day) const {
+   // in school from the first lesson to the last one, as teacher_is_in_school in the model
+   const Input::Teacher &teacher = _input.get_teachers()[teacher_idx];
+   WeekMask in_school = (_occupancy.teacher_busy(teacher_idx) & WeekMask::day_hours(day)).span();
+   WeekMask available = in_school & _occupancy.teacher_available(teacher_idx);
+   Cost cost(0.0, _occupancy.teacher_clashes(teacher_idx, day) + (in_school & ~available).count());
+   while (not available.empty()) {
+      cost.objective += teacher.penalties[available.pop_lowest()];
+   }
+   return cost;
+}
+
+double TabuSearch::class_cost(unsigned int class_idx) const {
+   // the sorted day weights with the coefficients of LP_Provider::create_objective, in the same order of addition
+   const Input::Class &school_class = _input.get_classes()[class_idx];
+   DayArray<double> weights{};
+   for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+      for (unsigned int hour = 0; hour != school_class.num_hours_per_day[day]; ++hour) {
+         weights[day] += _input.get_requirements()[_lessons[class_idx](day, hour)].average_lesson_weight;
+      }
+   }
+   std::sort(weights.begin(), weights.end(), std::greater<>());
+   double cost = 0.0;
+   for (unsigned int k = 0; k != NUM_DAYS; ++k) {
+      cost += std::max(1 - double(k) / (NUM_DAYS - 1), 0.0) * weights[k];
+   }
+   return cost;
+}
+
+long TabuSearch::requirement_violations(unsigned int req_idx) const {
+   // a violation for every pair of lessons in a day that are not adjacent, and for every missing day with two
+   // consecutive lessons
+   long violations = 0;
+   for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+      violations += _occupancy.split_pairs(req_idx, day);
+   }
+   unsigned int num_pair_days = _occupancy.pair_days(req_idx);
+   unsigned int num_cons_days = _input.get_requirements()[req_idx].num_days_with_cons_hours;
+   if (num_pair_days < num_cons_days) {
+      violations += num_cons_days - num_pair_days;
+   }
+   return violations;
+}
+
+double TabuSearch::requirement_disruption(unsigned int req_idx) const {
+   if (_previous_lessons.empty()) {
+      return 0.0;
+   }
+   return _disruption_weight * (_previous_lessons[req_idx] & ~_occupancy.requirement_lessons(req_idx)).count();
+}
+
+void TabuSearch::apply(const Swap &swap) {
+   WeekGrid<unsigned int> &lessons = _lessons[swap.class_idx];
+   unsigned int req_a = lessons[swap.slot_a];
+   unsigned int req_b = lessons[swap.slot_b];
+   _occupancy.remove_lesson(req_a, swap.slot_a);
+   _occupancy.remove_lesson(req_b, swap.slot_b);
+   _occupancy.add_lesson(req_a, swap.slot_b);
+   _occupancy.add_lesson(req_b, swap.slot_a);
+   std::swap(lessons[swap.slot_a], lessons[swap.slot_b]);
+}
+
+void TabuSearch::collect_affected(const std::vector<Swap> &swaps) {
+   _affected.teacher_days.clear();
+   _affected.classes.clear();
+   _affected.requirements.clear();
+   auto add = [](auto &parts, const auto &part) {
+      if (std::find(parts.begin(), parts.end(), part) == parts.end()) {
+         parts.push_back(part);
+      }
+   };
+   for (const Swap &swap: swaps) {
+      unsigned int day_a = WeekShape::day_of(swap.slot_a);
+      unsigned int day_b = WeekShape::day_of(swap.slot_b);
+      for (unsigned int slot: {swap.slot_a, swap.slot_b}) {
+         unsigned int req_idx = _lessons[swap.class_idx][slot];
+         add(_affected.requirements, req_idx);
+         add(_affected.teacher_days, std::make_pair(_occupancy.teacher_of(req_idx), day_a));
+         add(_affected.teacher_days, std::make_pair(_occupancy.teacher_of(req_idx), day_b));
+      }
+      if (day_a != day_b) {
+         add(_affected.classes, swap.class_idx);
+      }
+   }
+}
+
+TabuSearch::Cost TabuSearch::cached_cost() const {
+   Cost cost;
+   for (const auto &teacher_day: _affected.teacher_days) {
+      cost += _teacher_day_cost[teacher_day.first][teacher_day.second];
+   }
+   for (unsigned int class_idx: _affected.classes) {
+      cost.objective += _class_cost[class_idx];
+   }
+   for (unsigned int req_idx: _affected.requirements) {
+      cost.violations += _requirement_violations[req_idx];
+      cost.objective += _requirement_disruption[req_idx];
+   }
+   return cost;
+}
+
+TabuSearch::Cost TabuSearch::computed_cost() const {
+   Cost cost;
+   for (const auto &teacher_day: _affected.teacher_days) {
+      cost += teacher_day_cost(teacher_day.first, teacher_day.second);
+   }
+   for (unsigned int class_idx: _affected.classes) {
+      cost.objective += class_cost(class_idx);
+   }
+   for (unsigned int req_idx: _affected.requirements) {
+      cost.violations += requirement_violations(req_idx);
+      cost.objective += requirement_disruption(req_idx);
+   }
+   return cost;
+}
+
+TabuSearch::Cost TabuSearch::evaluate(const std::vector<Swap> &swaps) {
+   collect_affected(swaps);
+   Cost before = cached_cost();
+   for (const Swap &swap: swaps) {
+      apply(swap);
+   }
+   Cost delta = computed_cost();
+   delta -= before;
+   // a swap is its own inverse, so the swaps in reverse order undo them
+   for (auto swap = swaps.rbegin(); swap != swaps.rend(); ++swap) {
+      apply(*swap);
+   }
+   return delta;
+}
+
+bool TabuSearch::is_tabu(const std::vector<Swap> &swaps) const {
+   for (const Swap &swap: swaps) {
+      const WeekGrid<unsigned int> &lessons = _lessons[swap.class_idx];
+      if (_tabu_until[lessons[swap.slot_a]][swap.slot_b] > _iteration or
+          _tabu_until[lessons[swap.slot_b]][swap.slot_a] > _iteration) {
+         return true;
+      }
+   }
+   return false;
+}
+
+void TabuSearch::commit(const std::vector<Swap> &swaps) {
+   for (const Swap &swap: swaps) {
+      const WeekGrid<unsigned int> &lessons = _lessons[swap.class_idx];
+      for (unsigned int slot: {swap.slot_a, swap.slot_b}) {
+         _tabu_until[lessons[slot]][slot] = _iteration + _options.tenure + _random() % (_options.tenure / 2 + 1);
+      }
+   }
+   collect_affected(swaps);
+   _cost -= cached_cost();
+   for (const Swap &swap: swaps) {
+      apply(swap);
+   }
+   for (const auto &teacher_day: _affected.teacher_days) {
+      _teacher_day_cost[teacher_day.first][teacher_day.second] = teacher_day_cost(teacher_day.first,
+                                                                                  teacher_day.second);
+   }
+   for (unsigned int class_idx: _affected.classes) {
+      _class_cost[class_idx] = class_cost(class_idx);
+   }
+   for (unsigned int req_idx: _affected.requirements) {
+      _requirement_violations[req_idx] = requirement_violations(req_idx);
+      _requirement_disruption[req_idx] = requirement_disruption(req_idx);
+   }
+   _cost += cached_cost();
+}
+
+bool TabuSearch::build_chain(unsigned int class_idx, unsigned int slot_a, unsigned int slot_b) {
+   _chain.clear();
+   _chain_classes.assign(1, class_idx);
+   for (size_t pos = 0; pos != _chain_classes.size(); ++pos) {
+      unsigned int chain_class = _chain_classes[pos];
+      _chain.push_back(Swap{chain_class, slot_a, slot_b});
+      // the other lessons of the two teachers at the two hours move too
+      for (unsigned int slot: {slot_a, slot_b}) {
+         unsigned int teacher_idx = _occupancy.teacher_of(_lessons[chain_class][slot]);
+         for (unsigned int other_req: _input.get_teachers()[teacher_idx].requirements) {
+            unsigned int other_class = _occupancy.class_of(other_req);
+            const WeekGrid<unsigned int> &lessons = _lessons[other_class];
+            if ((lessons[slot_a] != other_req and lessons[slot_b] != other_req) or
+                std::find(_chain_classes.begin(), _chain_classes.end(), other_class) != _chain_classes.end()) {
+               continue;
+            }
+            if (lessons[slot_a] == Schedule::NoLesson or lessons[slot_b] == Schedule::NoLesson or
+                _chain_classes.size() == MAX_CHAIN_CLASSES) {
+               return false;
+            }
+            _chain_classes.push_back(other_class);
+         }
+      }
+   }
+   return true;
+}
+
+unsigned int TabuSearch::pick_class() {
+   unsigned int class_idx = _random() % _input.num_classes();
+   for (unsigned int attempt = 1; attempt < MAX_PICK_ATTEMPTS and _cost.violations != 0 and
+                                  not has_violations(class_idx); ++attempt) {
+      class_idx = _random() % _input.num_classes();
+   }
+   return class_idx;
+}
+
+bool TabuSearch::has_violations(unsigned int class_idx) const {
+   for (unsigned int req_idx: _input.get_classes()[class_idx].requirements) {
+      if (_requirement_violations[req_idx] != 0) {
+         return true;
+      }
+      for (const Cost &cost: _teacher_day_cost[_occupancy.teacher_of(req_idx)]) {
+         if (cost.violations != 0) {
+            return true;
+         }
+      }
+   }
+   return false;
+}
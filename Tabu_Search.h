@@ -0,0 +1,165 @@
+#ifndef SCHEDULE_HIGHSCHOOL_TABU_SEARCH_H
+#define SCHEDULE_HIGHSCHOOL_TABU_SEARCH_H
+
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+#include "Input.h"
+#include "Occupancy.h"
+#include "Schedule.h"
+
+// Tabu search for a good schedule in seconds, with the objective of the model of LP_Provider: the penalties of the
+// hours that teachers spend in school, and the balance of the sorted day weights of every class.
+// The state is a grid with the requirement of every class at every hour of the week. The lessons of a class always
+// fill its hours, and a move exchanges the lessons at two hours: in one class (a swap), or in all the classes linked
+// to it by the teachers of those lessons (a Kempe chain), which gives no teacher a second lesson at either hour.
+// The hard constraints that a move can break are counted as violations, each costing more than any objective: a
+// teacher with two lessons at once or in school when unavailable, the lessons of a requirement on a day that are not
+// one block of at most two hours, and fewer days with two consecutive lessons than the requirement asks.
+// A move changes the costs of a few teachers (on two days), classes and requirements: they are cached, and each is
+// recomputed from one week of the grid, or from the week masks of an Occupancy, whatever the size of the input.
+// A lesson cannot return to an hour it left for some iterations (the tabu tenure), unless that gives the best
+// schedule yet
+class TabuSearch {
+public:
+   struct Options {
+      double time_limit;  // in seconds
+      size_t iteration_limit;
+      unsigned int tenure;  // a lesson may return to an hour after tenure to 3/2 tenure iterations
+      unsigned int num_chains;  // Kempe chains tried at every iteration, besides all the swaps in one class
+      unsigned int seed;
+
+      Options() : time_limit{10.0}, iteration_limit{std::numeric_limits<size_t>::max()}, tenure{10},
+                  num_chains{20}, seed{1} {}
+   };
+
+   struct Result {
+      double objective;  // of the best schedule, as in the model of LP_Provider, with the disruption if any
+      size_t violations;  // of the hard constraints by the best schedule: it satisfies the model only if 0
+      size_t iterations;
+      double seconds;
+   };
+
+   explicit TabuSearch(const Input &input_, Options options_ = Options());
+
+   // searches from a greedy schedule until the time or the iteration limit, keeping the best schedule
+   Result run();
+
+   // makes run() repair @p previous instead, for example the schedule of last week after an edit of the input:
+   // it starts from its lessons, as many of each requirement as it still has, with the other hours of the classes
+   // filled greedily, and adds @p disruption_weight to the objective for every lesson of @p previous that the
+   // schedule moves, as Schedule::add_disruption() does in the model
+   void set_previous(const Schedule &previous, double disruption_weight);
+
+   // the best schedule found by run()
+   [[nodiscard]] Schedule get_best_schedule() const;
+
+private:
+   // exchanges the lessons of a class at two hours of the week
+   struct Swap {
+      unsigned int class_idx;
+      unsigned int slot_a;
+      unsigned int slot_b;
+   };
+
+   struct Cost {
+      double objective;
+      long violations;
+
+      Cost() : objective{0.0}, violations{0} {}
+
+      Cost(double objective_, long violations_) : objective{objective_}, violations{violations_} {}
+
+      [[nodiscard]] double total() const;
+
+      // fewer violations, or as many and a lower objective
+      [[nodiscard]] bool is_better_than(const Cost &other) const;
+
+      Cost &operator+=(const Cost &other);
+
+      Cost &operator-=(const Cost &other);
+   };
+
+   // the parts of the state whose cost a move changes
+   struct Affected {
+      std::vector<std::pair<unsigned int, unsigned int>> teacher_days;
+      std::vector<unsigned int> classes;
+      std::vector<unsigned int> requirements;
+   };
+
+   // fills every class with its lessons, each at the hour where its teacher has the fewest conflicts, after those of
+   // the previous schedule if any
+   void build_greedy();
+
+   // computes every cached cost from the grid
+   void reset_costs();
+
+   [[nodiscard]] Cost teacher_day_cost(unsigned int teacher_idx, unsigned int day) const;
+
+   [[nodiscard]] double class_cost(unsigned int class_idx) const;
+
+   [[nodiscard]] long requirement_violations(unsigned int req_idx) const;
+
+   // the disruption weight for every lesson of the previous schedule that the requirement no longer has
+   [[nodiscard]] double requirement_disruption(unsigned int req_idx) const;
+
+   // moves the lessons in the grid and in the occupancy, leaving the cached costs as they are
+   void apply(const Swap &swap);
+
+   void collect_affected(const std::vector<Swap> &swaps);
+
+   // of the parts in _affected, from the cache or from the grid
+   [[nodiscard]] Cost cached_cost() const;
+
+   [[nodiscard]] Cost computed_cost() const;
+
+   // the change of the cost if the swaps were applied
+   [[nodiscard]] Cost evaluate(const std::vector<Swap> &swaps);
+
+   [[nodiscard]] bool is_tabu(const std::vector<Swap> &swaps) const;
+
+   // applies the swaps, updates the cached costs and forbids the moved lessons to go back
+   void commit(const std::vector<Swap> &swaps);
+
+   // fills _chain with the swaps of the Kempe chain of the lessons of the class at two hours. Returns false if the
+   // chain reaches a class without lessons at both hours, or too many classes
+   bool build_chain(unsigned int class_idx, unsigned int slot_a, unsigned int slot_b);
+
+   // a random class, if possible one with a lesson in a violation
+   unsigned int pick_class();
+
+   [[nodiscard]] bool has_violations(unsigned int class_idx) const;
+
+   const Input &_input;
+   Options _options;
+   std::mt19937 _random;
+   // the hours of the week of every class
+   std::vector<std::vector<unsigned int>> _class_slots;
+
+   std::vector<WeekGrid<unsigned int>> _lessons;  // _lessons[class][slot], Schedule::NoLesson after its last hour
+   Occupancy _occupancy;  // of the lessons in _lessons
+   std::vector<WeekGrid<size_t>> _tabu_until;  // by requirement: the first iteration it may take an hour again
+   size_t _iteration;
+
+   std::vector<DayArray<Cost>> _teacher_day_cost;
+   std::vector<double> _class_cost;
+   std::vector<long> _requirement_violations;
+   std::vector<double> _requirement_disruption;
+   Cost _cost;
+
+   std::vector<WeekGrid<unsigned int>> _best_lessons;
+   Cost _best_cost;
+
+   std::vector<WeekMask> _previous_lessons;  // by requirement, empty without a previous schedule
+   double _disruption_weight;
+
+   Affected _affected;
+   std::vector<Swap> _move;
+   std::vector<Swap> _chain;
+   std::vector<unsigned int> _chain_classes;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_TABU_SEARCH_H
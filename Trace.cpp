@@ -0,0 +1,151 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include "Trace.h"
+
+namespace {
+   thread_local size_t allocated_bytes = 0;
+   std::atomic<unsigned int> num_threads{0};
+
+   // the names are string literals of the code, but a quote or a backslash would still break the JSON
+   void write_json_string(std::ostream &os, const char *text) {
+      os << '"';
+      for (const char *character = text; *character != '\0'; ++character) {
+         if (*character == '"' or *character == '\\') {
+            os << '\\';
+         }
+         os << *character;
+      }
+      os << '"';
+   }
+}
+
+#ifdef SCHEDULE_ENABLE_TRACE
+// counts the bytes of every allocation of the calling thread. The array and nothrow forms call these
+void *operator new(size_t size) {
+   allocated_bytes += size;
+   void *pointer = std::malloc(size == 0 ? 1 : size);
+   if (pointer == nullptr) {
+      throw std::bad_alloc();
+   }
+   return pointer;
+}
+
+void operator delete(void *pointer) noexcept {
+   std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+   std::free(pointer);
+}
+#endif
+
+Trace::Trace() : _start_time{std::chrono::steady_clock::now()} {}
+
+Trace &Trace::global() {
+   static Trace trace;
+   return trace;
+}
+
+double Trace::now() const {
+   return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start_time).count();
+}
+
+void Trace::record(const Event &event) {
+   std::lock_guard<std::mutex> lock(_mutex);
+   _events.push_back(event);
+}
+
+void Trace::write_chrome_trace(std::ostream &os) const {
+   std::lock_guard<std::mutex> lock(_mutex);
+   os << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+   for (size_t event_idx = 0; event_idx != _events.size(); ++event_idx) {
+      const Event &event = _events[event_idx];
+      os << (event_idx == 0 ? "\n" : ",\n") << "{\"name\":";
+      write_json_string(os, event.name);
+      os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start << ",\"dur\":"
+         << event.duration << ",\"args\":{\"rows\":" << event.rows << ",\"nonzeros\":" << event.nonzeros
+         << ",\"bytes\":" << event.bytes << "}}";
+   }
+   os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void Trace::write_summary(std::ostream &os) const {
+   struct Total {
+      const char *name;
+      size_t count;
+      double duration;
+      size_t rows;
+      size_t nonzeros;
+      size_t bytes;
+   };
+   std::vector<Total> totals;
+   {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (const Event &event: _events) {
+         auto total = totals.begin();
+         while (total != totals.end() and std::string(total->name) != event.name) {
+            ++total;
+         }
+         if (total == totals.end()) {
+            total = totals.insert(total, Total{event.name, 0, 0.0, 0, 0, 0});
+         }
+         ++total->count;
+         total->duration += event.duration;
+         total->rows += event.rows;
+         total->nonzeros += event.nonzeros;
+         total->bytes += event.bytes;
+      }
+   }
+   std::ios_base::fmtflags flags = os.flags();
+   std::streamsize precision = os.precision();
+   os << std::fixed << std::setprecision(3) << "{\"phases\":{";
+   for (size_t total_idx = 0; total_idx != totals.size(); ++total_idx) {
+      const Total &total = totals[total_idx];
+      os << (total_idx == 0 ? "" : ",");
+      write_json_string(os, total.name);
+      os << ":{\"count\":" << total.count << ",\"ms\":" << total.duration / 1000 << ",\"rows\":" << total.rows
+         << ",\"nonzeros\":" << total.nonzeros << ",\"bytes\":" << total.bytes << "}";
+   }
+   os << "},\"total_ms\":" << now() / 1000 << "}" << std::endl;
+   os.flags(flags);
+   os.precision(precision);
+}
+
+size_t Trace::thread_allocated_bytes() {
+   return allocated_bytes;
+}
+
+unsigned int Trace::thread_index() {
+   thread_local unsigned int index = num_threads++;
+   return index;
+}
+
+TraceScope::TraceScope(const char *name_) : _event{name_, Trace::thread_index(), Trace::global().now(), 0.0, 0, 0, 0},
+                                            _start_bytes{Trace::thread_allocated_bytes()} {}
+
+TraceScope::~TraceScope() {
+   _event.duration = Trace::global().now() - _event.start;
+   _event.bytes = Trace::thread_allocated_bytes() - _start_bytes;
+   Trace::global().record(_event);
+}
+
+void TraceScope::set_rows(size_t rows, size_t nonzeros) {
+   _event.rows = rows;
+   _event.nonzeros = nonzeros;
+}
+
+TraceFile::~TraceFile() {
+   if (_path.empty() or not Trace::is_enabled()) {
+      return;
+   }
+   std::ofstream trace_stream(_path);
+   Trace::global().write_chrome_trace(trace_stream);
+   Trace::global().write_summary(_summary_stream);
+}
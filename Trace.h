@@ -0,0 +1,132 @@
+#ifndef SCHEDULE_HIGHSCHOOL_TRACE_H
+#define SCHEDULE_HIGHSCHOOL_TRACE_H
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The phases of a run (parsing, variables, every constraint family, presolve, the searches) with their wall time,
+// the bytes they allocate and, for those that build rows, the rows and nonzeros they add. A phase is a scope that
+// begins with TRACE_SCOPE(name), or with TRACE_ROWS_SCOPE(name, rows) when it adds to rows, anything with
+// num_rows() and num_nonzeros(); the names are string literals. The events are written as a Chrome trace, for
+// chrome://tracing or ui.perfetto.dev, and summed by name into a JSON summary of one line.
+// Nothing is recorded unless SCHEDULE_ENABLE_TRACE is defined (cmake -DSCHEDULE_ENABLE_TRACE=ON): the macros are then
+// empty. With it, operator new is replaced to count the bytes that every thread allocates
+class Trace {
+public:
+   struct Event {
+      const char *name;
+      unsigned int thread;
+      double start;  // in microseconds since the trace began
+      double duration;  // in microseconds
+      size_t rows;
+      size_t nonzeros;
+      size_t bytes;  // allocated, freed ones included
+   };
+
+   static constexpr bool is_enabled() {
+#ifdef SCHEDULE_ENABLE_TRACE
+      return true;
+#else
+      return false;
+#endif
+   }
+
+   // the trace of the process
+   static Trace &global();
+
+   // microseconds since the trace began
+   [[nodiscard]] double now() const;
+
+   void record(const Event &event);
+
+   // the events as a JSON object with a traceEvents array
+   void write_chrome_trace(std::ostream &os) const;
+
+   // one line of JSON, with the number of events, the time, the rows, the nonzeros and the bytes of every name, in
+   // the order of their first event
+   void write_summary(std::ostream &os) const;
+
+   // the bytes allocated so far by the calling thread. Always 0 without SCHEDULE_ENABLE_TRACE
+   static size_t thread_allocated_bytes();
+
+   // a small number that identifies the calling thread
+   static unsigned int thread_index();
+
+private:
+   Trace();
+
+   std::chrono::steady_clock::time_point _start_time;
+   mutable std::mutex _mutex;
+   std::vector<Event> _events;
+};
+
+// records the time and the bytes allocated from its construction to its destruction
+class TraceScope {
+public:
+   explicit TraceScope(const char *name_);
+
+   ~TraceScope();
+
+   TraceScope(const TraceScope &) = delete;
+
+   TraceScope &operator=(const TraceScope &) = delete;
+
+   void set_rows(size_t rows, size_t nonzeros);
+
+private:
+   Trace::Event _event;
+   size_t _start_bytes;
+};
+
+// also records the rows and the nonzeros added to @p rows_
+template<typename Rows>
+class RowsTraceScope {
+public:
+   RowsTraceScope(const char *name_, const Rows &rows_) : _scope(name_), _rows{rows_},
+                                                          _start_rows{rows_.num_rows()},
+                                                          _start_nonzeros{rows_.num_nonzeros()} {}
+
+   ~RowsTraceScope() { _scope.set_rows(_rows.num_rows() - _start_rows, _rows.num_nonzeros() - _start_nonzeros); }
+
+private:
+   TraceScope _scope;
+   const Rows &_rows;
+   size_t _start_rows;
+   size_t _start_nonzeros;
+};
+
+// writes the Chrome trace of the process to @p path_ and the summary to @p summary_stream_ when it is destroyed,
+// usually at the end of main. Does nothing if the path is empty or the build has no trace
+class TraceFile {
+public:
+   TraceFile(std::string path_, std::ostream &summary_stream_) : _path{std::move(path_)},
+                                                                 _summary_stream{summary_stream_} {}
+
+   ~TraceFile();
+
+   TraceFile(const TraceFile &) = delete;
+
+   TraceFile &operator=(const TraceFile &) = delete;
+
+private:
+   std::string _path;
+   std::ostream &_summary_stream;
+};
+
+#ifdef SCHEDULE_ENABLE_TRACE
+#define SCHEDULE_TRACE_JOIN_IMPL(first, second) first##second
+#define SCHEDULE_TRACE_JOIN(first, second) SCHEDULE_TRACE_JOIN_IMPL(first, second)
+#define TRACE_SCOPE(name) TraceScope SCHEDULE_TRACE_JOIN(trace_scope_, __LINE__)(name)
+#define TRACE_ROWS_SCOPE(name, rows) RowsTraceScope SCHEDULE_TRACE_JOIN(trace_scope_, __LINE__)(name, rows)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_ROWS_SCOPE(name, rows)
+#endif
+
+
+#endif //SCHEDULE_HIGHSCHOOL_TRACE_H
@@ -0,0 +1,449 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "Presolve.h"
+#include "Trace.h"
+#include "Two_Stage.h"
+
+namespace {
+   constexpr double INF = std::numeric_limits<double>::infinity();
+
+   // solves @p model, presolved, from @p start if it is not empty, and gives the values of its columns
+   BB_Solver::Result solve_model(const MIP_Model &model, BB_Solver::Options options,
+                                 const std::vector<double> &start = {}) {
+      Presolve presolve(model);
+      if (presolve.is_infeasible()) {
+         BB_Solver::Result result;
+         result.status = BB_Solver::Infeasible;
+         return result;
+      }
+      if (not options.branching_priority.empty()) {
+         options.branching_priority = presolve.reduce_columns(options.branching_priority);
+      }
+      BB_Solver solver(presolve.get_model(), options);
+      if (not start.empty()) {
+         solver.set_incumbent(presolve.reduce(start));
+      }
+      BB_Solver::Result result = solver.solve();
+      if (result.has_solution()) {
+         result.values = presolve.postsolve(result.values);
+      }
+      return result;
+   }
+}
+
+TwoStageSolver::TwoStageSolver(const Input &input_, Options options_) : _input{input_}, _options{options_},
+                                                                        _occupancy(input_), _schedule(input_) {
+   build_day_assignment();
+}
+
+void TwoStageSolver::build_day_assignment() {
+   TRACE_ROWS_SCOPE("TwoStageSolver::build_day_assignment", _assignment.constraints);
+   ConstraintMatrix &rows = _assignment.constraints;
+   _one_lesson.resize(_input.num_requirements());
+   _two_lessons.resize(_input.num_requirements());
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      WeekMask allowed = _occupancy.teacher_available(_occupancy.teacher_of(req_idx)) &
+                         _occupancy.class_hours(_occupancy.class_of(req_idx));
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         WeekMask day_allowed = allowed & WeekMask::day_hours(day);
+         _one_lesson[req_idx][day] = _assignment.add_column(MIP_Model::Binary, 0.0, 0.0,
+                                                            day_allowed.empty() ? 0.0 : 1.0);
+         _two_lessons[req_idx][day] = _assignment.add_column(MIP_Model::Binary, 0.0, 0.0,
+                                                             day_allowed.pair_starts().empty() ? 0.0 : 1.0);
+         // a second lesson needs a first one
+         rows.begin_row(ConstraintSink::Leq, 0.0);
+         rows.add_entry(_two_lessons[req_idx][day], 1.0);
+         rows.add_entry(_one_lesson[req_idx][day], -1.0);
+         rows.end_row();
+      }
+   }
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      const Input::Requirement &requirement = _input.get_requirements()[req_idx];
+      rows.begin_row(ConstraintSink::Eq, requirement.num_lessons());
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         rows.add_entry(_one_lesson[req_idx][day], 1.0);
+         rows.add_entry(_two_lessons[req_idx][day], 1.0);
+      }
+      rows.end_row();
+      if (requirement.num_days_with_cons_hours != 0) {
+         rows.begin_row(ConstraintSink::Geq, requirement.num_days_with_cons_hours);
+         for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+            rows.add_entry(_two_lessons[req_idx][day], 1.0);
+         }
+         rows.end_row();
+      }
+   }
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      const Input::Class &school_class = _input.get_classes()[class_idx];
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         rows.begin_row(ConstraintSink::Eq, school_class.num_hours_per_day[day]);
+         for (unsigned int req_idx: school_class.requirements) {
+            rows.add_entry(_one_lesson[req_idx][day], 1.0);
+            rows.add_entry(_two_lessons[req_idx][day], 1.0);
+         }
+         rows.end_row();
+      }
+   }
+   for (unsigned int teacher_idx = 0; teacher_idx != _input.num_teachers(); ++teacher_idx) {
+      const Input::Teacher &teacher = _input.get_teachers()[teacher_idx];
+      WeekMask hours;
+      for (unsigned int req_idx: teacher.requirements) {
+         hours |= _occupancy.class_hours(_occupancy.class_of(req_idx));
+      }
+      hours &= _occupancy.teacher_available(teacher_idx);
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         // the classes begin at the first hour, so their lessons before an hour fit in the hours of the teacher
+         // before it: one row for every hour at which the day of one of its classes ends
+         WeekMask day_hours = WeekMask::day_hours(day);
+         for (unsigned int end = 1; end <= WeekShape::NUM_HOURS_PER_DAY[day]; ++end) {
+            WeekMask before(((uint64_t(1) << end) - 1) << WeekShape::DAY_BEGIN[day]);
+            bool class_ends = false;
+            for (unsigned int req_idx: teacher.requirements) {
+               WeekMask class_day = _occupancy.class_hours(_occupancy.class_of(req_idx)) & day_hours;
+               class_ends = class_ends or (not class_day.empty() and class_day.count() == end);
+            }
+            if (not class_ends) {
+               continue;
+            }
+            rows.begin_row(ConstraintSink::Leq, (hours & before).count());
+            for (unsigned int req_idx: teacher.requirements) {
+               if ((_occupancy.class_hours(_occupancy.class_of(req_idx)) & day_hours & ~before).empty()) {
+                  rows.add_entry(_one_lesson[req_idx][day], 1.0);
+                  rows.add_entry(_two_lessons[req_idx][day], 1.0);
+               }
+            }
+            rows.end_row();
+         }
+      }
+   }
+   // the day weights and the sorted ones of every class, as create_day_weight_constraints and
+   // create_day_weight_sorted_constraints, with the objective of LP_Provider
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      DayArray<VarID> &weight = _day_weight.emplace_back();
+      DayArray<VarID> &sorted_weight = _sorted_day_weight.emplace_back();
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         weight[day] = _assignment.add_column(MIP_Model::Continuous, 0.0, 0.0, INF);
+         sorted_weight[day] = _assignment.add_column(
+               MIP_Model::Continuous, std::max(1 - double(day) / (WeekShape::NUM_DAYS - 1), 0.0), 0.0, INF);
+         rows.begin_row(ConstraintSink::Eq, 0.0);
+         rows.add_entry(weight[day], 1.0);
+         for (unsigned int req_idx: _input.get_classes()[class_idx].requirements) {
+            double lesson_weight = _input.get_requirements()[req_idx].average_lesson_weight;
+            rows.add_entry(_one_lesson[req_idx][day], -lesson_weight);
+            rows.add_entry(_two_lessons[req_idx][day], -lesson_weight);
+         }
+         rows.end_row();
+      }
+      for (unsigned int subset = 1; subset != 1u << WeekShape::NUM_DAYS; ++subset) {
+         rows.begin_row(ConstraintSink::Geq, 0.0);
+         for (unsigned int sorted_day = 0; sorted_day != unsigned(__builtin_popcount(subset)); ++sorted_day) {
+            rows.add_entry(sorted_weight[sorted_day], 1.0);
+         }
+         for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+            if ((subset >> day) & 1u) {
+               rows.add_entry(weight[day], -1.0);
+            }
+         }
+         rows.end_row();
+      }
+   }
+}
+
+bool TwoStageSolver::set_start(const Schedule &schedule) {
+   std::vector<double> start(_assignment.num_columns(), 0.0);
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      DayArray<double> weights{};
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+            unsigned int req_idx = schedule.get_lesson(class_idx, day, hour);
+            if (req_idx == Schedule::NoLesson) {
+               continue;
+            }
+            // a third lesson leaves the start infeasible
+            double &column = start[_one_lesson[req_idx][day]] == 0.0 ? start[_one_lesson[req_idx][day]]
+                                                                       : start[_two_lessons[req_idx][day]];
+            column += 1.0;
+            weights[day] += _input.get_requirements()[req_idx].average_lesson_weight;
+         }
+         start[_day_weight[class_idx][day]] = weights[day];
+      }
+      std::sort(weights.begin(), weights.end(), std::greater<>());
+      for (unsigned int sorted_day = 0; sorted_day != WeekShape::NUM_DAYS; ++sorted_day) {
+         start[_sorted_day_weight[class_idx][sorted_day]] = weights[sorted_day];
+      }
+   }
+   if (not _assignment.is_feasible(start)) {
+      return false;
+   }
+   _start = std::move(start);
+   return true;
+}
+
+TwoStageSolver::Result TwoStageSolver::solve() {
+   TRACE_SCOPE("TwoStageSolver::solve");
+   auto start_time = std::chrono::steady_clock::now();
+   Result result;
+   // without the proof that a day cannot be placed, a cut may remove solutions, and so may the days after it
+   bool cuts_are_exact = true;
+   while (result.num_rounds != _options.max_rounds) {
+      ++result.num_rounds;
+      BB_Solver::Status assignment_status = assign_days(result.day_weight_objective);
+      if (assignment_status == BB_Solver::Infeasible and cuts_are_exact) {
+         result.status = BB_Solver::Infeasible;
+      }
+      if (assignment_status != BB_Solver::Optimal and assignment_status != BB_Solver::Feasible) {
+         break;
+      }
+
+      for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+         for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+            for (unsigned int hour = 0; hour != WeekShape::NUM_HOURS_PER_DAY[day]; ++hour) {
+               _schedule.set_lesson(class_idx, day, hour, Schedule::NoLesson);
+            }
+         }
+      }
+      DayArray<BB_Solver::Status> day_status{};
+      DayArray<double> day_objective{};
+      std::atomic<unsigned int> next_day{0};
+      auto place_days = [&]() {
+         for (unsigned int day = next_day++; day < WeekShape::NUM_DAYS; day = next_day++) {
+            day_status[day] = place_day(day, day_objective[day]);
+         }
+      };
+      std::vector<std::thread> threads;
+      unsigned int num_threads = std::min(_options.num_threads, WeekShape::NUM_DAYS);
+      for (unsigned int thread_idx = 1; thread_idx < num_threads; ++thread_idx) {
+         threads.emplace_back(place_days);
+      }
+      place_days();
+      for (std::thread &thread: threads) {
+         thread.join();
+      }
+
+      bool placed = true;
+      bool has_cuts = true;
+      result.in_school_objective = 0.0;
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         if (day_status[day] == BB_Solver::Optimal or day_status[day] == BB_Solver::Feasible) {
+            result.in_school_objective += day_objective[day];
+            continue;
+         }
+         placed = false;
+         cuts_are_exact = cuts_are_exact and day_status[day] == BB_Solver::Infeasible;
+         if (add_day_cut(day)) {
+            ++result.num_cuts;
+         } else {
+            has_cuts = false;
+         }
+      }
+      if (not has_cuts) {
+         // the first stage would give the same days again
+         break;
+      }
+      if (placed) {
+         result.status = BB_Solver::Feasible;
+         result.objective = result.day_weight_objective + result.in_school_objective;
+         break;
+      }
+   }
+   result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+   return result;
+}
+
+BB_Solver::Status TwoStageSolver::assign_days(double &objective) {
+   TRACE_SCOPE("TwoStageSolver::assign_days");
+   BB_Solver::Options options;
+   options.time_limit = _options.time_limit;
+   options.num_threads = _options.num_threads;
+   // a cut may have removed the start, which is then ignored
+   BB_Solver::Result result = solve_model(_assignment, options, _start);
+   if (not result.has_solution()) {
+      return result.status;
+   }
+   objective = result.objective;
+   _num_lessons.assign(_input.num_requirements(), DayArray<unsigned int>{});
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         _num_lessons[req_idx][day] = unsigned(std::lround(result.values[_one_lesson[req_idx][day]]) +
+                                               std::lround(result.values[_two_lessons[req_idx][day]]));
+      }
+   }
+   return result.status;
+}
+
+BB_Solver::Status TwoStageSolver::place_day(unsigned int day, double &objective) {
+   TRACE_SCOPE("TwoStageSolver::place_day");
+   unsigned int num_hours = WeekShape::NUM_HOURS_PER_DAY[day];
+   MIP_Model model;
+   ConstraintMatrix &rows = model.constraints;
+   // the lesson columns of every requirement with lessons on the day, by hour
+   struct Lesson {
+      unsigned int req_idx;
+      unsigned int hour;
+      VarID col;
+   };
+   std::vector<Lesson> lessons;
+   std::vector<std::vector<size_t>> class_lessons(_input.num_classes());  // positions in lessons
+   std::vector<std::vector<size_t>> teacher_lessons(_input.num_teachers());
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      unsigned int num_lessons = _num_lessons[req_idx][day];
+      if (num_lessons == 0) {
+         continue;
+      }
+      WeekMask allowed = _occupancy.teacher_available(_occupancy.teacher_of(req_idx)) &
+                         _occupancy.class_hours(_occupancy.class_of(req_idx)) & WeekMask::day_hours(day);
+      size_t first_lesson = lessons.size();
+      rows.begin_row(ConstraintSink::Eq, num_lessons);
+      for (WeekMask remaining = allowed; not remaining.empty();) {
+         unsigned int hour = remaining.pop_lowest() - WeekShape::DAY_BEGIN[day];
+         VarID col = model.add_column(MIP_Model::Binary, 0.0, 0.0, 1.0);
+         rows.add_entry(col, 1.0);
+         class_lessons[_occupancy.class_of(req_idx)].push_back(lessons.size());
+         teacher_lessons[_occupancy.teacher_of(req_idx)].push_back(lessons.size());
+         lessons.push_back(Lesson{req_idx, hour, col});
+      }
+      rows.end_row();
+      if (num_lessons == 2) {
+         // as prevent_non_consecutive_hours
+         for (size_t first = first_lesson; first != lessons.size(); ++first) {
+            for (size_t second = first + 1; second != lessons.size(); ++second) {
+               if (lessons[second].hour >= lessons[first].hour + 2) {
+                  rows.begin_row(ConstraintSink::Leq, 1.0);
+                  rows.add_entry(lessons[first].col, 1.0);
+                  rows.add_entry(lessons[second].col, 1.0);
+                  rows.end_row();
+               }
+            }
+         }
+      }
+   }
+   bool has_class_hours = false;
+   for (unsigned int class_idx = 0; class_idx != _input.num_classes(); ++class_idx) {
+      for (unsigned int hour = 0; hour != _input.get_classes()[class_idx].num_hours_per_day[day]; ++hour) {
+         has_class_hours = true;
+         rows.begin_row(ConstraintSink::Eq, 1.0);
+         for (size_t lesson_pos: class_lessons[class_idx]) {
+            if (lessons[lesson_pos].hour == hour) {
+               rows.add_entry(lessons[lesson_pos].col, 1.0);
+            }
+         }
+         rows.end_row();
+      }
+   }
+   // at most one lesson at a time, and the hours in school as create_teacher_is_in_school_compact_constraints
+   for (unsigned int teacher_idx = 0; teacher_idx != _input.num_teachers(); ++teacher_idx) {
+      if (teacher_lessons[teacher_idx].empty()) {
+         continue;
+      }
+      const Input::Teacher &teacher = _input.get_teachers()[teacher_idx];
+      VarID begun = model.num_columns();
+      for (unsigned int hour = 0; hour != num_hours; ++hour) {
+         model.add_column(MIP_Model::Continuous, 0.0, 0.0, INF);
+      }
+      VarID not_over = model.num_columns();
+      for (unsigned int hour = 0; hour != num_hours; ++hour) {
+         model.add_column(MIP_Model::Continuous, 0.0, 0.0, INF);
+      }
+      for (unsigned int hour = 0; hour != num_hours; ++hour) {
+         bool available = teacher.is_available(day, hour);
+         VarID in_school = model.add_column(MIP_Model::Continuous, available ? teacher.penalties(day, hour) : 0.0,
+                                            0.0, available ? INF : 0.0);
+         rows.begin_row(ConstraintSink::Leq, 1.0);
+         for (size_t lesson_pos: teacher_lessons[teacher_idx]) {
+            if (lessons[lesson_pos].hour == hour) {
+               rows.add_entry(lessons[lesson_pos].col, 1.0);
+            }
+         }
+         rows.end_row();
+         for (VarID bound: {begun, not_over}) {
+            rows.begin_row(ConstraintSink::Geq, 0.0);
+            rows.add_entry(bound + hour, 1.0);
+            for (size_t lesson_pos: teacher_lessons[teacher_idx]) {
+               if (lessons[lesson_pos].hour == hour) {
+                  rows.add_entry(lessons[lesson_pos].col, -1.0);
+               }
+            }
+            rows.end_row();
+         }
+         if (hour != 0) {
+            rows.begin_row(ConstraintSink::Geq, 0.0);
+            rows.add_entry(begun + hour, 1.0);
+            rows.add_entry(begun + hour - 1, -1.0);
+            rows.end_row();
+         }
+         if (hour + 1 != num_hours) {
+            rows.begin_row(ConstraintSink::Geq, 0.0);
+            rows.add_entry(not_over + hour, 1.0);
+            rows.add_entry(not_over + hour + 1, -1.0);
+            rows.end_row();
+         }
+         rows.begin_row(ConstraintSink::Geq, -1.0);
+         rows.add_entry(in_school, 1.0);
+         rows.add_entry(begun + hour, -1.0);
+         rows.add_entry(not_over + hour, -1.0);
+         rows.end_row();
+      }
+   }
+
+   if (lessons.empty() and not has_class_hours) {
+      // a day off for the whole school: nothing to place
+      objective = 0.0;
+      return BB_Solver::Optimal;
+   }
+
+   BB_Solver::Options options;
+   options.time_limit = _options.time_limit;
+   BB_Solver::Result result = solve_model(model, options);
+   if (not result.has_solution()) {
+      return result.status;
+   }
+   objective = result.objective;
+   // every day writes its own hours of the schedule
+   for (const Lesson &lesson: lessons) {
+      if (result.values[lesson.col] > 0.5) {
+         _schedule.set_lesson(_occupancy.class_of(lesson.req_idx), day, lesson.hour, lesson.req_idx);
+      }
+   }
+   return result.status;
+}
+
+bool TwoStageSolver::add_day_cut(unsigned int day) {
+   // at least one of the columns of the day changes value: those at 1 sum to less than their number, or one of
+   // those at 0 that can be 1 is 1
+   double num_ones = 0.0;
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      num_ones += _num_lessons[req_idx][day];
+   }
+   std::vector<VarIdxCoeffPair> entries;
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      unsigned int num_lessons = _num_lessons[req_idx][day];
+      VarID one_lesson = _one_lesson[req_idx][day];
+      VarID two_lessons = _two_lessons[req_idx][day];
+      if (num_lessons >= 1 or _assignment.upper[one_lesson] != 0.0) {
+         entries.push_back(VarIdxCoeffPair{one_lesson, num_lessons >= 1 ? -1.0 : 1.0});
+      }
+      if (num_lessons == 2 or _assignment.upper[two_lessons] != 0.0) {
+         entries.push_back(VarIdxCoeffPair{two_lessons, num_lessons == 2 ? -1.0 : 1.0});
+      }
+   }
+   if (entries.empty()) {
+      // no column of the day can change: the row would be 0 >= 1
+      return false;
+   }
+   ConstraintMatrix &rows = _assignment.constraints;
+   rows.begin_row(ConstraintSink::Geq, 1.0 - num_ones);
+   for (VarIdxCoeffPair entry: entries) {
+      rows.add_entry(entry.var_idx, entry.coeff);
+   }
+   rows.end_row();
+   return true;
+}
@@ -0,0 +1,90 @@
+#ifndef SCHEDULE_HIGHSCHOOL_TWO_STAGE_H
+#define SCHEDULE_HIGHSCHOOL_TWO_STAGE_H
+
+#include <limits>
+#include <vector>
+#include "BB_Solver.h"
+#include "Input.h"
+#include "MIP_Model.h"
+#include "Occupancy.h"
+#include "Schedule.h"
+
+// A schedule in two stages, for inputs too large for the model of LP_Provider.
+// The first stage chooses how many lessons, none, one or two, every requirement has on every day: all its lessons,
+// at least num_days_with_cons_hours days with two, the hours of every class on every day, no more lessons for a
+// teacher before an hour than the hours at which it can teach before it, and the balance of the sorted day weights
+// as objective.
+// The second stage places the lessons of each day at its hours, in a small model of its own with the penalties of
+// the hours in school as objective; the days are independent, and solved in parallel. A day that cannot be placed
+// sends back a cut that forbids its lessons in the first stage, which is then solved again.
+// The two objectives add up to the objective of LP_Provider, but the first stage does not see the second one, so the
+// schedule is good rather than optimal
+class TwoStageSolver {
+public:
+   typedef MIP_Model::VarID VarID;
+
+   struct Options {
+      double time_limit;  // in seconds, for every solve of the first stage and for every day
+      unsigned int max_rounds;  // solves of the first stage
+      unsigned int num_threads;  // for the first stage, and days placed at once
+
+      Options() : time_limit{std::numeric_limits<double>::infinity()}, max_rounds{20}, num_threads{1} {}
+   };
+
+   struct Result {
+      // Feasible with a schedule, Infeasible if the first stage has no solution, NoSolution if the rounds or the time
+      // ran out
+      BB_Solver::Status status;
+      double objective;  // as in the model of LP_Provider: the sum of the next two
+      double day_weight_objective;
+      double in_school_objective;
+      unsigned int num_rounds;
+      size_t num_cuts;  // from the days that could not be placed
+      double seconds;
+
+      Result() : status{BB_Solver::NoSolution}, objective{0.0}, day_weight_objective{0.0}, in_school_objective{0.0},
+                 num_rounds{0}, num_cuts{0}, seconds{0.0} {}
+   };
+
+   explicit TwoStageSolver(const Input &input_, Options options_ = Options());
+
+   // starts the first stage from the days of the lessons of @p schedule, for example from a tabu search: its days
+   // can be placed, so unless the rounds or the time limit of a day run out, solve() finds a schedule with no more
+   // day weights than it. Returns false (and ignores it) if the lessons do not fit the first stage
+   bool set_start(const Schedule &schedule);
+
+   Result solve();
+
+   // the schedule of the last solve(), complete if it was Feasible
+   [[nodiscard]] const Schedule &get_schedule() const { return _schedule; }
+
+private:
+   // the model of the first stage: a lesson and a second lesson of every requirement on every day, and the day
+   // weights of every class, sorted as in LP_Provider
+   void build_day_assignment();
+
+   // solves the first stage into _num_lessons, and its objective into @p objective
+   BB_Solver::Status assign_days(double &objective);
+
+   // places the lessons of @p day in _schedule, and the penalties of the teachers into @p objective
+   BB_Solver::Status place_day(unsigned int day, double &objective);
+
+   // forbids the lessons of @p day, from the last assign_days(), in the first stage. Returns false, and adds
+   // nothing, if no column of the day can change
+   bool add_day_cut(unsigned int day);
+
+   const Input &_input;
+   Options _options;
+   Occupancy _occupancy;  // for the hours at which every requirement can have a lesson
+   MIP_Model _assignment;
+   std::vector<DayArray<VarID>> _one_lesson;  // _one_lesson[requirement][day], the column
+   std::vector<DayArray<VarID>> _two_lessons;
+   std::vector<DayArray<VarID>> _day_weight;  // _day_weight[class][day]
+   std::vector<DayArray<VarID>> _sorted_day_weight;
+   std::vector<double> _start;  // the columns of _assignment from set_start(), or empty
+   std::vector<DayArray<unsigned int>> _num_lessons;  // from the first stage
+   Schedule _schedule;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_TWO_STAGE_H
@@ -2,143 +2,180 @@
 // Created by mich on 16/07/19.
 //
 
+#include <algorithm>
+#include <cstdio>
+#include "Trace.h"
 #include "Variables.h"
 
-Variables::Variables(const Input &input_) :
-      _input{input_}, _num_01_var{0},
-      _teacher_has_lesson_var(_input.num_teachers(), std::vector<std::vector<VarID>>(Input::NUM_DAYS_PER_WEEK)),
-      _teacher_is_in_school_var(_input.num_teachers(), std::vector<std::vector<VarID>>(Input::NUM_DAYS_PER_WEEK)),
-      _requirement_var(_input.num_requirements(), std::vector<std::vector<VarID>>(Input::NUM_DAYS_PER_WEEK)),
-      _requirement_var_per_class(_input.num_classes(),
-                                 std::vector<std::vector<std::vector<VarID>>>(Input::NUM_DAYS_PER_WEEK)),
-      _requirement_var_per_teacher(_input.num_teachers(),
-                                   std::vector<std::vector<std::vector<VarID>>>(Input::NUM_DAYS_PER_WEEK)),
-      _requirement_cons_var_from_hour(_input.num_requirements(),
-                                      std::vector<std::vector<VarID>>(Input::NUM_DAYS_PER_WEEK)),
-      _day_weight_for_class(_input.num_classes(), std::vector<VarID>(Input::NUM_DAYS_PER_WEEK, InvalidVarID)),
-      _day_weight_for_class_sorted(_input.num_classes(), std::vector<VarID>(Input::NUM_DAYS_PER_WEEK, InvalidVarID)) {
-   reserve_containers_space();
-   create_teacher_has_lesson_var();
-   create_teacher_is_in_school_var();
-   create_requirement_var();
-   create_requirement_cons_var_from_hour();
-   _num_01_var = num_var();
-   create_day_weight_for_class();
-   create_day_weight_for_class_sorted();
+namespace {
+   // the variable at position @p slot among those of a holder, whose days begin at @p day_begin
+   Variables::Variable slot_variable(Variables::VarID var_idx, Input::ID holder_id, unsigned int slot,
+                                     const std::array<unsigned int, WeekShape::NUM_DAYS + 1> &day_begin) {
+      unsigned int day = 0;
+      while (day_begin[day + 1] <= slot) {
+         ++day;
+      }
+      return Variables::Variable(var_idx, holder_id, day, slot - day_begin[day]);
+   }
 }
 
-const Variables::Variable &Variables::get_variable(size_t var_idx) const {
-   if (var_idx >= num_var()) {
-      throw std::logic_error("Call to Variables::get_variable out of range");
+Variables::Variables(const Input &input_, ModelOptions options_) :
+      _input{input_}, _options{options_}, _num_01_var{0}, _lesson_slots(_input.num_requirements()),
+      _requirement_begin(_input.num_requirements() + 1, 0), _pair_slots(_input.num_requirements()),
+      _cons_begin(_input.num_requirements() + 1, 0) {
+   TRACE_SCOPE("Variables");
+   // a lesson at an hour when the teacher is unavailable or the class is not at school is forced to 0, so it has no
+   // variable at all
+   for (unsigned int req_idx = 0; req_idx != _input.num_requirements(); ++req_idx) {
+      const Input::Requirement &requirement = _input.get_requirements()[req_idx];
+      const Input::Teacher &teacher = *_input.find_teacher(requirement.teacher_id());
+      const Input::Class &school_class = *_input.find_class(requirement.class_id());
+      WeekMask &lesson_slots = _lesson_slots[req_idx];
+      for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+         for (unsigned int hour = 0; hour != school_class.num_hours_per_day[day]; ++hour) {
+            if (teacher.is_available(day, hour)) {
+               lesson_slots.set(WeekShape::slot(day, hour));
+            }
+         }
+      }
+      if (requirement.num_days_with_cons_hours != 0) {
+         _pair_slots[req_idx] = lesson_slots.pair_starts();
+      }
+      _requirement_begin[req_idx + 1] = _requirement_begin[req_idx] + lesson_slots.count();
+      _cons_begin[req_idx + 1] = _cons_begin[req_idx] + _pair_slots[req_idx].count();
+   }
+   VarID num_teachers = _input.num_teachers();
+   VarID num_classes = _input.num_classes();
+   VarID num_requirements = _input.num_requirements();
+   bool compact_in_school = _options.in_school == ModelOptions::CompactInSchool;
+   bool k_sum = _options.day_weight == ModelOptions::KSumDayWeight;
+   bool block_start = _options.contiguity == ModelOptions::BlockStartContiguity;
+   std::array<VarID, NUM_FAMILIES> family_size{};
+   family_size[TeacherHasLesson] = num_teachers * WeekShape::NUM_SLOTS;
+   family_size[TeacherIsInSchool] = num_teachers * WeekShape::NUM_SLOTS;
+   family_size[Requirement] = _requirement_begin.back();
+   family_size[RequirementConsHour] = _cons_begin.back();
+   family_size[DayWeight] = num_classes * NUM_DAYS;
+   family_size[DayWeightSorted] = num_classes * NUM_DAYS;
+   family_size[TeacherLessonsBegun] = compact_in_school ? num_teachers * WeekShape::NUM_SLOTS : 0;
+   family_size[TeacherLessonsNotOver] = compact_in_school ? num_teachers * WeekShape::NUM_SLOTS : 0;
+   family_size[DayWeightThreshold] = k_sum ? num_classes * NUM_DAYS : 0;
+   family_size[DayWeightExcess] = k_sum ? num_classes * NUM_DAYS * NUM_DAYS : 0;
+   family_size[RequirementBlockStart] = block_start ? num_requirements * BLOCK_DAY_BEGIN[NUM_DAYS] : 0;
+   _family_begin[0] = 0;
+   for (unsigned int family = 0; family != NUM_FAMILIES; ++family) {
+      _family_begin[family + 1] = _family_begin[family] + family_size[family];
    }
-   return _variables[var_idx];
+   _num_01_var = _family_begin[DayWeight];
 }
 
-void Variables::reserve_containers_space() {
-   for (auto &teacher_matr: _teacher_has_lesson_var) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         teacher_matr[day].resize(Input::NUM_HOURS_PER_DAY[day], InvalidVarID);
+Variables::Variable Variables::get_variable(VarID var_idx) const {
+   VarID offset = var_idx - _family_begin[get_family(var_idx)];
+   switch (get_family(var_idx)) {
+      case TeacherHasLesson:
+      case TeacherIsInSchool:
+      case TeacherLessonsBegun:
+      case TeacherLessonsNotOver: {
+         return slot_variable(var_idx, offset / WeekShape::NUM_SLOTS, offset % WeekShape::NUM_SLOTS,
+                              WeekShape::DAY_BEGIN);
       }
-   }
-   for (auto &teacher_matr: _teacher_is_in_school_var) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         teacher_matr[day].resize(Input::NUM_HOURS_PER_DAY[day], InvalidVarID);
+      case Requirement: {
+         unsigned int req_idx = sparse_holder(_requirement_begin, offset);
+         return slot_variable(var_idx, req_idx, _lesson_slots[req_idx].select(offset - _requirement_begin[req_idx]),
+                              WeekShape::DAY_BEGIN);
       }
-   }
-   for (auto &req_matr: _requirement_var) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         req_matr[day].resize(Input::NUM_HOURS_PER_DAY[day], InvalidVarID);
+      case RequirementConsHour: {
+         unsigned int req_idx = sparse_holder(_cons_begin, offset);
+         return slot_variable(var_idx, req_idx, _pair_slots[req_idx].select(offset - _cons_begin[req_idx]),
+                              WeekShape::DAY_BEGIN);
       }
-   }
-   for (auto &class_matr: _requirement_var_per_class) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         class_matr[day].resize(Input::NUM_HOURS_PER_DAY[day]);
+      case RequirementBlockStart: {
+         return slot_variable(var_idx, offset / BLOCK_DAY_BEGIN[NUM_DAYS], offset % BLOCK_DAY_BEGIN[NUM_DAYS],
+                              BLOCK_DAY_BEGIN);
       }
-   }
-   for (auto &teacher_matr: _requirement_var_per_teacher) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         teacher_matr[day].resize(Input::NUM_HOURS_PER_DAY[day]);
+      case DayWeight:
+      case DayWeightSorted:
+      case DayWeightThreshold: {
+         return Variable(var_idx, offset / NUM_DAYS, offset % NUM_DAYS);
       }
-   }
-   for (auto &req_matr: _requirement_cons_var_from_hour) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         req_matr[day].resize(Input::NUM_HOURS_PER_DAY[day] - 1, InvalidVarID);
+      case DayWeightExcess: {
+         // the hour of the variable is the day it refers to, and its day is k
+         return Variable(var_idx, offset / (NUM_DAYS * NUM_DAYS), offset / NUM_DAYS % NUM_DAYS, offset % NUM_DAYS);
       }
-   }
-}
-
-void Variables::create_teacher_has_lesson_var() {
-   for (unsigned int teacher_id = 0; teacher_id != _input.num_teachers(); ++teacher_id) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
-            VarID var_id = num_var();
-            _teacher_has_lesson_var[teacher_id][day][hour] = var_id;
-            _variables.emplace_back(var_id, teacher_id, day, hour);
-         }
+      default: {
+         throw std::logic_error("Variable without family");
       }
    }
 }
 
-void Variables::create_teacher_is_in_school_var() {
-   for (unsigned int teacher_id = 0; teacher_id != _input.num_teachers(); ++teacher_id) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
-            VarID var_id = num_var();
-            _teacher_is_in_school_var[teacher_id][day][hour] = var_id;
-            _variables.emplace_back(var_id, teacher_id, day, hour);
-         }
-      }
-   }
+unsigned int Variables::sparse_holder(const std::vector<VarID> &holder_begin, VarID offset) {
+   // the last holder that begins at or before offset: the holders before it without variables begin there too
+   return std::upper_bound(holder_begin.begin(), holder_begin.end(), offset) - holder_begin.begin() - 1;
 }
 
-void Variables::create_requirement_var() {
-   for (unsigned int requirement_id = 0; requirement_id != _input.num_requirements(); ++requirement_id) {
-      const Input::Requirement &requirement = _input.get_requirements()[requirement_id];
-      VarID class_id = _input.convert_from_class_id(requirement.class_id());
-      VarID teacher_id = _input.convert_from_teacher_id(requirement.teacher_id());
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day]; ++hour) {
-            VarID var_id = num_var();
-            _variables.emplace_back(var_id, requirement_id, day, hour);
-            _requirement_var[requirement_id][day][hour] = var_id;
-            _requirement_var_per_class[class_id][day][hour].emplace_back(var_id);
-            _requirement_var_per_teacher[teacher_id][day][hour].emplace_back(var_id);
-         }
-      }
+Variables::Family Variables::get_family(VarID var_idx) const {
+   if (var_idx >= num_var()) {
+      throw std::logic_error("Call to Variables::get_family out of range");
    }
-}
-
-void Variables::create_requirement_cons_var_from_hour() {
-   for (unsigned int requirement_id = 0; requirement_id != _input.num_requirements(); ++requirement_id) {
-      if (_input.get_requirements()[requirement_id].num_days_with_cons_hours == 0) {
-         continue;
-      }
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         for (unsigned int hour = 0; hour != Input::NUM_HOURS_PER_DAY[day] - 1; ++hour) {
-            VarID var_id = num_var();
-            _requirement_cons_var_from_hour[requirement_id][day][hour] = var_id;
-            _variables.emplace_back(var_id, requirement_id, day, hour);
-         }
-      }
+   unsigned int family = 0;
+   while (_family_begin[family + 1] <= var_idx) {
+      ++family;
    }
+   return static_cast<Family>(family);
 }
 
-void Variables::create_day_weight_for_class() {
-   for (unsigned int class_id = 0; class_id != _input.num_classes(); ++class_id) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         VarID var_id = num_var();
-         _day_weight_for_class[class_id][day] = var_id;
-         _variables.emplace_back(var_id, class_id, day);
+size_t Variables::format_var_name(VarID var_idx, char *buffer) const {
+   Variable variable = get_variable(var_idx);
+   int length = 0;
+   switch (get_family(var_idx)) {
+      case TeacherHasLesson: {
+         length = std::snprintf(buffer, MAX_VAR_NAME_LENGTH + 1, "has_T%d_d%u_h%u",
+                                _input.get_teachers()[variable.holder_id].id / Input::MAX_ID, variable.hour.week_day,
+                                variable.hour.hour);
+         break;
       }
-   }
-}
-
-void Variables::create_day_weight_for_class_sorted() {
-   for (unsigned int class_id = 0; class_id != _input.num_classes(); ++class_id) {
-      for (unsigned int day = 0; day != Input::NUM_DAYS_PER_WEEK; ++day) {
-         VarID var_id = num_var();
-         _day_weight_for_class_sorted[class_id][day] = var_id;
-         _variables.emplace_back(var_id, class_id, day);
+      case TeacherIsInSchool:
+      case TeacherLessonsBegun:
+      case TeacherLessonsNotOver: {
+         const char *prefix = get_family(var_idx) == TeacherIsInSchool ? "in" :
+                              get_family(var_idx) == TeacherLessonsBegun ? "begun" : "notover";
+         length = std::snprintf(buffer, MAX_VAR_NAME_LENGTH + 1, "%s_T%d_d%u_h%u", prefix,
+                                _input.get_teachers()[variable.holder_id].id / Input::MAX_ID, variable.hour.week_day,
+                                variable.hour.hour);
+         break;
+      }
+      case Requirement:
+      case RequirementConsHour:
+      case RequirementBlockStart: {
+         const Input::Requirement &requirement = _input.get_requirements()[variable.holder_id];
+         const char *prefix = get_family(var_idx) == Requirement ? "x" :
+                              get_family(var_idx) == RequirementConsHour ? "pair" : "blk";
+         length = std::snprintf(buffer, MAX_VAR_NAME_LENGTH + 1, "%s_T%d_C%d_d%u_h%u", prefix,
+                                requirement.teacher_id() / Input::MAX_ID, requirement.class_id(),
+                                variable.hour.week_day, variable.hour.hour);
+         break;
+      }
+      case DayWeight: {
+         length = std::snprintf(buffer, MAX_VAR_NAME_LENGTH + 1, "w_C%d_d%u",
+                                _input.get_classes()[variable.holder_id].id, variable.hour.week_day);
+         break;
+      }
+      case DayWeightSorted:
+      case DayWeightThreshold: {
+         length = std::snprintf(buffer, MAX_VAR_NAME_LENGTH + 1, "%s_C%d_k%u",
+                                get_family(var_idx) == DayWeightSorted ? "ws" : "wt",
+                                _input.get_classes()[variable.holder_id].id, variable.hour.week_day);
+         break;
+      }
+      case DayWeightExcess: {
+         length = std::snprintf(buffer, MAX_VAR_NAME_LENGTH + 1, "wx_C%d_k%u_d%u",
+                                _input.get_classes()[variable.holder_id].id, variable.hour.week_day,
+                                variable.hour.hour);
+         break;
+      }
+      default: {
+         throw std::logic_error("Variable without family");
       }
    }
+   return std::min<size_t>(length, MAX_VAR_NAME_LENGTH);
 }
@@ -2,13 +2,27 @@
 #define SCHEDULE_HIGHSCHOOL_VARIABLES_H
 
 #include "Input.h"
+#include "Model_Options.h"
 
 class Variables {
 public:
    typedef size_t VarID;
    static constexpr VarID InvalidVarID = std::numeric_limits<VarID>::max();
 
-   explicit Variables(const Input &input_);
+   // the families of variables, in the order in which they are created. Those that a formulation does not use are
+   // empty
+   enum Family {
+      TeacherHasLesson, TeacherIsInSchool, Requirement, RequirementConsHour, DayWeight, DayWeightSorted,
+      TeacherLessonsBegun, TeacherLessonsNotOver, DayWeightThreshold, DayWeightExcess,
+      RequirementBlockStart, NUM_FAMILIES
+   };
+
+   // longest name written by format_var_name, terminating zero excluded
+   static constexpr size_t MAX_VAR_NAME_LENGTH = 48;
+
+   explicit Variables(const Input &input_, ModelOptions options_ = ModelOptions());
+
+   [[nodiscard]] const ModelOptions &get_options() const { return _options; }
 
    struct Variable {
       VarID var_id;
@@ -20,80 +34,132 @@ public:
             var_id{var_id_}, holder_id{holder_id_}, hour(day_, hour_) {}
    };
 
-   [[nodiscard]] const std::vector<Variable> &get_all_variables() const { return _variables; }
-
-   [[nodiscard]] VarID num_var() const { return _variables.size(); }
+   [[nodiscard]] VarID num_var() const { return _family_begin[NUM_FAMILIES]; }
 
    [[nodiscard]] VarID num_01_var() const { return _num_01_var; }
 
    [[nodiscard]] VarID num_lp_var() const { return num_var() - num_01_var(); }
 
-   [[nodiscard]] const Variable &get_variable(size_t var_idx) const;
-
-   [[nodiscard]] const std::vector<std::vector<std::vector<VarID>>> &
-   get_teacher_has_lesson_var() const { return _teacher_has_lesson_var; }
+   // the holder and the hour of a variable, computed from its position in the block of its family
+   [[nodiscard]] Variable get_variable(VarID var_idx) const;
 
-   [[nodiscard]] const std::vector<std::vector<std::vector<VarID>>> &
-   get_teacher_is_in_school_var() const { return _teacher_is_in_school_var; }
+   [[nodiscard]] Family get_family(VarID var_idx) const;
 
-   [[nodiscard]] const std::vector<std::vector<std::vector<VarID>>> &
-   get_requirement_var() const { return _requirement_var; }
+   [[nodiscard]] bool is_binary(VarID var_idx) const { return var_idx < num_01_var(); }
 
-   [[nodiscard]] const std::vector<std::vector<std::vector<std::vector<VarID>>>> &
-   get_requirement_var_per_class() const { return _requirement_var_per_class; }
+   // writes into @p buffer (of size at least MAX_VAR_NAME_LENGTH + 1) a readable name such as "x_T21_C37_d1_h3",
+   // made of the family, the input ids of teacher and/or class, the day and the hour. Returns the length of the name
+   size_t format_var_name(VarID var_idx, char *buffer) const;
 
-   [[nodiscard]] const std::vector<std::vector<std::vector<std::vector<VarID>>>> &
-   get_requirement_var_per_teacher() const { return _requirement_var_per_teacher; }
+   // The variables are not stored: every family is a block in which each holder (a teacher, a class or a
+   // requirement, by position in Input) has the same number of consecutive variables, so the id of a variable is
+   // computed from the holder, the day and the hour. Teachers and classes find their lessons through the positions
+   // in Teacher::requirements and Class::requirements
 
-   [[nodiscard]] const std::vector<std::vector<std::vector<VarID>>> &
-   get_requirement_cons_var_from_hour() const { return _requirement_cons_var_from_hour; }
+   // whether the teacher has a lesson at that hour
+   [[nodiscard]] VarID teacher_has_lesson_var(unsigned int teacher, unsigned int day, unsigned int hour) const {
+      return slot_var(TeacherHasLesson, teacher, day, hour);
+   }
 
-   [[nodiscard]] const std::vector<std::vector<VarID>> &
-   get_day_weight_for_class() const { return _day_weight_for_class; }
+   // whether the teacher has lessons before and after that hour in the same day
+   [[nodiscard]] VarID teacher_is_in_school_var(unsigned int teacher, unsigned int day, unsigned int hour) const {
+      return slot_var(TeacherIsInSchool, teacher, day, hour);
+   }
 
-   [[nodiscard]] const std::vector<std::vector<VarID>> &
-   get_day_weight_for_class_sorted() const { return _day_weight_for_class_sorted; }
-
-private:
-   void reserve_containers_space();
+   // the hours at which the requirement can have a lesson: its teacher is available and its class is at school.
+   // Only they have a requirement_var
+   [[nodiscard]] WeekMask get_lesson_slots(unsigned int req) const { return _lesson_slots[req]; }
 
-   void create_teacher_has_lesson_var();
+   // whether the requirement has a lesson at that hour. InvalidVarID if it cannot have one
+   [[nodiscard]] VarID requirement_var(unsigned int req, unsigned int day, unsigned int hour) const {
+      return sparse_var(Requirement, _requirement_begin, _lesson_slots, req, WeekShape::slot(day, hour));
+   }
 
-   void create_teacher_is_in_school_var();
+   // the hours h at which the requirement can take both h and h+1. Only they have a requirement_cons_var_from_hour,
+   // and only if the requirement wants consecutive hours
+   [[nodiscard]] WeekMask get_pair_slots(unsigned int req) const { return _pair_slots[req]; }
 
-   void create_requirement_var();
+   // whether the requirement takes hours hour and hour+1 in day. InvalidVarID if the requirement wants no
+   // consecutive hours, or cannot have both lessons
+   [[nodiscard]] VarID requirement_cons_var_from_hour(unsigned int req, unsigned int day, unsigned int hour) const {
+      return sparse_var(RequirementConsHour, _cons_begin, _pair_slots, req, WeekShape::slot(day, hour));
+   }
 
-   void create_requirement_cons_var_from_hour();
-
-   void create_day_weight_for_class();
+   // the following are LP variables (not {0,1})
+   // the weight of the day for the class
+   [[nodiscard]] VarID day_weight_for_class(unsigned int class_idx, unsigned int day) const {
+      return _family_begin[DayWeight] + class_idx * NUM_DAYS + day;
+   }
+
+   // same as before, but sorted. These appear in the weight objective, with decreasing weight
+   [[nodiscard]] VarID day_weight_for_class_sorted(unsigned int class_idx, unsigned int k) const {
+      return _family_begin[DayWeightSorted] + class_idx * NUM_DAYS + k;
+   }
+
+   // only with CompactInSchool: whether the teacher has had a lesson at or before that hour, and whether he still
+   // has one at or after it
+   [[nodiscard]] VarID teacher_lessons_begun_var(unsigned int teacher, unsigned int day, unsigned int hour) const {
+      return slot_var(TeacherLessonsBegun, teacher, day, hour);
+   }
+
+   [[nodiscard]] VarID teacher_lessons_not_over_var(unsigned int teacher, unsigned int day, unsigned int hour) const {
+      return slot_var(TeacherLessonsNotOver, teacher, day, hour);
+   }
+
+   // only with KSumDayWeight: the sum of the k+1 largest day weights of a class is at most
+   // (k+1) * day_weight_threshold_var(class, k) + sum over the days d of day_weight_excess_var(class, k, d)
+   [[nodiscard]] VarID day_weight_threshold_var(unsigned int class_idx, unsigned int k) const {
+      return _family_begin[DayWeightThreshold] + class_idx * NUM_DAYS + k;
+   }
+
+   [[nodiscard]] VarID day_weight_excess_var(unsigned int class_idx, unsigned int k, unsigned int day) const {
+      return _family_begin[DayWeightExcess] + (class_idx * NUM_DAYS + k) * NUM_DAYS + day;
+   }
+
+   // only with BlockStartContiguity: whether the lessons of the requirement on that day are at hour and hour+1 (or
+   // only at one of them), for every hour but the last one. Invalid on days with less than three hours, where any
+   // lessons are already in one block
+   [[nodiscard]] VarID requirement_block_start_var(unsigned int req, unsigned int day, unsigned int hour) const {
+      return BLOCK_DAY_BEGIN[day + 1] == BLOCK_DAY_BEGIN[day] ? InvalidVarID :
+             _family_begin[RequirementBlockStart] + req * BLOCK_DAY_BEGIN[NUM_DAYS] + BLOCK_DAY_BEGIN[day] + hour;
+   }
 
-   void create_day_weight_for_class_sorted();
+private:
+   static constexpr unsigned int NUM_DAYS = WeekShape::NUM_DAYS;
+   // where the hours of every day begin among the variables of a holder of RequirementBlockStart, which start at
+   // every hour but the last one on the days with at least three hours
+   static constexpr std::array<unsigned int, NUM_DAYS + 1> BLOCK_DAY_BEGIN =
+         prefix_sums(WeekShape::hours_but_last(3));
+
+   // the variable of a family with one variable for every hour of the week
+   [[nodiscard]] VarID slot_var(Family family, unsigned int holder, unsigned int day, unsigned int hour) const {
+      return _family_begin[family] + VarID(holder) * WeekShape::NUM_SLOTS + WeekShape::slot(day, hour);
+   }
+
+   // the variable of a family with one variable for every set hour of the mask of its holder
+   [[nodiscard]] VarID sparse_var(Family family, const std::vector<VarID> &holder_begin,
+                                  const std::vector<WeekMask> &slots, unsigned int holder, unsigned int slot) const {
+      return slots[holder].test(slot) ? _family_begin[family] + holder_begin[holder] + slots[holder].rank(slot)
+                                      : InvalidVarID;
+   }
+
+   // the holder of the variable at @p offset in a family whose holders begin at @p holder_begin
+   static unsigned int sparse_holder(const std::vector<VarID> &holder_begin, VarID offset);
 
    const Input &_input;
-   std::vector<Variable> _variables;
+   ModelOptions _options;
+   // the variables of family f are in [_family_begin[f], _family_begin[f+1])
+   std::array<VarID, NUM_FAMILIES + 1> _family_begin;
 
    VarID _num_01_var;
 
-   // one variable for each teacher saying whether he has lesson at that day
-   std::vector<std::vector<std::vector<VarID>>> _teacher_has_lesson_var;
-   // one variable for each teacher saying whether he has lessons before and after in the same day
-   std::vector<std::vector<std::vector<VarID>>> _teacher_is_in_school_var;
-
-   // there will be one variable for each requirement. Read as @p _requirement_var[req][day][h]
-   std::vector<std::vector<std::vector<VarID>>> _requirement_var;
-   // the variables in _requirement_var stored according to classes and teacher respectively
-   // they should be read as @p _requirement_var_per_class[class][day][hour] and @p _requirement_var_per_teacher[teacher][day][hour]
-   std::vector<std::vector<std::vector<std::vector<VarID>>>> _requirement_var_per_class;
-   std::vector<std::vector<std::vector<std::vector<VarID>>>> _requirement_var_per_teacher;
-
-   // _requirement_cons_var_from_hour[req][day][hour] hays whether the requirement req takes hours hour and hour+1 in day
-   std::vector<std::vector<std::vector<VarID>>> _requirement_cons_var_from_hour;
-
-   // the following are LP variables (not {0,1})
-   // there will be one variable for each class x day, measuring the weight of that day
-   std::vector<std::vector<VarID>> _day_weight_for_class;
-   // same as before, but sorted. These will appear in the weight objective, with decreasing weight
-   std::vector<std::vector<VarID>> _day_weight_for_class_sorted;
+   // the sparse families: the variables of requirement req are at [_requirement_begin[req],
+   // _requirement_begin[req+1]) from the beginning of Requirement, one for every hour of _lesson_slots[req], and
+   // the same for RequirementConsHour. _pair_slots is empty for the requirements without consecutive hours
+   std::vector<WeekMask> _lesson_slots;
+   std::vector<VarID> _requirement_begin;
+   std::vector<WeekMask> _pair_slots;
+   std::vector<VarID> _cons_begin;
 };
 
 
@@ -0,0 +1,232 @@
+#ifndef SCHEDULE_HIGHSCHOOL_WEEK_GRID_H
+#define SCHEDULE_HIGHSCHOOL_WEEK_GRID_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// offsets of the first element of every block, and the total at the end
+template<size_t N>
+constexpr std::array<unsigned int, N + 1> prefix_sums(const std::array<unsigned int, N> &sizes) {
+   std::array<unsigned int, N + 1> begin{};
+   for (size_t idx = 0; idx != N; ++idx) {
+      begin[idx + 1] = begin[idx] + sizes[idx];
+   }
+   return begin;
+}
+
+// The shape of the school week. Its hours are laid out day after day: hour h of day d is the slot DAY_BEGIN[d] + h
+struct WeekShape {
+   static constexpr unsigned int NUM_DAYS = 6;
+   static constexpr std::array<unsigned int, NUM_DAYS> NUM_HOURS_PER_DAY{6, 6, 6, 6, 6, 5};
+   static constexpr std::array<unsigned int, NUM_DAYS + 1> DAY_BEGIN = prefix_sums(NUM_HOURS_PER_DAY);
+   static constexpr unsigned int NUM_SLOTS = DAY_BEGIN[NUM_DAYS];
+
+   static constexpr unsigned int slot(unsigned int day, unsigned int hour) { return DAY_BEGIN[day] + hour; }
+
+   // the day of hour @p slot of the week
+   static constexpr unsigned int day_of(unsigned int slot) {
+      unsigned int day = 0;
+      for (unsigned int next_day = 1; next_day != NUM_DAYS; ++next_day) {
+         day += slot >= DAY_BEGIN[next_day] ? 1 : 0;
+      }
+      return day;
+   }
+
+   // the last hour of every day, as bits of a WeekMask
+   static constexpr uint64_t last_hours_bits() {
+      uint64_t last_hours = 0;
+      for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+         last_hours |= uint64_t(1) << (DAY_BEGIN[day + 1] - 1);
+      }
+      return last_hours;
+   }
+
+   // the hours of every day but the last one, on the days with at least @p min_hours hours, and none on the others
+   static constexpr std::array<unsigned int, NUM_DAYS> hours_but_last(unsigned int min_hours) {
+      std::array<unsigned int, NUM_DAYS> hours{};
+      for (unsigned int day = 0; day != NUM_DAYS; ++day) {
+         hours[day] = NUM_HOURS_PER_DAY[day] >= min_hours ? NUM_HOURS_PER_DAY[day] - 1 : 0;
+      }
+      return hours;
+   }
+};
+
+// One bit for every hour of the week, bit s for slot s. The set hours are numbered in the order of the week:
+// rank() and select() convert between the slot of an hour and its number. The operations on whole weeks are a few
+// instructions on one word, popcount and ctz included, so they can answer for many teachers or classes at once
+class WeekMask {
+public:
+   static_assert(WeekShape::NUM_SLOTS <= 64, "A week must fit in 64 bits");
+
+   WeekMask() : _bits{0} {}
+
+   explicit WeekMask(uint64_t bits_) : _bits{bits_} {}
+
+   // every hour of the week
+   static WeekMask week() { return WeekMask(WEEK_BITS); }
+
+   // every hour of @p day
+   static WeekMask day_hours(unsigned int day) {
+      return WeekMask(((uint64_t(1) << WeekShape::NUM_HOURS_PER_DAY[day]) - 1) << WeekShape::DAY_BEGIN[day]);
+   }
+
+   [[nodiscard]] uint64_t bits() const { return _bits; }
+
+   [[nodiscard]] bool empty() const { return _bits == 0; }
+
+   [[nodiscard]] bool test(unsigned int slot) const { return (_bits >> slot) & 1u; }
+
+   void set(unsigned int slot) { _bits |= uint64_t(1) << slot; }
+
+   void reset(unsigned int slot) { _bits &= ~(uint64_t(1) << slot); }
+
+   [[nodiscard]] unsigned int count() const { return __builtin_popcountll(_bits); }
+
+   // the number of set hours before @p slot
+   [[nodiscard]] unsigned int rank(unsigned int slot) const {
+      return __builtin_popcountll(_bits & ((uint64_t(1) << slot) - 1));
+   }
+
+   // the slot of the set hour number @p pos, which must be below count()
+   [[nodiscard]] unsigned int select(unsigned int pos) const {
+      uint64_t bits = _bits;
+      for (unsigned int skipped = 0; skipped != pos; ++skipped) {
+         bits &= bits - 1;  // clears the lowest set bit
+      }
+      return __builtin_ctzll(bits);
+   }
+
+   // the first set hour, which must exist
+   [[nodiscard]] unsigned int lowest() const { return __builtin_ctzll(_bits); }
+
+   // clears the first set hour, which must exist, and returns it: the set hours are enumerated with
+   // while (not mask.empty()) { unsigned int slot = mask.pop_lowest(); ... }
+   unsigned int pop_lowest() {
+      unsigned int slot = lowest();
+      _bits &= _bits - 1;
+      return slot;
+   }
+
+   // the hours h of this mask such that h+1 is in it too, on the same day
+   [[nodiscard]] WeekMask pair_starts() const {
+      return WeekMask(_bits & (_bits >> 1) & ~LAST_HOURS_BITS);
+   }
+
+   // the hours from the first set hour to the last one, none if the mask is empty
+   [[nodiscard]] WeekMask span() const {
+      if (_bits == 0) {
+         return WeekMask();
+      }
+      return WeekMask((uint64_t(2) << (63 - __builtin_clzll(_bits))) - (uint64_t(1) << __builtin_ctzll(_bits)));
+   }
+
+   // on every day, the hours from the first set hour to the last one
+   [[nodiscard]] WeekMask day_spans() const {
+      WeekMask spans;
+      for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+         spans |= (*this & day_hours(day)).span();
+      }
+      return spans;
+   }
+
+   // the hours of the week not in this mask
+   WeekMask operator~() const { return WeekMask(~_bits & WEEK_BITS); }
+
+   WeekMask operator&(WeekMask other) const { return WeekMask(_bits & other._bits); }
+
+   WeekMask operator|(WeekMask other) const { return WeekMask(_bits | other._bits); }
+
+   WeekMask &operator&=(WeekMask other) {
+      _bits &= other._bits;
+      return *this;
+   }
+
+   WeekMask &operator|=(WeekMask other) {
+      _bits |= other._bits;
+      return *this;
+   }
+
+   bool operator==(WeekMask other) const { return _bits == other._bits; }
+
+   bool operator!=(WeekMask other) const { return _bits != other._bits; }
+
+private:
+   static constexpr uint64_t WEEK_BITS =
+         WeekShape::NUM_SLOTS == 64 ? ~uint64_t(0) : (uint64_t(1) << WeekShape::NUM_SLOTS) - 1;
+   static constexpr uint64_t LAST_HOURS_BITS = WeekShape::last_hours_bits();
+
+   uint64_t _bits;
+};
+
+// A view of contiguous elements, as std::span of C++20
+template<typename T>
+class Span {
+public:
+   Span(T *data_, size_t size_) : _data{data_}, _size{size_} {}
+
+   [[nodiscard]] size_t size() const { return _size; }
+
+   [[nodiscard]] bool empty() const { return _size == 0; }
+
+   T &operator[](size_t pos) const { return _data[pos]; }
+
+   T *begin() const { return _data; }
+
+   T *end() const { return _data + _size; }
+
+private:
+   T *_data;
+   size_t _size;
+};
+
+// one T for every day of the week
+template<typename T>
+using DayArray = std::array<T, WeekShape::NUM_DAYS>;
+
+// One T for every hour of the week, in a single block of fixed size: nothing is allocated, and finding the slot of
+// (day, hour) is one addition
+template<typename T>
+class WeekGrid {
+public:
+   WeekGrid() : _slots{} {}
+
+   explicit WeekGrid(const T &value) { _slots.fill(value); }
+
+   T &operator()(unsigned int day, unsigned int hour) { return _slots[WeekShape::slot(day, hour)]; }
+
+   const T &operator()(unsigned int day, unsigned int hour) const { return _slots[WeekShape::slot(day, hour)]; }
+
+   T &operator[](unsigned int slot) { return _slots[slot]; }
+
+   const T &operator[](unsigned int slot) const { return _slots[slot]; }
+
+   // the hours of @p day
+   Span<T> day(unsigned int day) {
+      return Span<T>(_slots.data() + WeekShape::DAY_BEGIN[day], WeekShape::NUM_HOURS_PER_DAY[day]);
+   }
+
+   Span<const T> day(unsigned int day) const {
+      return Span<const T>(_slots.data() + WeekShape::DAY_BEGIN[day], WeekShape::NUM_HOURS_PER_DAY[day]);
+   }
+
+   static constexpr size_t size() { return WeekShape::NUM_SLOTS; }
+
+   T *begin() { return _slots.data(); }
+
+   T *end() { return _slots.data() + size(); }
+
+   const T *begin() const { return _slots.data(); }
+
+   const T *end() const { return _slots.data() + size(); }
+
+   bool operator==(const WeekGrid &other) const { return _slots == other._slots; }
+
+   bool operator!=(const WeekGrid &other) const { return _slots != other._slots; }
+
+private:
+   std::array<T, WeekShape::NUM_SLOTS> _slots;
+};
+
+
+#endif //SCHEDULE_HIGHSCHOOL_WEEK_GRID_H
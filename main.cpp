@@ -1,13 +1,368 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <sstream>
+#include "Components.h"
 #include "Input.h"
+#include "Mapped_File.h"
 #include "LP_Provider.h"
+#include "MIP_Model.h"
+#include "Model_Solver.h"
+#include "Model_Writer.h"
+#include "Neighborhood_Search.h"
+#include "Presolve.h"
+#include "BB_Solver.h"
+#include "Schedule.h"
+#include "Tabu_Search.h"
+#include "Trace.h"
+#include "Two_Stage.h"
 
-int main() {
-   std::ifstream input_stream;
-   input_stream.open("input_example1.txt");
-   Input input(input_stream);
-   input_stream.close();
-   Variables variables(input);
-   LP_Provider lp_provider(input, variables, LP_Provider::Min);
+namespace {
+   // the objective of the model of the whole school at @p schedule, from the objective alone: the rows are not built
+   double model_objective(const Input &input, const Variables &variables, const Schedule &schedule) {
+      LP_Provider objective_provider(input, variables, LP_Provider::Min, LP_Provider::Streaming);
+      std::vector<double> values = schedule.get_values(variables);
+      double objective = 0.0;
+      for (const VarIdxCoeffPair &entry: objective_provider.get_objective().lin_vec) {
+         objective += entry.coeff * values[entry.var_idx];
+      }
+      return objective;
+   }
+
+   // "none" if the search stopped before it had a bound
+   std::string bound_text(bool has_bound, double bound) {
+      if (not has_bound) {
+         return "none";
+      }
+      std::ostringstream os;
+      os << bound;
+      return os.str();
+   }
+
+   void write_schedule(const Schedule &schedule) {
+      std::ofstream classes_stream("classes_schedule.txt");
+      schedule.print_classes(classes_stream);
+      std::ofstream teachers_stream("teacher_schedule.txt");
+      schedule.print_teachers(teachers_stream);
+   }
+
+   // the tabu search that gives the first schedule to --previous and --lns runs this long without --tabu
+   constexpr double START_SECONDS = 1.0;
+
+   // the schedule of a tabu search of @p seconds, which repairs @p previous if given; nullptr if it does not satisfy
+   // the model
+   std::unique_ptr<Schedule> tabu_schedule(const Input &input, const Variables &variables, const MIP_Model &model,
+                                           double seconds, const Schedule *previous, double disruption_weight) {
+      TabuSearch::Options tabu_options;
+      tabu_options.time_limit = seconds;
+      TabuSearch tabu_search(input, tabu_options);
+      if (previous) {
+         tabu_search.set_previous(*previous, disruption_weight);
+      }
+      TabuSearch::Result tabu_result = tabu_search.run();
+      auto schedule = std::make_unique<Schedule>(tabu_search.get_best_schedule());
+      std::cout << "Tabu search: objective " << model.evaluate(schedule->get_values(variables)) << ", "
+                << tabu_result.violations << " violations, " << tabu_result.iterations << " iterations, "
+                << tabu_result.seconds << " s" << std::endl;
+      if (tabu_result.violations != 0) {
+         return nullptr;
+      }
+      return schedule;
+   }
+}
+
+// usage: Schedule_HighSchool [input.txt] [--stream] [--lp <file.lp>] [--mps <file.mps>] [--solve]
+//                            [--time-limit <seconds>] [--threads <n>] [--deterministic]
+//                            [--no-presolve] [--presolved] [--in-school <pairwise|compact>]
+//                            [--day-weight <subsets|ksum>] [--contiguity <pairwise|blocks>]
+//                            [--lazy] [--two-stage] [--components] [--tabu <seconds>]
+//                            [--previous <classes_schedule.txt>] [--disruption <weight>] [--lns <seconds>]
+//                            [--trace <file.json>]
+// without --lp or --mps the model is solved; with them it is solved only if --solve is given.
+// The solver gets the presolved model unless --no-presolve is given; the files get it with --presolved.
+// With --lazy the solver starts without most of the in-school and contiguity rows, and adds those that its solutions
+// violate; it cannot be combined with --lp and --mps, whose files would miss them.
+// With --two-stage the lessons are first given days and then hours, each day on its own, without the whole model;
+// --time-limit and --threads apply to every stage.
+// With --components the parts of the school that share no teacher are solved as models of their own, at the same
+// time on the --threads; it cannot be combined with --lp and --mps, which write the model of the whole school.
+// With --tabu the solver, or the first stage of --two-stage, starts from the schedule of a tabu search of that many
+// seconds.
+// With --previous the solver starts from that schedule, as written by an earlier run, usually on an earlier version
+// of the input: the tabu search (of --tabu seconds, or one) repairs it first, and every lesson that the new schedule
+// moves costs --disruption, 1 by default, in the objective. It cannot be combined with --lp, --mps, --two-stage and
+// --components.
+// With --lns the schedule of the tabu search (or of --previous) is improved for that many seconds by a large
+// neighborhood search: parts of the school are solved again, with the rest of the schedule fixed, --threads at a time
+// and each within --time-limit seconds (5 by default). It cannot be combined with --lp, --mps, --lazy, --two-stage
+// and --components.
+// With --trace the phases are written to the file as a Chrome trace, and summed up in one JSON line at the end;
+// it needs a build with SCHEDULE_ENABLE_TRACE
+int main(int argc, char *argv[]) {
+   std::string input_file = "input_example1.txt";
+   std::string lp_file, mps_file, trace_file, previous_file;
+   LP_Provider::Storage storage = LP_Provider::InMemory;
+   bool solve = false;
+   bool use_presolve = true;
+   bool write_presolved = false;
+   bool two_stage = false;
+   bool split_components = false;
+   double tabu_seconds = 0.0;
+   double disruption_weight = 1.0;
+   double lns_seconds = 0.0;
+   BB_Solver::Options solver_options;
+   ModelOptions model_options;
+   for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+      if (std::strcmp(argv[arg_idx], "--stream") == 0) {
+         storage = LP_Provider::Streaming;
+      } else if (std::strcmp(argv[arg_idx], "--lp") == 0 and arg_idx + 1 < argc) {
+         lp_file = argv[++arg_idx];
+      } else if (std::strcmp(argv[arg_idx], "--mps") == 0 and arg_idx + 1 < argc) {
+         mps_file = argv[++arg_idx];
+      } else if (std::strcmp(argv[arg_idx], "--solve") == 0) {
+         solve = true;
+      } else if (std::strcmp(argv[arg_idx], "--no-presolve") == 0) {
+         use_presolve = false;
+      } else if (std::strcmp(argv[arg_idx], "--presolved") == 0) {
+         write_presolved = true;
+      } else if (std::strcmp(argv[arg_idx], "--in-school") == 0 and arg_idx + 1 < argc) {
+         ++arg_idx;
+         model_options.in_school = std::strcmp(argv[arg_idx], "compact") == 0 ? ModelOptions::CompactInSchool
+                                                                              : ModelOptions::PairwiseInSchool;
+      } else if (std::strcmp(argv[arg_idx], "--day-weight") == 0 and arg_idx + 1 < argc) {
+         ++arg_idx;
+         model_options.day_weight = std::strcmp(argv[arg_idx], "ksum") == 0 ? ModelOptions::KSumDayWeight
+                                                                           : ModelOptions::SubsetsDayWeight;
+      } else if (std::strcmp(argv[arg_idx], "--contiguity") == 0 and arg_idx + 1 < argc) {
+         ++arg_idx;
+         model_options.contiguity = std::strcmp(argv[arg_idx], "blocks") == 0 ? ModelOptions::BlockStartContiguity
+                                                                              : ModelOptions::PairwiseContiguity;
+      } else if (std::strcmp(argv[arg_idx], "--two-stage") == 0) {
+         two_stage = true;
+      } else if (std::strcmp(argv[arg_idx], "--components") == 0) {
+         split_components = true;
+      } else if (std::strcmp(argv[arg_idx], "--lazy") == 0) {
+         model_options.lazy_rows = true;
+      } else if (std::strcmp(argv[arg_idx], "--time-limit") == 0 and arg_idx + 1 < argc) {
+         solver_options.time_limit = std::stod(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--threads") == 0 and arg_idx + 1 < argc) {
+         solver_options.num_threads = std::stoul(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--tabu") == 0 and arg_idx + 1 < argc) {
+         tabu_seconds = std::stod(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--previous") == 0 and arg_idx + 1 < argc) {
+         previous_file = argv[++arg_idx];
+      } else if (std::strcmp(argv[arg_idx], "--disruption") == 0 and arg_idx + 1 < argc) {
+         disruption_weight = std::stod(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--lns") == 0 and arg_idx + 1 < argc) {
+         lns_seconds = std::stod(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--trace") == 0 and arg_idx + 1 < argc) {
+         trace_file = argv[++arg_idx];
+      } else if (std::strcmp(argv[arg_idx], "--deterministic") == 0) {
+         solver_options.deterministic = true;
+      } else {
+         input_file = argv[arg_idx];
+      }
+   }
+   if (lp_file.empty() and mps_file.empty()) {
+      solve = true;
+   }
+   if (write_presolved) {
+      use_presolve = true;
+   }
+   if (model_options.lazy_rows and not(lp_file.empty() and mps_file.empty())) {
+      std::cerr << "--lazy leaves rows out of the model, and cannot be used with --lp or --mps" << std::endl;
+      return 1;
+   }
+   if (split_components and not(lp_file.empty() and mps_file.empty())) {
+      std::cerr << "--components solves every part of the school on its own, and cannot be used with --lp or --mps"
+                << std::endl;
+      return 1;
+   }
+   if (not previous_file.empty() and (two_stage or split_components or not(lp_file.empty() and mps_file.empty()))) {
+      std::cerr << "--previous changes the objective of the model of the whole school, and cannot be used with "
+                   "--lp, --mps, --two-stage or --components" << std::endl;
+      return 1;
+   }
+   if (lns_seconds > 0.0 and (two_stage or split_components or model_options.lazy_rows or
+                              not(lp_file.empty() and mps_file.empty()))) {
+      std::cerr << "--lns solves parts of the model of the whole school with all its rows, and cannot be used with "
+                   "--lp, --mps, --lazy, --two-stage or --components" << std::endl;
+      return 1;
+   }
+   if (not trace_file.empty() and not Trace::is_enabled()) {
+      std::cerr << "This build has no trace: configure it with -DSCHEDULE_ENABLE_TRACE=ON" << std::endl;
+   }
+   TraceFile trace(trace_file, std::cout);
+
+   MappedFile input_mapping(input_file);
+   if (not input_mapping.is_open()) {
+      std::cerr << "Cannot open " << input_file << std::endl;
+      return 1;
+   }
+   Input input(input_mapping.begin(), input_mapping.end());
+   Variables variables(input, model_options);
+   std::unique_ptr<Schedule> previous;
+   if (not previous_file.empty()) {
+      std::ifstream previous_stream(previous_file);
+      if (not previous_stream) {
+         std::cerr << "Cannot open " << previous_file << std::endl;
+         return 1;
+      }
+      previous = std::make_unique<Schedule>(input, previous_stream);
+   }
+   if (two_stage) {
+      TwoStageSolver::Options two_stage_options;
+      two_stage_options.time_limit = solver_options.time_limit;
+      two_stage_options.num_threads = solver_options.num_threads;
+      TwoStageSolver two_stage_solver(input, two_stage_options);
+      if (tabu_seconds > 0.0) {
+         TabuSearch::Options tabu_options;
+         tabu_options.time_limit = tabu_seconds;
+         TabuSearch tabu_search(input, tabu_options);
+         TabuSearch::Result tabu_result = tabu_search.run();
+         std::cout << "Tabu search: " << tabu_result.violations << " violations, " << tabu_result.iterations
+                   << " iterations, " << tabu_result.seconds << " s" << std::endl;
+         if (tabu_result.violations == 0 and not two_stage_solver.set_start(tabu_search.get_best_schedule())) {
+            std::cerr << "The tabu search schedule does not satisfy the first stage" << std::endl;
+         }
+      }
+      TwoStageSolver::Result result = two_stage_solver.solve();
+      std::cout << "Two-stage: " << BB_Solver::status_name(result.status) << ", objective " << result.objective
+                << " (day weights " << result.day_weight_objective << ", in school " << result.in_school_objective
+                << "), " << result.num_rounds << " rounds, " << result.num_cuts << " cuts, " << result.seconds << " s"
+                << std::endl;
+      if (result.status != BB_Solver::Feasible) {
+         return 2;
+      }
+      std::cout << "Objective of the model: " << model_objective(input, variables, two_stage_solver.get_schedule())
+                << std::endl;
+      write_schedule(two_stage_solver.get_schedule());
+      return 0;
+   }
+   if (split_components) {
+      SchoolComponents components(input);
+      size_t largest = 0;
+      for (size_t component = 0; component != components.size(); ++component) {
+         largest = std::max(largest, components.get_classes(component).size());
+      }
+      std::cout << "Components: " << components.size() << ", the largest with " << largest << " classes"
+                << std::endl;
+      SchoolComponents::Result result = components.solve(model_options, solver_options, use_presolve);
+      std::cout << "Status: " << BB_Solver::status_name(result.status) << ", objective " << result.objective
+                << ", bound " << bound_text(result.has_bound, result.bound) << ", " << result.num_nodes << " nodes, "
+                << result.seconds << " s" << std::endl;
+      if (result.status != BB_Solver::Optimal and result.status != BB_Solver::Feasible) {
+         return 2;
+      }
+      std::cout << "Objective of the model: " << model_objective(input, variables, components.get_schedule())
+                << std::endl;
+      write_schedule(components.get_schedule());
+      return 0;
+   }
+   LP_Provider lp_provider(input, variables, LP_Provider::Min, storage, solver_options.num_threads);
+   if (not write_presolved) {
+      if (not lp_file.empty()) {
+         std::ofstream lp_stream(lp_file, std::ios::binary);
+         lp_provider.write_lp(lp_stream);
+      }
+      if (not mps_file.empty()) {
+         std::ofstream mps_stream(mps_file, std::ios::binary);
+         lp_provider.write_mps(mps_stream);
+      }
+      if (not solve) {
+         return 0;
+      }
+   }
+
+   MIP_Model model(lp_provider);
+   if (previous) {
+      previous->add_disruption(model, variables, disruption_weight);
+   }
+   if (lns_seconds > 0.0) {
+      std::unique_ptr<Schedule> start = tabu_schedule(input, variables, model,
+                                                      tabu_seconds > 0.0 ? tabu_seconds : START_SECONDS,
+                                                      previous.get(), disruption_weight);
+      if (not start) {
+         std::cerr << "The tabu search found no schedule to start the neighborhood search from" << std::endl;
+         return 2;
+      }
+      NeighborhoodSearch::Options lns_options;
+      lns_options.time_limit = lns_seconds;
+      lns_options.num_threads = solver_options.num_threads;
+      if (std::isfinite(solver_options.time_limit)) {
+         lns_options.solver_options.time_limit = solver_options.time_limit;
+      }
+      lns_options.solver_options.branching_priority = lp_provider.branching_priorities();
+      NeighborhoodSearch neighborhood_search(input, variables, model, lns_options);
+      NeighborhoodSearch::Result result = neighborhood_search.run(*start);
+      std::cout << "Neighborhood search: objective " << result.objective << ", " << result.num_rounds << " rounds, "
+                << result.num_neighborhoods << " neighborhoods, " << result.seconds << " s; improvements:";
+      for (unsigned int type = 0; type != NeighborhoodSearch::NUM_NEIGHBORHOOD_TYPES; ++type) {
+         std::cout << ' ' << NeighborhoodSearch::type_name(NeighborhoodSearch::NeighborhoodType(type)) << ' '
+                   << result.improvements[type];
+      }
+      std::cout << std::endl;
+      if (previous) {
+         std::cout << "Moved lessons: " << previous->num_moved_lessons(neighborhood_search.get_schedule())
+                   << " of the " << previous->num_lessons() << " of the previous schedule" << std::endl;
+      }
+      write_schedule(neighborhood_search.get_schedule());
+      return 0;
+   }
+   ModelSolver model_solver(lp_provider, model, use_presolve, solver_options);
+   if (const Presolve *presolve = model_solver.get_presolve()) {
+      presolve->print_report(std::cout);
+      if (presolve->is_infeasible()) {
+         std::cout << "Status: " << BB_Solver::status_name(BB_Solver::Infeasible) << std::endl;
+         return 2;
+      }
+      if (write_presolved) {
+         WriterColumns columns(variables, presolve->get_model(), presolve->get_original_columns());
+         if (not lp_file.empty()) {
+            std::ofstream lp_stream(lp_file, std::ios::binary);
+            write_lp(lp_stream, presolve->get_model(), columns);
+         }
+         if (not mps_file.empty()) {
+            std::ofstream mps_stream(mps_file, std::ios::binary);
+            write_mps(mps_stream, presolve->get_model(), columns);
+         }
+         if (not solve) {
+            return 0;
+         }
+      }
+   }
+
+   if (tabu_seconds > 0.0 or previous) {
+      std::unique_ptr<Schedule> start = tabu_schedule(input, variables, model,
+                                                      tabu_seconds > 0.0 ? tabu_seconds : START_SECONDS,
+                                                      previous.get(), disruption_weight);
+      if (start and not model_solver.set_start(start->get_values(variables))) {
+         std::cerr << "The tabu search schedule does not satisfy the model" << std::endl;
+      }
+   }
+   BB_Solver::Result result = model_solver.solve();
+   std::cout << "Status: " << BB_Solver::status_name(result.status) << ", objective " << result.objective
+             << ", bound " << bound_text(result.has_bound, result.bound) << ", " << result.num_nodes << " nodes, "
+             << result.lp_iterations << " LP iterations, " << result.seconds << " s" << std::endl;
+   if (model_options.lazy_rows) {
+      std::cout << "Lazy rows: " << result.separated_rows << " added to the " << model.num_rows()
+                << " of the model" << std::endl;
+   }
+   if (not result.has_solution()) {
+      return 2;
+   }
+   std::string reason;
+   if (not model_solver.check(result.values, reason)) {
+      std::cerr << "The solution does not satisfy the model: " << reason << std::endl;
+      return 3;
+   }
+   Schedule schedule(input, variables, result.values);
+   if (previous) {
+      std::cout << "Moved lessons: " << previous->num_moved_lessons(schedule) << " of the "
+                << previous->num_lessons() << " of the previous schedule" << std::endl;
+   }
+   write_schedule(schedule);
    return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,240 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BB_Solver.h"
+#include "Input.h"
+#include "LP_Provider.h"
+#include "MIP_Model.h"
+#include "Mapped_File.h"
+#include "Model_Solver.h"
+#include "Schedule.h"
+#include "Variables.h"
+
+// usage: Batch_Solve <input.txt | directory> ... [--jobs <n>] [--threads <n>] [--time-limit <seconds>]
+//                    [--output <directory>] [--no-presolve] [--in-school <pairwise|compact>]
+//                    [--day-weight <subsets|ksum>] [--contiguity <pairwise|blocks>] [--lazy]
+// Solves many inputs in one process, for example the what-if variants of a school: every file given and every .txt
+// file of every directory given, with the model and the options of the program. Up to --jobs inputs are parsed,
+// built and solved at a time, each on its own with --threads threads. The schedules go to the output directory, the
+// current one by default, as <name>_classes.txt and <name>_teachers.txt, where the name is the stem of the input,
+// followed by _2, _3... if an input before it has the same one; the status, the objective and the seconds of every
+// phase of every input go to stdout and to summary.csv there, in the order of the inputs. An input with an error is
+// reported and does not stop the others
+namespace {
+   double seconds_since(std::chrono::steady_clock::time_point start) {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   }
+
+   struct BatchEntry {
+      std::filesystem::path path;
+      std::string name;  // of the schedule files
+      std::string status;
+      double objective;
+      double bound;
+      bool has_bound;
+      double parse_seconds;
+      double build_seconds;  // the variables, the rows and the presolve
+      double solve_seconds;
+      std::string error;
+
+      explicit BatchEntry(std::filesystem::path path_) : path{std::move(path_)}, objective{0.0}, bound{0.0},
+                                                         has_bound{false}, parse_seconds{0.0}, build_seconds{0.0},
+                                                         solve_seconds{0.0} {}
+   };
+
+   struct BatchOptions {
+      BB_Solver::Options solver_options;
+      ModelOptions model_options;
+      bool use_presolve;
+      std::filesystem::path output_directory;
+
+      BatchOptions() : use_presolve{true}, output_directory{"."} {}
+   };
+
+   // the stems of the inputs, made unique
+   void set_names(std::vector<BatchEntry> &entries) {
+      std::set<std::string> used;
+      for (BatchEntry &entry: entries) {
+         std::string stem = entry.path.stem().string();
+         entry.name = stem;
+         for (unsigned int copy = 2; used.count(entry.name) != 0; ++copy) {
+            entry.name = stem + "_" + std::to_string(copy);
+         }
+         used.insert(entry.name);
+      }
+   }
+
+   // the same steps as main, for one input
+   void solve_entry(BatchEntry &entry, const BatchOptions &batch_options) {
+      auto start = std::chrono::steady_clock::now();
+      MappedFile input_mapping(entry.path.string());
+      if (not input_mapping.is_open()) {
+         throw std::logic_error("cannot open the file");
+      }
+      Input input(input_mapping.begin(), input_mapping.end());
+      entry.parse_seconds = seconds_since(start);
+
+      start = std::chrono::steady_clock::now();
+      Variables variables(input, batch_options.model_options);
+      LP_Provider lp_provider(input, variables, LP_Provider::Min, LP_Provider::InMemory,
+                              batch_options.solver_options.num_threads);
+      MIP_Model model(lp_provider);
+      ModelSolver model_solver(lp_provider, model, batch_options.use_presolve, batch_options.solver_options);
+      entry.build_seconds = seconds_since(start);
+
+      start = std::chrono::steady_clock::now();
+      BB_Solver::Result result = model_solver.solve();
+      entry.solve_seconds = seconds_since(start);
+      entry.status = BB_Solver::status_name(result.status);
+      entry.objective = result.objective;
+      entry.bound = result.bound;
+      entry.has_bound = result.has_bound;
+      if (not result.has_solution()) {
+         return;
+      }
+      std::string reason;
+      if (not model_solver.check(result.values, reason)) {
+         throw std::logic_error("the solution does not satisfy the model: " + reason);
+      }
+      Schedule schedule(input, variables, result.values);
+      std::ofstream classes_stream(batch_options.output_directory / (entry.name + "_classes.txt"));
+      schedule.print_classes(classes_stream);
+      std::ofstream teachers_stream(batch_options.output_directory / (entry.name + "_teachers.txt"));
+      schedule.print_teachers(teachers_stream);
+   }
+
+   void write_summary(std::ostream &os, const std::vector<BatchEntry> &entries) {
+      os << std::fixed << std::setprecision(3);
+      os << std::setw(24) << "input" << std::setw(12) << "status" << std::setw(12) << "objective" << std::setw(12)
+         << "bound" << std::setw(10) << "parse s" << std::setw(10) << "build s" << std::setw(10) << "solve s"
+         << std::endl;
+      for (const BatchEntry &entry: entries) {
+         os << std::setw(24) << entry.name;
+         if (not entry.error.empty()) {
+            os << "  error: " << entry.error << std::endl;
+            continue;
+         }
+         os << std::setw(12) << entry.status << std::setw(12) << entry.objective << std::setw(12);
+         if (entry.has_bound) {
+            os << entry.bound;
+         } else {
+            os << "none";
+         }
+         os << std::setw(10) << entry.parse_seconds << std::setw(10) << entry.build_seconds << std::setw(10)
+            << entry.solve_seconds << std::endl;
+      }
+   }
+
+   void write_csv(std::ostream &os, const std::vector<BatchEntry> &entries) {
+      os << "input,name,status,objective,bound,parse_seconds,build_seconds,solve_seconds,error\n";
+      for (const BatchEntry &entry: entries) {
+         std::string error = entry.error;
+         std::replace(error.begin(), error.end(), ',', ';');
+         os << entry.path.string() << ',' << entry.name << ',' << entry.status << ',' << entry.objective << ',';
+         if (entry.has_bound) {
+            os << entry.bound;
+         }
+         os << ',' << entry.parse_seconds << ',' << entry.build_seconds << ',' << entry.solve_seconds << ',' << error
+            << '\n';
+      }
+   }
+}
+
+int main(int argc, char *argv[]) {
+   std::vector<BatchEntry> entries;
+   BatchOptions batch_options;
+   unsigned int num_jobs = std::max(1u, std::thread::hardware_concurrency());
+   for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+      if (std::strcmp(argv[arg_idx], "--jobs") == 0 and arg_idx + 1 < argc) {
+         num_jobs = std::max(1ul, std::stoul(argv[++arg_idx]));
+      } else if (std::strcmp(argv[arg_idx], "--threads") == 0 and arg_idx + 1 < argc) {
+         batch_options.solver_options.num_threads = std::stoul(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--time-limit") == 0 and arg_idx + 1 < argc) {
+         batch_options.solver_options.time_limit = std::stod(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--output") == 0 and arg_idx + 1 < argc) {
+         batch_options.output_directory = argv[++arg_idx];
+      } else if (std::strcmp(argv[arg_idx], "--no-presolve") == 0) {
+         batch_options.use_presolve = false;
+      } else if (std::strcmp(argv[arg_idx], "--in-school") == 0 and arg_idx + 1 < argc) {
+         ++arg_idx;
+         batch_options.model_options.in_school = std::strcmp(argv[arg_idx], "compact") == 0
+                                                 ? ModelOptions::CompactInSchool : ModelOptions::PairwiseInSchool;
+      } else if (std::strcmp(argv[arg_idx], "--day-weight") == 0 and arg_idx + 1 < argc) {
+         ++arg_idx;
+         batch_options.model_options.day_weight = std::strcmp(argv[arg_idx], "ksum") == 0
+                                                  ? ModelOptions::KSumDayWeight : ModelOptions::SubsetsDayWeight;
+      } else if (std::strcmp(argv[arg_idx], "--contiguity") == 0 and arg_idx + 1 < argc) {
+         ++arg_idx;
+         batch_options.model_options.contiguity = std::strcmp(argv[arg_idx], "blocks") == 0
+                                                  ? ModelOptions::BlockStartContiguity
+                                                  : ModelOptions::PairwiseContiguity;
+      } else if (std::strcmp(argv[arg_idx], "--lazy") == 0) {
+         batch_options.model_options.lazy_rows = true;
+      } else if (std::filesystem::is_directory(argv[arg_idx])) {
+         std::vector<std::filesystem::path> paths;
+         for (const std::filesystem::directory_entry &file: std::filesystem::directory_iterator(argv[arg_idx])) {
+            if (file.is_regular_file() and file.path().extension() == ".txt") {
+               paths.push_back(file.path());
+            }
+         }
+         std::sort(paths.begin(), paths.end());
+         for (const std::filesystem::path &path: paths) {
+            entries.emplace_back(path);
+         }
+      } else {
+         entries.emplace_back(argv[arg_idx]);
+      }
+   }
+   if (entries.empty()) {
+      std::cerr << "usage: Batch_Solve <input.txt | directory> ... [--jobs <n>] [--threads <n>] "
+                   "[--time-limit <seconds>] [--output <directory>] [--no-presolve] [--in-school <pairwise|compact>] "
+                   "[--day-weight <subsets|ksum>] [--contiguity <pairwise|blocks>] [--lazy]" << std::endl;
+      return 1;
+   }
+   set_names(entries);
+   std::filesystem::create_directories(batch_options.output_directory);
+
+   auto start = std::chrono::steady_clock::now();
+   std::atomic<size_t> next_entry{0};
+   auto solve_entries = [&]() {
+      for (size_t entry_idx = next_entry++; entry_idx < entries.size(); entry_idx = next_entry++) {
+         try {
+            solve_entry(entries[entry_idx], batch_options);
+         } catch (const std::exception &error) {
+            entries[entry_idx].error = error.what();
+         }
+      }
+   };
+   std::vector<std::thread> threads;
+   for (unsigned int job = 1; job < std::min<size_t>(num_jobs, entries.size()); ++job) {
+      threads.emplace_back(solve_entries);
+   }
+   solve_entries();
+   for (std::thread &thread: threads) {
+      thread.join();
+   }
+
+   write_summary(std::cout, entries);
+   std::ofstream csv_stream(batch_options.output_directory / "summary.csv");
+   write_csv(csv_stream, entries);
+   size_t num_errors = std::count_if(entries.begin(), entries.end(), [](const BatchEntry &entry) {
+      return not entry.error.empty();
+   });
+   std::cout << entries.size() << " inputs, " << num_errors << " errors, " << seconds_since(start) << " s"
+             << std::endl;
+   return num_errors == 0 ? 0 : 1;
+}
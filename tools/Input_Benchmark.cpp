@@ -0,0 +1,108 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Input.h"
+#include "Mapped_File.h"
+
+// usage: Input_Benchmark <input.txt> [repetitions]
+// Parses the file repeatedly with the stream reader and with the memory-mapped one, checks that they give the same
+// Input, and prints the throughput of both
+namespace {
+bool same_input(const Input &first, const Input &second) {
+   if (first.num_classes() != second.num_classes() or first.num_teachers() != second.num_teachers() or
+       first.num_requirements() != second.num_requirements()) {
+      return false;
+   }
+   for (unsigned int idx = 0; idx != first.num_classes(); ++idx) {
+      const Input::Class &first_class = first.get_classes()[idx];
+      const Input::Class &second_class = second.get_classes()[idx];
+      if (first_class.id != second_class.id or first_class.name != second_class.name or
+          first_class.num_hours_per_day != second_class.num_hours_per_day or
+          first_class.requirements != second_class.requirements) {
+         return false;
+      }
+   }
+   for (unsigned int idx = 0; idx != first.num_teachers(); ++idx) {
+      const Input::Teacher &first_teacher = first.get_teachers()[idx];
+      const Input::Teacher &second_teacher = second.get_teachers()[idx];
+      if (first_teacher.id != second_teacher.id or first_teacher.name != second_teacher.name or
+          first_teacher.penalties != second_teacher.penalties or
+          first_teacher.num_days_available != second_teacher.num_days_available or
+          first_teacher.requirements != second_teacher.requirements) {
+         return false;
+      }
+   }
+   for (unsigned int idx = 0; idx != first.num_requirements(); ++idx) {
+      const Input::Requirement &first_req = first.get_requirements()[idx];
+      const Input::Requirement &second_req = second.get_requirements()[idx];
+      if (first_req.id != second_req.id or first_req.lessons != second_req.lessons or
+          first_req.num_days_with_cons_hours != second_req.num_days_with_cons_hours or
+          first_req.allow_extra_pairs != second_req.allow_extra_pairs or
+          first_req.average_lesson_weight != second_req.average_lesson_weight) {
+         return false;
+      }
+   }
+   return true;
+}
+
+// runs @p parse @p repetitions times and returns the best time of a run, in seconds
+template<typename Parse>
+double best_seconds(unsigned int repetitions, const Parse &parse) {
+   double best = std::numeric_limits<double>::infinity();
+   for (unsigned int rep = 0; rep != repetitions; ++rep) {
+      auto start = std::chrono::steady_clock::now();
+      parse();
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      best = std::min(best, elapsed.count());
+   }
+   return best;
+}
+}
+
+int main(int argc, char *argv[]) {
+   if (argc < 2) {
+      std::cerr << "usage: " << argv[0] << " <input.txt> [repetitions]" << std::endl;
+      return 1;
+   }
+   std::string input_file = argv[1];
+   unsigned int repetitions = argc > 2 ? std::stoul(argv[2]) : 10;
+
+   MappedFile mapping(input_file);
+   if (not mapping.is_open()) {
+      std::cerr << "Cannot open " << input_file << std::endl;
+      return 1;
+   }
+   double megabytes = mapping.size() / 1e6;
+   {
+      std::ifstream input_stream(input_file);
+      Input stream_input(input_stream);
+      Input mapped_input(mapping.begin(), mapping.end());
+      if (not same_input(stream_input, mapped_input)) {
+         std::cerr << "The two parsers give different inputs" << std::endl;
+         return 2;
+      }
+      std::cout << input_file << ": " << megabytes << " MB, " << mapped_input.num_classes() << " classes, "
+                << mapped_input.num_teachers() << " teachers, " << mapped_input.num_requirements()
+                << " requirements" << std::endl;
+   }
+
+   double stream_seconds = best_seconds(repetitions, [&] {
+      std::ifstream input_stream(input_file);
+      Input input(input_stream);
+   });
+   double mapped_seconds = best_seconds(repetitions, [&] {
+      MappedFile file(input_file);
+      Input input(file.begin(), file.end());
+   });
+   std::cout << "getline + stringstream: " << stream_seconds << " s, " << megabytes / stream_seconds << " MB/s"
+             << std::endl;
+   std::cout << "mmap + from_chars:      " << mapped_seconds << " s, " << megabytes / mapped_seconds << " MB/s"
+             << std::endl;
+   std::cout << "speedup: " << stream_seconds / mapped_seconds << std::endl;
+   return 0;
+}
@@ -0,0 +1,61 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "Instance_Generator.h"
+
+// usage: Instance_Generator <num_classes> [--teachers <n>] [--teachers-per-class <n>] [--min-hours <h>]
+//                           [--doubles <probability>] [--unavailable <probability>] [--seed <s>] [-o <file>]
+// Writes a random input file with a schedule, to the standard output unless -o is given
+int main(int argc, char *argv[]) {
+   if (argc < 2) {
+      std::cerr << "usage: " << argv[0] << " <num_classes> [--teachers <n>] [--teachers-per-class <n>] "
+                << "[--min-hours <h>] [--doubles <probability>] [--unavailable <probability>] [--seed <s>] "
+                << "[-o <file>]" << std::endl;
+      return 1;
+   }
+   try {
+      GeneratorOptions options(std::stoul(argv[1]));
+      std::string output_file;
+      for (int arg_idx = 2; arg_idx < argc; ++arg_idx) {
+         if (std::strcmp(argv[arg_idx], "--teachers") == 0 and arg_idx + 1 < argc) {
+            options.num_teachers = std::stoul(argv[++arg_idx]);
+         } else if (std::strcmp(argv[arg_idx], "--teachers-per-class") == 0 and arg_idx + 1 < argc) {
+            options.teachers_per_class = std::stoul(argv[++arg_idx]);
+         } else if (std::strcmp(argv[arg_idx], "--min-hours") == 0 and arg_idx + 1 < argc) {
+            options.min_hours_per_day = std::stoul(argv[++arg_idx]);
+         } else if (std::strcmp(argv[arg_idx], "--doubles") == 0 and arg_idx + 1 < argc) {
+            options.double_lesson_probability = std::stod(argv[++arg_idx]);
+         } else if (std::strcmp(argv[arg_idx], "--unavailable") == 0 and arg_idx + 1 < argc) {
+            options.unavailable_probability = std::stod(argv[++arg_idx]);
+         } else if (std::strcmp(argv[arg_idx], "--seed") == 0 and arg_idx + 1 < argc) {
+            options.seed = std::stoul(argv[++arg_idx]);
+         } else if (std::strcmp(argv[arg_idx], "-o") == 0 and arg_idx + 1 < argc) {
+            output_file = argv[++arg_idx];
+         } else {
+            std::cerr << "Unknown option " << argv[arg_idx] << std::endl;
+            return 1;
+         }
+      }
+      if (output_file.empty()) {
+         write_random_input(std::cout, options);
+         return 0;
+      }
+      std::ofstream output_stream(output_file, std::ios::binary);
+      write_random_input(output_stream, options);
+      return 0;
+   } catch (const std::invalid_argument &) {
+      // from std::stoul and std::stod
+      std::cerr << "A number is expected in the arguments" << std::endl;
+      return 1;
+   } catch (const std::logic_error &error) {
+      // invalid options, or too few teachers for the classes
+      std::cerr << error.what() << std::endl;
+      return 1;
+   }
+}
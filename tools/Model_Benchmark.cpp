@@ -0,0 +1,345 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BB_Solver.h"
+#include "Dual_Simplex.h"
+#include "Input.h"
+#include "Instance_Generator.h"
+#include "LP_Provider.h"
+#include "MIP_Model.h"
+#include "Model_Delta.h"
+#include "Presolve.h"
+#include "Schedule.h"
+#include "Tabu_Search.h"
+#include "Variables.h"
+
+// usage: Model_Benchmark [num_classes ...] [--seed <s>] [--threads <n>] [--delta] [--time-limit <seconds>] [--no-lp]
+// For every size, generates an input with that many classes and measures how long Input, Variables and LP_Provider
+// take to build, how large the model is, and the peak resident memory. The peak is the one of the whole process, so
+// the sizes are measured in increasing order.
+// With --delta, every input is also edited as a ModelDelta would be: the penalties of a teacher change, and a
+// requirement moves to a teacher who has none in its class. The change sets are applied to the model, the model of
+// the edited input is built again, and the two are compared on the optima of their LP relaxations and on the optima
+// with the lessons fixed to a schedule of the edited input, each within --time-limit seconds (10 by default). The
+// program fails if they differ, or if a comparison cannot be made, for example because an LP is not solved in time:
+// --no-lp skips the LP relaxations, which take minutes from a few classes on
+namespace {
+   typedef MIP_Model::VarID VarID;
+
+   constexpr double OBJECTIVE_TOLERANCE = 1e-6;
+
+   double seconds_since(std::chrono::steady_clock::time_point start) {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   }
+
+   double peak_rss_megabytes() {
+      rusage usage{};
+      getrusage(RUSAGE_SELF, &usage);
+      return usage.ru_maxrss / 1024.0;  // in kilobytes on Linux
+   }
+
+   bool same_objective(double first, double second) {
+      return std::abs(first - second) <= OBJECTIVE_TOLERANCE * (1.0 + std::abs(first));
+   }
+
+   // the penalties of @p teacher as in the input, with -1 where it is unavailable
+   WeekGrid<int> input_penalties(const Input::Teacher &teacher) {
+      WeekGrid<int> penalties;
+      for (unsigned int slot = 0; slot != WeekShape::NUM_SLOTS; ++slot) {
+         penalties[slot] = teacher.penalties[slot] == Input::Teacher::InvalidPenality ? -1 : teacher.penalties[slot];
+      }
+      return penalties;
+   }
+
+   // the edits of --delta, on the positions of the input
+   struct DeltaEdit {
+      unsigned int teacher_idx;  // whose penalties change
+      WeekGrid<int> penalties;
+      unsigned int removed_req_idx;
+      unsigned int added_teacher_idx;  // of the requirement added in the class of the removed one, with its lessons
+
+      DeltaEdit(unsigned int teacher_idx_, const WeekGrid<int> &penalties_, unsigned int removed_req_idx_,
+                unsigned int added_teacher_idx_) : teacher_idx{teacher_idx_}, penalties{penalties_},
+                                                   removed_req_idx{removed_req_idx_},
+                                                   added_teacher_idx{added_teacher_idx_} {}
+   };
+
+   // a requirement whose teacher keeps another one, and the first teacher with no requirement in its class; the
+   // penalties of its teacher are those of every day in reverse, so that some hours become unavailable and others
+   // available. Returns false if the input has no such requirement
+   bool choose_delta_edit(const Input &input, DeltaEdit &edit) {
+      for (unsigned int req_idx = 0; req_idx != input.num_requirements(); ++req_idx) {
+         const Input::Requirement &req = input.get_requirements()[req_idx];
+         unsigned int teacher_idx = input.convert_from_teacher_id(req.teacher_id());
+         const Input::Teacher &teacher = input.get_teachers()[teacher_idx];
+         if (teacher.requirements.size() < 2) {
+            continue;
+         }
+         for (unsigned int other_idx = 0; other_idx != input.num_teachers(); ++other_idx) {
+            if (input.find_requirement(input.get_teachers()[other_idx].id / Input::MAX_ID, req.class_id()) != nullptr) {
+               continue;
+            }
+            WeekGrid<int> penalties = input_penalties(teacher);
+            for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+               Span<int> hours = penalties.day(day);
+               std::reverse(hours.begin(), hours.end());
+            }
+            edit = DeltaEdit(teacher_idx, penalties, req_idx, other_idx);
+            return true;
+         }
+      }
+      return false;
+   }
+
+   // @p text, the input, with @p edit
+   std::string edit_input(const std::string &text, const Input &input, const DeltaEdit &edit) {
+      const Input::Teacher &teacher = input.get_teachers()[edit.teacher_idx];
+      const Input::Requirement &removed = input.get_requirements()[edit.removed_req_idx];
+      std::istringstream lines(text);
+      std::ostringstream edited;
+      std::string line;
+      while (std::getline(lines, line)) {
+         std::istringstream tokens(line);
+         char signal = '\0';
+         Input::ID first_id = 0;
+         Input::ID second_id = 0;
+         tokens >> signal >> first_id;
+         if (signal == Input::Teacher::input_signal and first_id * Input::MAX_ID == teacher.id) {
+            edited << Input::Teacher::input_signal << ' ' << first_id << ' ' << teacher.name;
+            for (int penalty: edit.penalties) {
+               edited << ' ' << penalty;
+            }
+            edited << '\n';
+            continue;
+         }
+         if (signal == Input::Requirement::input_signal and tokens >> second_id and
+             Input::to_requirement_id(first_id, second_id) == removed.id) {
+            continue;
+         }
+         edited << line << '\n';
+      }
+      edited << Input::Requirement::input_signal << ' ' << input.get_teachers()[edit.added_teacher_idx].id /
+                                                           Input::MAX_ID << ' ' << removed.class_id() << ' '
+             << removed.lessons << ' ' << removed.num_days_with_cons_hours << '\n';
+      return edited.str();
+   }
+
+   // the optimum of the LP relaxation of @p model, offset included; false if it is not solved within @p time_limit
+   bool lp_objective(const MIP_Model &model, double time_limit, double &objective) {
+      auto deadline = std::chrono::steady_clock::now() +
+                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(time_limit));
+      DualSimplex simplex(model);
+      if (simplex.solve(BB_Solver::Options().lp_iteration_limit, deadline) != DualSimplex::Optimal) {
+         return false;
+      }
+      objective = simplex.objective() + model.objective_offset;
+      return true;
+   }
+
+   // the optimum of @p model with the lesson columns fixed to the lessons of @p schedule, where @p lesson_column is
+   // the column of a requirement of the schedule at an hour; false if it is not found within @p time_limit, or if a
+   // lesson has no column
+   template<typename LessonColumn>
+   bool schedule_objective(MIP_Model model, const Input &input, const Schedule &schedule, LessonColumn lesson_column,
+                           double time_limit, double &objective) {
+      for (unsigned int class_idx = 0; class_idx != input.num_classes(); ++class_idx) {
+         const Input::Class &school_class = input.get_classes()[class_idx];
+         for (unsigned int day = 0; day != WeekShape::NUM_DAYS; ++day) {
+            for (unsigned int hour = 0; hour != school_class.num_hours_per_day[day]; ++hour) {
+               for (unsigned int req_idx: school_class.requirements) {
+                  VarID col = lesson_column(req_idx, day, hour);
+                  double value = schedule.get_lesson(class_idx, day, hour) == req_idx ? 1.0 : 0.0;
+                  if (col == Variables::InvalidVarID) {
+                     if (value != 0.0) {
+                        return false;
+                     }
+                     continue;
+                  }
+                  model.lower[col] = value;
+                  model.upper[col] = value;
+               }
+            }
+         }
+      }
+      // the lessons decide almost every other column, which the presolve fixes
+      Presolve presolve(model);
+      if (presolve.is_infeasible()) {
+         return false;
+      }
+      BB_Solver::Options options;
+      options.time_limit = time_limit;
+      BB_Solver::Result result = BB_Solver(presolve.get_model(), options).solve();
+      objective = result.objective;
+      return result.status == BB_Solver::Optimal;
+   }
+
+   void print_objective(double objective, bool solved) {
+      if (solved) {
+         std::cout << std::setw(12) << objective;
+      } else {
+         std::cout << std::setw(12) << "-";
+      }
+   }
+
+   // applies the change sets of edits of @p input to @p model, and compares it with the model of the edited input:
+   // on their LP relaxations, unless not @p compare_lp, and on a schedule of the edited input from a tabu search,
+   // with its lessons fixed in both. Returns false if they differ or if a comparison cannot be made
+   bool check_delta(const std::string &text, const Input &input, const LP_Provider &lp_provider, MIP_Model &model,
+                    double time_limit, bool compare_lp) {
+      std::cout << std::setw(8) << input.num_classes();
+      DeltaEdit edit(0, WeekGrid<int>(), 0, 0);
+      if (not choose_delta_edit(input, edit)) {
+         std::cout << "  no requirement to move" << std::endl;
+         return false;
+      }
+      const Input::Requirement &removed = input.get_requirements()[edit.removed_req_idx];
+      auto start = std::chrono::steady_clock::now();
+      ModelDelta delta(input, lp_provider);
+      delta.update_teacher_penalties(edit.teacher_idx, edit.penalties).apply(model);
+      delta.remove_requirement(edit.removed_req_idx).apply(model);
+      delta.add_requirement(edit.added_teacher_idx, input.convert_from_class_id(removed.class_id()), removed.lessons,
+                            removed.num_days_with_cons_hours).apply(model);
+      double delta_seconds = seconds_since(start);
+
+      std::string edited_text = edit_input(text, input, edit);
+      start = std::chrono::steady_clock::now();
+      Input edited_input(edited_text.data(), edited_text.data() + edited_text.size());
+      Variables edited_variables(edited_input);
+      LP_Provider edited_provider(edited_input, edited_variables, LP_Provider::Min, LP_Provider::InMemory);
+      MIP_Model edited_model(edited_provider);
+      double rebuild_seconds = seconds_since(start);
+
+      double delta_lp = 0.0;
+      double rebuilt_lp = 0.0;
+      bool delta_lp_solved = compare_lp and lp_objective(model, time_limit, delta_lp);
+      bool rebuilt_lp_solved = compare_lp and lp_objective(edited_model, time_limit, rebuilt_lp);
+      bool same = not compare_lp or
+                  (delta_lp_solved and rebuilt_lp_solved and same_objective(delta_lp, rebuilt_lp));
+
+      TabuSearch::Options tabu_options;
+      tabu_options.time_limit = std::min(1.0, time_limit);
+      TabuSearch tabu_search(edited_input, tabu_options);
+      bool has_schedule = tabu_search.run().violations == 0;
+      Schedule schedule = tabu_search.get_best_schedule();
+      double delta_schedule = 0.0;
+      double rebuilt_schedule = 0.0;
+      bool delta_schedule_solved = false;
+      bool rebuilt_schedule_solved = false;
+      if (has_schedule) {
+         // the requirements of the edited input are those of the input without the removed one, then the added one
+         auto delta_lesson = [&](unsigned int req_idx, unsigned int day, unsigned int hour) {
+            return delta.lesson_column(req_idx < edit.removed_req_idx ? req_idx : req_idx + 1, day, hour);
+         };
+         auto rebuilt_lesson = [&](unsigned int req_idx, unsigned int day, unsigned int hour) {
+            return edited_variables.requirement_var(req_idx, day, hour);
+         };
+         delta_schedule_solved = schedule_objective(model, edited_input, schedule, delta_lesson, time_limit,
+                                                    delta_schedule);
+         rebuilt_schedule_solved = schedule_objective(edited_model, edited_input, schedule, rebuilt_lesson, time_limit,
+                                                      rebuilt_schedule);
+      }
+      same = same and delta_schedule_solved and rebuilt_schedule_solved and
+             same_objective(delta_schedule, rebuilt_schedule);
+
+      std::cout << std::setw(10) << delta_seconds << std::setw(10) << rebuild_seconds;
+      if (compare_lp) {
+         print_objective(delta_lp, delta_lp_solved);
+         print_objective(rebuilt_lp, rebuilt_lp_solved);
+      } else {
+         std::cout << std::setw(12) << "skipped" << std::setw(12) << "skipped";
+      }
+      print_objective(delta_schedule, delta_schedule_solved);
+      print_objective(rebuilt_schedule, rebuilt_schedule_solved);
+      std::cout << std::setw(8) << (same ? "yes" : "NO") << std::endl;
+      return same;
+   }
+}
+
+int main(int argc, char *argv[]) {
+   std::vector<unsigned int> sizes;
+   unsigned int seed = 1;
+   unsigned int num_threads = 1;
+   bool check_deltas = false;
+   double time_limit = 10.0;
+   bool compare_lp = true;
+   for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+      if (std::strcmp(argv[arg_idx], "--seed") == 0 and arg_idx + 1 < argc) {
+         seed = std::stoul(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--threads") == 0 and arg_idx + 1 < argc) {
+         num_threads = std::stoul(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--delta") == 0) {
+         check_deltas = true;
+      } else if (std::strcmp(argv[arg_idx], "--time-limit") == 0 and arg_idx + 1 < argc) {
+         time_limit = std::stod(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--no-lp") == 0) {
+         compare_lp = false;
+      } else {
+         sizes.push_back(std::stoul(argv[arg_idx]));
+      }
+   }
+   if (sizes.empty()) {
+      sizes = {10, 30, 100, 300, 1000};
+   }
+   std::sort(sizes.begin(), sizes.end());
+
+   std::cout << std::setw(8) << "classes" << std::setw(10) << "teachers" << std::setw(8) << "reqs"
+             << std::setw(10) << "input MB" << std::setw(10) << "parse s" << std::setw(10) << "vars s"
+             << std::setw(10) << "model s" << std::setw(10) << "rows" << std::setw(10) << "columns"
+             << std::setw(11) << "nonzeros" << std::setw(10) << "peak MB" << std::endl;
+   std::vector<std::string> texts;
+   for (unsigned int num_classes: sizes) {
+      GeneratorOptions options(num_classes);
+      options.seed = seed;
+      std::ostringstream input_stream;
+      write_random_input(input_stream, options);
+      std::string text = input_stream.str();
+
+      auto start = std::chrono::steady_clock::now();
+      Input input(text.data(), text.data() + text.size());
+      double parse_seconds = seconds_since(start);
+      start = std::chrono::steady_clock::now();
+      Variables variables(input);
+      double variables_seconds = seconds_since(start);
+      start = std::chrono::steady_clock::now();
+      LP_Provider lp_provider(input, variables, LP_Provider::Min, LP_Provider::InMemory, num_threads);
+      double model_seconds = seconds_since(start);
+
+      std::cout << std::setw(8) << input.num_classes() << std::setw(10) << input.num_teachers() << std::setw(8)
+                << input.num_requirements() << std::setw(10) << std::setprecision(3) << text.size() / 1e6
+                << std::setw(10) << parse_seconds << std::setw(10) << variables_seconds << std::setw(10)
+                << model_seconds << std::setw(10) << lp_provider.num_constraints() << std::setw(10)
+                << variables.num_var() << std::setw(11) << lp_provider.num_nonzeros() << std::setw(10)
+                << peak_rss_megabytes() << std::endl;
+      if (check_deltas) {
+         texts.push_back(std::move(text));
+      }
+   }
+   if (not check_deltas) {
+      return 0;
+   }
+
+   std::cout << std::fixed << std::setprecision(4) << std::endl << std::setw(8) << "classes" << std::setw(10)
+             << "delta s" << std::setw(10) << "build s" << std::setw(12) << "LP delta" << std::setw(12) << "LP built"
+             << std::setw(12) << "sched delta" << std::setw(12) << "sched built" << std::setw(8) << "same" << std::endl;
+   bool all_same = true;
+   for (const std::string &text: texts) {
+      Input input(text.data(), text.data() + text.size());
+      Variables variables(input);
+      LP_Provider lp_provider(input, variables, LP_Provider::Min, LP_Provider::InMemory, num_threads);
+      MIP_Model model(lp_provider);
+      all_same = check_delta(text, input, lp_provider, model, time_limit, compare_lp) and all_same;
+   }
+   return all_same ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+//
+// Created by mich on 17/10/26.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BB_Solver.h"
+#include "Input.h"
+#include "LP_Provider.h"
+#include "MIP_Model.h"
+#include "Mapped_File.h"
+#include "Model_Solver.h"
+#include "Variables.h"
+
+// usage: Thread_Benchmark <input.txt | directory> ... [--threads <n,n,...>] [--time-limit <seconds>] [--repeat <r>]
+// Measures how the time of the branch-and-bound to prove the optimum scales with its threads: every input, every .txt
+// file of every directory given, is solved as the program solves it with each number of threads (1,2,4,8 by
+// default), with work stealing and with --deterministic, --repeat times (1 by default), and the median seconds, the
+// nodes of that run and the speedup over one thread are printed. A run that stops at --time-limit (60 by default)
+// before proving the optimum has no speedup. The inputs of tools/thread_inputs are small enough to be closed in
+// seconds, unlike those of tools/Instance_Generator
+namespace {
+   struct Run {
+      BB_Solver::Status status;
+      double objective;
+      size_t num_nodes;
+      double seconds;
+
+      Run() : status{BB_Solver::NoSolution}, objective{0.0}, num_nodes{0}, seconds{0.0} {}
+   };
+
+   std::vector<unsigned int> parse_threads(const std::string &text) {
+      std::vector<unsigned int> threads;
+      std::istringstream stream(text);
+      std::string item;
+      while (std::getline(stream, item, ',')) {
+         threads.push_back(std::max(1ul, std::stoul(item)));
+      }
+      return threads;
+   }
+
+   // the run of median seconds out of @p repeat
+   Run median_run(const LP_Provider &lp_provider, const MIP_Model &model, const BB_Solver::Options &options,
+                  unsigned int repeat) {
+      std::vector<Run> runs;
+      for (unsigned int idx = 0; idx != repeat; ++idx) {
+         ModelSolver model_solver(lp_provider, model, true, options);
+         BB_Solver::Result result = model_solver.solve();
+         Run run;
+         run.status = result.status;
+         run.objective = result.objective;
+         run.num_nodes = result.num_nodes;
+         run.seconds = result.seconds;
+         runs.push_back(run);
+      }
+      std::sort(runs.begin(), runs.end(), [](const Run &first, const Run &second) {
+         return first.seconds < second.seconds;
+      });
+      return runs[runs.size() / 2];
+   }
+
+   void print_run(const std::string &name, unsigned int num_threads, const char *mode, const Run &run,
+                  const Run &single_thread) {
+      std::cout << std::setw(24) << name << std::setw(8) << num_threads << std::setw(15) << mode << std::setw(12)
+                << BB_Solver::status_name(run.status) << std::setw(12) << run.objective << std::setw(10)
+                << run.num_nodes << std::setw(10) << run.seconds << std::setw(10);
+      if (run.status == BB_Solver::Optimal and single_thread.status == BB_Solver::Optimal) {
+         std::cout << single_thread.seconds / run.seconds << std::endl;
+      } else {
+         std::cout << "-" << std::endl;
+      }
+   }
+}
+
+int main(int argc, char *argv[]) {
+   std::vector<std::filesystem::path> paths;
+   std::vector<unsigned int> thread_counts = {1, 2, 4, 8};
+   double time_limit = 60.0;
+   unsigned int repeat = 1;
+   for (int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+      if (std::strcmp(argv[arg_idx], "--threads") == 0 and arg_idx + 1 < argc) {
+         thread_counts = parse_threads(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--time-limit") == 0 and arg_idx + 1 < argc) {
+         time_limit = std::stod(argv[++arg_idx]);
+      } else if (std::strcmp(argv[arg_idx], "--repeat") == 0 and arg_idx + 1 < argc) {
+         repeat = std::max(1ul, std::stoul(argv[++arg_idx]));
+      } else if (std::filesystem::is_directory(argv[arg_idx])) {
+         std::vector<std::filesystem::path> directory_paths;
+         for (const std::filesystem::directory_entry &file: std::filesystem::directory_iterator(argv[arg_idx])) {
+            if (file.is_regular_file() and file.path().extension() == ".txt") {
+               directory_paths.push_back(file.path());
+            }
+         }
+         std::sort(directory_paths.begin(), directory_paths.end());
+         paths.insert(paths.end(), directory_paths.begin(), directory_paths.end());
+      } else {
+         paths.emplace_back(argv[arg_idx]);
+      }
+   }
+   if (paths.empty() or thread_counts.empty()) {
+      std::cerr << "usage: Thread_Benchmark <input.txt | directory> ... [--threads <n,n,...>] "
+                   "[--time-limit <seconds>] [--repeat <r>]" << std::endl;
+      return 1;
+   }
+   std::sort(thread_counts.begin(), thread_counts.end());
+
+   std::cout << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+   std::cout << std::setw(24) << "input" << std::setw(8) << "threads" << std::setw(15) << "mode" << std::setw(12)
+             << "status" << std::setw(12) << "objective" << std::setw(10) << "nodes" << std::setw(10) << "seconds"
+             << std::setw(10) << "speedup" << std::endl;
+   std::cout << std::setprecision(4);
+   for (const std::filesystem::path &path: paths) {
+      MappedFile input_mapping(path.string());
+      if (not input_mapping.is_open()) {
+         std::cerr << "cannot open " << path << std::endl;
+         return 1;
+      }
+      Input input(input_mapping.begin(), input_mapping.end());
+      Variables variables(input);
+      LP_Provider lp_provider(input, variables, LP_Provider::Min, LP_Provider::InMemory);
+      MIP_Model model(lp_provider);
+      std::string name = path.stem().string();
+
+      BB_Solver::Options options;
+      options.time_limit = time_limit;
+      options.num_threads = 1;
+      Run single_thread = median_run(lp_provider, model, options, repeat);
+      for (unsigned int num_threads: thread_counts) {
+         if (num_threads == 1) {
+            print_run(name, num_threads, "-", single_thread, single_thread);
+            continue;
+         }
+         options.num_threads = num_threads;
+         for (bool deterministic: {false, true}) {
+            options.deterministic = deterministic;
+            print_run(name, num_threads, deterministic ? "deterministic" : "work stealing",
+                      median_run(lp_provider, model, options, repeat), single_thread);
+         }
+         options.deterministic = false;
+      }
+   }
+   return 0;
+}